@@ -0,0 +1,104 @@
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace Sunstrider
+{
+
+    static std::atomic<std::uint64_t> sHeapAllocations{ 0 };
+
+    auto GetHeapAllocations()
+        -> std::uint64_t
+    {
+        return sHeapAllocations.load(std::memory_order_relaxed);
+    }
+
+    static auto CountedAllocate(std::size_t aBytes) noexcept
+        -> void*
+    {
+        sHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+        for (;;)
+        {
+            if (auto vMemory = std::malloc(aBytes ? aBytes : 1))
+            {
+                return vMemory;
+            }
+
+            const auto vHandler = std::get_new_handler();
+            if (!vHandler)
+            {
+                return nullptr;
+            }
+            vHandler();
+        }
+    }
+
+}
+
+auto operator new(std::size_t aBytes)
+    -> void*
+{
+    if (auto vMemory = Sunstrider::CountedAllocate(aBytes))
+    {
+        return vMemory;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new[](std::size_t aBytes)
+    -> void*
+{
+    return operator new(aBytes);
+}
+
+auto operator new(std::size_t aBytes, const std::nothrow_t&) noexcept
+    -> void*
+{
+    return Sunstrider::CountedAllocate(aBytes);
+}
+
+auto operator new[](std::size_t aBytes, const std::nothrow_t&) noexcept
+    -> void*
+{
+    return Sunstrider::CountedAllocate(aBytes);
+}
+
+auto operator delete(void* aMemory) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
+
+auto operator delete[](void* aMemory) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
+
+auto operator delete(void* aMemory, std::size_t) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
+
+auto operator delete[](void* aMemory, std::size_t) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
+
+auto operator delete(void* aMemory, const std::nothrow_t&) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
+
+auto operator delete[](void* aMemory, const std::nothrow_t&) noexcept
+    -> void
+{
+    std::free(aMemory);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace Sunstrider
+{
+
+    // The number of heap allocations made by this module so far.
+    //
+    // The global operator new is replaced in AllocationCounter.cpp so that
+    // every allocation of PGKd (including the ones of the standard library)
+    // is counted. !findpg reports the difference across a scan to show that
+    // it does not depend on the number of pages scanned.
+    auto GetHeapAllocations()
+        -> std::uint64_t;
+
+}
@@ -0,0 +1,145 @@
+#include "BigPoolPrefilter.h"
+#include "CpuFeatures.h"
+
+#include <cstring>
+
+#if SUNSTRIDER_X86
+#include <immintrin.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    static inline auto IsBigPoolCandidate(const BigPoolRecord& aRecord, const BigPoolPrefilter& aFilter)
+        -> bool
+    {
+        return aRecord.Va && !(aRecord.Va & 1) &&
+            aFilter.MinimumSize <= aRecord.NumberOfBytes &&
+            aRecord.NumberOfBytes <= aFilter.MaximumSize &&
+            !(GetBigPoolType(aRecord, aFilter.IsWindows10OrGreater) & ~NON_PAGED_POOL_TYPE_BITS);
+    }
+
+    auto PrefilterBigPoolRecordsScalar(
+        const BigPoolRecord*    aRecords,
+        std::size_t             aCount,
+        const BigPoolPrefilter& aFilter,
+        std::uint64_t*          aMask)
+        -> void
+    {
+        memset(aMask, 0, ((aCount + 63) / 64) * sizeof(*aMask));
+
+        for (std::size_t i = 0; i < aCount; ++i)
+        {
+            if (IsBigPoolCandidate(aRecords[i], aFilter))
+            {
+                aMask[i / 64] |= 1ull << (i % 64);
+            }
+        }
+    }
+
+#if SUNSTRIDER_X86
+
+    // Four records are 12 qwords loaded into 3 registers:
+    //   r0 = Va0 TP0 N0  Va1
+    //   r1 = TP1 N1  Va2 TP2
+    //   r2 = N2  Va3 TP3 N3
+    // where TP is the Tag and PoolType qword. Each field is gathered with two
+    // blends and one cross-lane permute.
+    SUNSTRIDER_TARGET_AVX2
+    static auto PrefilterBigPoolRecordsAvx2(
+        const BigPoolRecord*    aRecords,
+        std::size_t             aCount,
+        const BigPoolPrefilter& aFilter,
+        std::uint64_t*          aMask)
+        -> void
+    {
+        memset(aMask, 0, ((aCount + 63) / 64) * sizeof(*aMask));
+
+        const auto vCursor = reinterpret_cast<const std::uint8_t*>(aRecords);
+
+        // Unsigned range check: (N - Minimum) <= (Maximum - Minimum), done with
+        // a signed compare after flipping the sign bits
+        const auto vSignBit  = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ull));
+        const auto vMinimum  = _mm256_set1_epi64x(static_cast<long long>(aFilter.MinimumSize));
+        const auto vRange    = _mm256_xor_si256(
+            _mm256_set1_epi64x(static_cast<long long>(aFilter.MaximumSize - aFilter.MinimumSize)), vSignBit);
+        const auto vOne      = _mm256_set1_epi64x(1);
+        const auto vZero     = _mm256_setzero_si256();
+        const auto vTypeMask = _mm256_set1_epi64x(aFilter.IsWindows10OrGreater
+            ? static_cast<long long>((0xFFFull & ~NON_PAGED_POOL_TYPE_BITS) << 40)
+            : static_cast<long long>((0xFFFFFFFFull & ~NON_PAGED_POOL_TYPE_BITS) << 32));
+
+        std::size_t i = 0;
+        for (; i + 4 <= aCount; i += 4)
+        {
+            const auto r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor + i * sizeof(BigPoolRecord)));
+            const auto r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor + i * sizeof(BigPoolRecord) + 32));
+            const auto r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor + i * sizeof(BigPoolRecord) + 64));
+
+            // [Va0 Va1 Va2 Va3]: r0[0] r0[3] r1[2] r2[1]
+            auto vVa = _mm256_blend_epi32(r0, r1, 0x30);                    // Va0 TP0 Va2 Va1
+            vVa = _mm256_blend_epi32(vVa, r2, 0x0C);                        // Va0 Va3 Va2 Va1
+            vVa = _mm256_permute4x64_epi64(vVa, _MM_SHUFFLE(1, 2, 3, 0));
+
+            // [TP0 TP1 TP2 TP3]: r0[1] r1[0] r1[3] r2[2]
+            auto vTp = _mm256_blend_epi32(r0, r1, 0xC3);                    // TP1 TP0 N0 TP2
+            vTp = _mm256_blend_epi32(vTp, r2, 0x30);                        // TP1 TP0 TP3 TP2
+            vTp = _mm256_permute4x64_epi64(vTp, _MM_SHUFFLE(2, 3, 0, 1));
+
+            // [N0 N1 N2 N3]: r0[2] r1[1] r2[0] r2[3]
+            auto vN = _mm256_blend_epi32(r0, r1, 0x0C);                     // Va0 N1 N0 Va1
+            vN = _mm256_blend_epi32(vN, r2, 0xC3);                          // N2 N1 N0 N3
+            vN = _mm256_permute4x64_epi64(vN, _MM_SHUFFLE(3, 0, 1, 2));
+
+            // Va != 0 && !(Va & 1)
+            const auto vVaUnused = _mm256_or_si256(
+                _mm256_cmpeq_epi64(vVa, vZero),
+                _mm256_cmpeq_epi64(_mm256_and_si256(vVa, vOne), vOne));
+
+            // NumberOfBytes out of the range
+            const auto vSizeOut = _mm256_cmpgt_epi64(
+                _mm256_xor_si256(_mm256_sub_epi64(vN, vMinimum), vSignBit), vRange);
+
+            // A bit which no non-paged pool type has
+            const auto vTypeOut = _mm256_xor_si256(
+                _mm256_cmpeq_epi64(_mm256_and_si256(vTp, vTypeMask), vZero), _mm256_set1_epi64x(-1));
+
+            const auto vReject = _mm256_or_si256(vVaUnused, _mm256_or_si256(vSizeOut, vTypeOut));
+            const auto vAccept = ~static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(vReject))) & 0xF;
+
+            aMask[i / 64] |= static_cast<std::uint64_t>(vAccept) << (i % 64);
+        }
+
+        for (; i < aCount; ++i)
+        {
+            if (IsBigPoolCandidate(aRecords[i], aFilter))
+            {
+                aMask[i / 64] |= 1ull << (i % 64);
+            }
+        }
+    }
+
+#endif
+
+    auto PrefilterBigPoolRecords(
+        const BigPoolRecord*    aRecords,
+        std::size_t             aCount,
+        const BigPoolPrefilter& aFilter,
+        std::uint64_t*          aMask)
+        -> void
+    {
+        using PrefilterRoutine = void(*)(const BigPoolRecord*, std::size_t, const BigPoolPrefilter&, std::uint64_t*);
+
+#if SUNSTRIDER_X86
+        static const auto sPrefilter = IsAvx2Supported()
+            ? static_cast<PrefilterRoutine>(&PrefilterBigPoolRecordsAvx2)
+            : static_cast<PrefilterRoutine>(&PrefilterBigPoolRecordsScalar);
+#else
+        static const auto sPrefilter = static_cast<PrefilterRoutine>(&PrefilterBigPoolRecordsScalar);
+#endif
+
+        sPrefilter(aRecords, aCount, aFilter, aMask);
+    }
+
+}
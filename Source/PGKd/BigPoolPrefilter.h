@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Sunstrider
+{
+
+    // Layout of POOL_TRACKER_BIG_PAGES, which is the same on every x64 build.
+    // Windows 10 packs Pattern:8, PoolType:12 and SlushSize:12 into the dword
+    // that used to hold the pool type.
+    struct BigPoolRecord
+    {
+        std::uint64_t Va;
+        std::uint32_t Tag;
+        std::uint32_t PoolType;
+        std::uint64_t NumberOfBytes;
+    };
+    static_assert(sizeof(BigPoolRecord) == 0x18, "sizeof(BigPoolRecord) != 0x18");
+
+    struct BigPoolPrefilter
+    {
+        std::uint64_t   MinimumSize;
+        std::uint64_t   MaximumSize;
+        bool            IsWindows10OrGreater;
+    };
+
+    // Returns the pool type of the record for the version of the target
+    inline auto GetBigPoolType(const BigPoolRecord& aRecord, bool aIsWindows10OrGreater)
+        -> std::uint32_t
+    {
+        return aIsWindows10OrGreater ? (aRecord.PoolType >> 8) & 0xFFF : aRecord.PoolType;
+    }
+
+    // Every non-paged pool type is a combination of these bits
+    // (NonPagedPool is 0, MustSucceed 2, CacheAligned 4, Session 32, Nx 512)
+    constexpr std::uint32_t NON_PAGED_POOL_TYPE_BITS = 0x2 | 0x4 | 0x20 | 0x200;
+
+    // Sets bit i of aMask for every record which may be a PatchGuard context:
+    // Va is used and not freed, NumberOfBytes is within the range and the
+    // pool type may be non-paged. The pool type test is a superset of the
+    // exact one, which the caller still has to apply to each hit.
+    //
+    // aMask must hold (aCount + 63) / 64 qwords. The kernel runs over 4
+    // records (96 bytes) at a time with AVX2 when available, and all
+    // implementations return the same mask.
+    auto PrefilterBigPoolRecords(
+        const BigPoolRecord*    aRecords,
+        std::size_t             aCount,
+        const BigPoolPrefilter& aFilter,
+        std::uint64_t*          aMask)
+        -> void;
+
+    // The portable implementation, used as the reference of the vectorized one
+    auto PrefilterBigPoolRecordsScalar(
+        const BigPoolRecord*    aRecords,
+        std::size_t             aCount,
+        const BigPoolPrefilter& aFilter,
+        std::uint64_t*          aMask)
+        -> void;
+
+}
@@ -0,0 +1,240 @@
+#include "ByteCensus.h"
+#include "CpuFeatures.h"
+
+#include <bitset>
+
+#if SUNSTRIDER_X86
+#include <immintrin.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    // The presence bitmap is split into 4 copies, and consecutive bytes are
+    // recorded into different copies. This breaks the read-modify-write chain
+    // between neighbouring bytes, which is what limits the scalar loop.
+    struct PresenceBitmap
+    {
+        std::uint64_t Bits[4][4] = {};
+
+        auto Set(std::size_t aLane, std::uint8_t aByte)
+            -> void
+        {
+            Bits[aLane & 3][aByte >> 6] |= 1ull << (aByte & 63);
+        }
+
+        auto Count() const
+            -> std::uint32_t
+        {
+            auto vCount = 0u;
+            for (auto i = 0; i < 4; ++i)
+            {
+                const auto vBits = Bits[0][i] | Bits[1][i] | Bits[2][i] | Bits[3][i];
+                vCount += static_cast<std::uint32_t>(std::bitset<64>(vBits).count());
+            }
+            return vCount;
+        }
+    };
+
+    // 0x00 -> 0x01 and 0xff -> 0x00, so both are <= 1
+    static inline auto IsDistinctiveNumber(std::uint8_t aByte)
+        -> std::uint32_t
+    {
+        return static_cast<std::uint8_t>(aByte + 1) <= 1;
+    }
+
+    auto TakeByteCensusScalar(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo
+    {
+        const auto vCursor = static_cast<const std::uint8_t*>(aAddress);
+
+        PresenceBitmap  vBitmap;
+        std::uint32_t   vDistinctive = 0;
+
+        for (std::size_t i = 0; i < aSize; ++i)
+        {
+            vBitmap.Set(i, vCursor[i]);
+            vDistinctive += IsDistinctiveNumber(vCursor[i]);
+        }
+
+        return RandomnessInfo{ vDistinctive, vBitmap.Count() };
+    }
+
+#if SUNSTRIDER_X86
+
+    static auto TakeByteCensusSse2(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo
+    {
+        const auto vCursor = static_cast<const std::uint8_t*>(aAddress);
+
+        PresenceBitmap  vBitmap;
+        std::uint32_t   vDistinctive = 0;
+
+        const auto vZero = _mm_setzero_si128();
+        const auto vOnes = _mm_set1_epi8(-1);
+
+        std::size_t i = 0;
+        for (; i + 16 <= aSize; i += 16)
+        {
+            const auto vBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vCursor + i));
+            const auto vMatch = _mm_or_si128(
+                _mm_cmpeq_epi8(vBytes, vZero),
+                _mm_cmpeq_epi8(vBytes, vOnes));
+
+            vDistinctive += static_cast<std::uint32_t>(
+                std::bitset<16>(static_cast<unsigned>(_mm_movemask_epi8(vMatch))).count());
+
+            // SSE2 has no byte shuffle to look up the bit of each byte, and
+            // building it with compares and adds is twice as slow as these
+            // stores, so the bitmap is only vectorized with AVX2
+            for (std::size_t j = 0; j < 16; ++j)
+            {
+                vBitmap.Set(j, vCursor[i + j]);
+            }
+        }
+
+        for (; i < aSize; ++i)
+        {
+            vBitmap.Set(i, vCursor[i]);
+            vDistinctive += IsDistinctiveNumber(vCursor[i]);
+        }
+
+        return RandomnessInfo{ vDistinctive, vBitmap.Count() };
+    }
+
+    // The AVX2 kernel keeps the presence bitmap in registers. There is no
+    // scatter to set the bit of every byte at once, so each of the 32 bytes of
+    // the bitmap (the values 8g to 8g + 7 for the byte g) gets an accumulator
+    // of its own, into which every lane ORs the bit of its byte when the byte
+    // belongs to g. The lanes of the accumulators are merged once at the end.
+    constexpr std::size_t PRESENCE_GROUPS = 32;
+
+    SUNSTRIDER_TARGET_AVX2
+    static inline auto RecordPresence(__m256i (&aGroups)[PRESENCE_GROUPS], __m256i aBytes)
+        -> void
+    {
+        const auto vBitOf = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+        const auto vBits  = _mm256_shuffle_epi8(vBitOf, _mm256_and_si256(aBytes, _mm256_set1_epi8(7)));
+        const auto vGroup = _mm256_and_si256(_mm256_srli_epi16(aBytes, 3), _mm256_set1_epi8(0x1f));
+
+        for (std::size_t g = 0; g < PRESENCE_GROUPS; ++g)
+        {
+            const auto vInGroup = _mm256_cmpeq_epi8(vGroup, _mm256_set1_epi8(static_cast<char>(g)));
+            aGroups[g] = _mm256_or_si256(aGroups[g], _mm256_and_si256(vInGroup, vBits));
+        }
+    }
+
+    // Merges the lanes of every accumulator by halves, two accumulators at a
+    // time, into the byte g of the bitmap, and ORs aTail (the bytes left out
+    // of the vectors) into it.
+    SUNSTRIDER_TARGET_AVX2
+    static inline auto CountPresence(__m256i (&aGroups)[PRESENCE_GROUPS], const std::uint64_t (&aTail)[4])
+        -> std::uint32_t
+    {
+        for (std::size_t i = 0; i < 16; ++i)
+        {
+            aGroups[i] = _mm256_or_si256(
+                _mm256_unpacklo_epi8(aGroups[2 * i], aGroups[2 * i + 1]),
+                _mm256_unpackhi_epi8(aGroups[2 * i], aGroups[2 * i + 1]));
+        }
+        for (std::size_t i = 0; i < 8; ++i)
+        {
+            aGroups[i] = _mm256_or_si256(
+                _mm256_unpacklo_epi16(aGroups[2 * i], aGroups[2 * i + 1]),
+                _mm256_unpackhi_epi16(aGroups[2 * i], aGroups[2 * i + 1]));
+        }
+        for (std::size_t i = 0; i < 4; ++i)
+        {
+            aGroups[i] = _mm256_or_si256(
+                _mm256_unpacklo_epi32(aGroups[2 * i], aGroups[2 * i + 1]),
+                _mm256_unpackhi_epi32(aGroups[2 * i], aGroups[2 * i + 1]));
+        }
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            aGroups[i] = _mm256_or_si256(
+                _mm256_unpacklo_epi64(aGroups[2 * i], aGroups[2 * i + 1]),
+                _mm256_unpackhi_epi64(aGroups[2 * i], aGroups[2 * i + 1]));
+        }
+        const auto vBitmap = _mm256_or_si256(
+            _mm256_permute2x128_si256(aGroups[0], aGroups[1], 0x20),
+            _mm256_permute2x128_si256(aGroups[0], aGroups[1], 0x31));
+
+        alignas(32) std::uint64_t vWords[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(vWords), vBitmap);
+
+        auto vCount = 0u;
+        for (auto i = 0; i < 4; ++i)
+        {
+            vCount += static_cast<std::uint32_t>(std::bitset<64>(vWords[i] | aTail[i]).count());
+        }
+        return vCount;
+    }
+
+    // The bits of the bytes which are 0x00 or 0xff
+    SUNSTRIDER_TARGET_AVX2
+    static inline auto GetDistinctiveMask(__m256i aBytes)
+        -> std::uint32_t
+    {
+        const auto vMatch = _mm256_or_si256(
+            _mm256_cmpeq_epi8(aBytes, _mm256_setzero_si256()),
+            _mm256_cmpeq_epi8(aBytes, _mm256_set1_epi8(-1)));
+
+        return static_cast<std::uint32_t>(_mm256_movemask_epi8(vMatch));
+    }
+
+    SUNSTRIDER_TARGET_AVX2
+    static auto TakeByteCensusAvx2(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo
+    {
+        const auto vCursor = static_cast<const std::uint8_t*>(aAddress);
+
+        __m256i         vGroups[PRESENCE_GROUPS];
+        std::uint32_t   vDistinctive = 0;
+
+        for (auto& vGroup : vGroups)
+        {
+            vGroup = _mm256_setzero_si256();
+        }
+
+        std::size_t i = 0;
+        for (; i + 32 <= aSize; i += 32)
+        {
+            const auto vBytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor + i));
+            vDistinctive += static_cast<std::uint32_t>(_mm_popcnt_u32(GetDistinctiveMask(vBytes)));
+            RecordPresence(vGroups, vBytes);
+        }
+
+        // Another vector costs 32 compares, more than the few bytes left
+        std::uint64_t vTail[4] = {};
+        for (; i < aSize; ++i)
+        {
+            vTail[vCursor[i] >> 6] |= 1ull << (vCursor[i] & 63);
+            vDistinctive += IsDistinctiveNumber(vCursor[i]);
+        }
+
+        return RandomnessInfo{ vDistinctive, CountPresence(vGroups, vTail) };
+    }
+
+#endif
+
+    auto TakeByteCensus(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo
+    {
+        using TakeByteCensusRoutine = RandomnessInfo(*)(const void*, std::size_t);
+
+#if SUNSTRIDER_X86
+        static const auto sTakeByteCensus = IsAvx2Supported()
+            ? static_cast<TakeByteCensusRoutine>(&TakeByteCensusAvx2)
+            : static_cast<TakeByteCensusRoutine>(&TakeByteCensusSse2);
+#else
+        static const auto sTakeByteCensus = static_cast<TakeByteCensusRoutine>(&TakeByteCensusScalar);
+#endif
+
+        return sTakeByteCensus(aAddress, aSize);
+    }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Sunstrider
+{
+
+    struct RandomnessInfo
+    {
+        std::uint32_t NumberOfDistinctiveNumbers;   // The number of 0x00 and 0xff
+        std::uint32_t Ramdomness;                   // The number of unique bytes
+    };
+
+    // Takes a census of the bytes in the given range in a single pass: fills a
+    // 256-bit presence bitmap (the randomness is its population count) and
+    // counts 0x00 and 0xff bytes at the same time.
+    //
+    // This is the innermost loop of both discovery phases, so the kernel is
+    // vectorized with AVX2 or SSE2, selected at runtime, and falls back to a
+    // scalar implementation elsewhere. All of them return the same result.
+    auto TakeByteCensus(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo;
+
+    // The portable implementation, used as the reference of the vectorized ones
+    auto TakeByteCensusScalar(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo;
+
+}
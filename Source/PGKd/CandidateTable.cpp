@@ -0,0 +1,242 @@
+#include "CandidateTable.h"
+
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::size_t CandidateTable::RADIX_BITS;
+
+    auto CandidateTable::Size() const
+        -> std::size_t
+    {
+        return _Va.size();
+    }
+
+    auto CandidateTable::Clear()
+        -> void
+    {
+        _Va.clear();
+        _Context.clear();
+        _Size.clear();
+        _Tag.clear();
+        _SequenceId.clear();
+        _Origin.clear();
+        _MappingShift.clear();
+        _Distinctive.clear();
+        _Randomness.clear();
+    }
+
+    auto CandidateTable::Append(const Finding& aFinding)
+        -> void
+    {
+        std::uint8_t vMappingShift = 0;
+        while (vMappingShift < 63 && (1ull << vMappingShift) < aFinding.MappingSize)
+        {
+            ++vMappingShift;
+        }
+
+        if (aFinding.Size > UINT32_MAX ||
+            aFinding.SequenceId > UINT32_MAX ||
+            aFinding.Randomness.NumberOfDistinctiveNumbers > UINT8_MAX ||
+            aFinding.Randomness.Ramdomness > UINT8_MAX ||
+            (aFinding.MappingSize && (1ull << vMappingShift) != aFinding.MappingSize))
+        {
+            throw std::out_of_range("The finding does not fit in the candidate table.");
+        }
+
+        _Va.push_back(aFinding.Va);
+        _Context.push_back(aFinding.Context);
+        _Size.push_back(static_cast<std::uint32_t>(aFinding.Size));
+        _Tag.push_back(aFinding.Tag);
+        _SequenceId.push_back(static_cast<std::uint32_t>(aFinding.SequenceId));
+        _Origin.push_back(static_cast<std::uint8_t>(aFinding.Origin));
+        _MappingShift.push_back(aFinding.MappingSize ? vMappingShift : 0);
+        _Distinctive.push_back(static_cast<std::uint8_t>(aFinding.Randomness.NumberOfDistinctiveNumbers));
+        _Randomness.push_back(static_cast<std::uint8_t>(aFinding.Randomness.Ramdomness));
+    }
+
+    auto CandidateTable::Get(std::size_t aRow) const
+        -> Finding
+    {
+        return Finding
+        {
+            _SequenceId[aRow],
+            _Origin[aRow],
+            _Va[aRow],
+            _Size[aRow],
+            RandomnessInfo{ _Distinctive[aRow], _Randomness[aRow] },
+            _Tag[aRow],
+            _MappingShift[aRow] ? 1ull << _MappingShift[aRow] : 0,
+            _Context[aRow],
+        };
+    }
+
+    auto CandidateTable::Va(std::size_t aRow) const
+        -> std::uint64_t
+    {
+        return _Va[aRow];
+    }
+
+    auto CandidateTable::SortByAddress()
+        -> void
+    {
+        constexpr std::size_t BUCKETS = 1 << RADIX_BITS;
+        constexpr std::size_t PASSES  = 64 / RADIX_BITS;
+
+        const auto vCount = static_cast<std::uint32_t>(_Va.size());
+        if (vCount < 2)
+        {
+            return;
+        }
+
+        // The keys and the rows they come from, in two buffers which swap
+        // roles after every pass
+        std::vector<std::uint64_t> vKeys[2] = { _Va, std::vector<std::uint64_t>(vCount) };
+        std::vector<std::uint32_t> vRows[2] = { std::vector<std::uint32_t>(vCount), std::vector<std::uint32_t>(vCount) };
+        for (std::uint32_t i = 0; i < vCount; ++i)
+        {
+            vRows[0][i] = i;
+        }
+
+        // Every histogram comes from a single pass over the keys
+        std::array<std::array<std::uint32_t, BUCKETS>, PASSES> vHistograms = {};
+        for (const auto vKey : _Va)
+        {
+            for (std::size_t vPass = 0; vPass < PASSES; ++vPass)
+            {
+                ++vHistograms[vPass][(vKey >> (vPass * RADIX_BITS)) & (BUCKETS - 1)];
+            }
+        }
+
+        std::size_t vCurrent = 0;
+        for (std::size_t vPass = 0; vPass < PASSES; ++vPass)
+        {
+            auto& vHistogram = vHistograms[vPass];
+            const auto vShift = vPass * RADIX_BITS;
+
+            // Every key has the same digit, so the order does not change
+            if (vHistogram[(_Va[0] >> vShift) & (BUCKETS - 1)] == vCount)
+            {
+                continue;
+            }
+
+            std::uint32_t vOffset = 0;
+            for (auto& vBucket : vHistogram)
+            {
+                const auto vSize = vBucket;
+                vBucket = vOffset;
+                vOffset += vSize;
+            }
+
+            const auto& vKeysIn = vKeys[vCurrent];
+            const auto& vRowsIn = vRows[vCurrent];
+            auto& vKeysOut = vKeys[vCurrent ^ 1];
+            auto& vRowsOut = vRows[vCurrent ^ 1];
+            for (std::uint32_t i = 0; i < vCount; ++i)
+            {
+                const auto vSlot = vHistogram[(vKeysIn[i] >> vShift) & (BUCKETS - 1)]++;
+                vKeysOut[vSlot] = vKeysIn[i];
+                vRowsOut[vSlot] = vRowsIn[i];
+            }
+            vCurrent ^= 1;
+        }
+
+        Gather(vRows[vCurrent]);
+    }
+
+    auto CandidateTable::Gather(const std::vector<std::uint32_t>& aRows)
+        -> void
+    {
+        auto vGather = [&aRows](auto& aColumn)
+        {
+            auto vColumn = std::remove_reference_t<decltype(aColumn)>(aRows.size());
+            for (std::size_t i = 0; i < aRows.size(); ++i)
+            {
+                vColumn[i] = aColumn[aRows[i]];
+            }
+            aColumn.swap(vColumn);
+        };
+
+        vGather(_Va);
+        vGather(_Context);
+        vGather(_Size);
+        vGather(_Tag);
+        vGather(_SequenceId);
+        vGather(_Origin);
+        vGather(_MappingShift);
+        vGather(_Distinctive);
+        vGather(_Randomness);
+    }
+
+    auto CandidateTable::MergeOverlapping()
+        -> std::size_t
+    {
+        const auto vCount = _Va.size();
+        if (!vCount)
+        {
+            return 0;
+        }
+
+        // vLast is the row which the current run is merged into, and rows
+        // which start a new run are moved right after it
+        std::size_t vLast = 0;
+        auto vEnd = _Va[0] + _Size[0];
+
+        for (std::size_t i = 1; i < vCount; ++i)
+        {
+            if (_Va[i] < vEnd)
+            {
+                if (_Va[i] + _Size[i] > vEnd)
+                {
+                    vEnd = _Va[i] + _Size[i];
+                }
+                _Size[vLast] = static_cast<std::uint32_t>(vEnd - _Va[vLast]);
+
+                if (!(_Origin[vLast] & Finding::BIG_POOL) && (_Origin[i] & Finding::BIG_POOL))
+                {
+                    _Tag[vLast] = _Tag[i];
+                }
+                if (!(_Origin[vLast] & Finding::INDEPENDENT_PAGE) && (_Origin[i] & Finding::INDEPENDENT_PAGE))
+                {
+                    _MappingShift[vLast] = _MappingShift[i];
+                }
+                if (!_Context[vLast])
+                {
+                    _Context[vLast] = _Context[i];
+                }
+                _Origin[vLast] |= _Origin[i];
+                continue;
+            }
+
+            ++vLast;
+            _Va[vLast]           = _Va[i];
+            _Context[vLast]      = _Context[i];
+            _Size[vLast]         = _Size[i];
+            _Tag[vLast]          = _Tag[i];
+            _SequenceId[vLast]   = _SequenceId[i];
+            _Origin[vLast]       = _Origin[i];
+            _MappingShift[vLast] = _MappingShift[i];
+            _Distinctive[vLast]  = _Distinctive[i];
+            _Randomness[vLast]   = _Randomness[i];
+            vEnd = _Va[i] + _Size[i];
+        }
+
+        const auto vKept = vLast + 1;
+        _Va.resize(vKept);
+        _Context.resize(vKept);
+        _Size.resize(vKept);
+        _Tag.resize(vKept);
+        _SequenceId.resize(vKept);
+        _Origin.resize(vKept);
+        _MappingShift.resize(vKept);
+        _Distinctive.resize(vKept);
+        _Randomness.resize(vKept);
+
+        return vCount - vKept;
+    }
+
+}
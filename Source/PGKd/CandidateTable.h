@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "Finding.h"
+
+
+namespace Sunstrider
+{
+
+    // The pages found by a scan, stored column by column.
+    //
+    // A row is 32 bytes, against 64 for a Finding: the sizes are bounded by
+    // Scanner::MAXIMUM_REGION_SIZE, the scores by Scanner::EXAMINATION_BYTES,
+    // and a mapping is 4KB, 2MB or 1GB, so it is kept as its shift. Sorting
+    // and merging only touch the address and size columns until the rows
+    // are moved.
+    class CandidateTable
+    {
+        std::vector<std::uint64_t>  _Va;
+        std::vector<std::uint64_t>  _Context;
+        std::vector<std::uint32_t>  _Size;
+        std::vector<std::uint32_t>  _Tag;
+        std::vector<std::uint32_t>  _SequenceId;
+        std::vector<std::uint8_t>   _Origin;
+        std::vector<std::uint8_t>   _MappingShift;
+        std::vector<std::uint8_t>   _Distinctive;
+        std::vector<std::uint8_t>   _Randomness;
+
+        // Moves every column into the order of aRows
+        auto Gather(const std::vector<std::uint32_t>& aRows)
+            -> void;
+
+    public:
+        // The bits sorted by a pass of the radix sort
+        static constexpr std::size_t RADIX_BITS = 8;
+
+        auto Size() const
+            -> std::size_t;
+
+        auto Clear()
+            -> void;
+
+        // Throws std::out_of_range if a field does not fit in its column
+        auto Append(const Finding& aFinding)
+            -> void;
+
+        auto Get(std::size_t aRow) const
+            -> Finding;
+
+        auto Va(std::size_t aRow) const
+            -> std::uint64_t;
+
+        // Orders the rows by address with an LSD radix sort. The passes over
+        // digits which all rows share, such as the top bytes of kernel
+        // addresses, are skipped. The sort is stable, so the rows of one
+        // address stay in the order they were found.
+        auto SortByAddress()
+            -> void;
+
+        // Merges the rows of the same page found by both phases, or by a
+        // large page and its slices: the rows must be sorted by address, and
+        // every run of rows whose [Va, Va + Size) overlap becomes a single
+        // row which covers all of them, with the sources of all of them, the
+        // tag of the first big pool entry, the first context, and the id and
+        // scores of its first row. Returns the number of rows removed.
+        auto MergeOverlapping()
+            -> std::size_t;
+    };
+
+}
@@ -0,0 +1,416 @@
+#include "ContextCipher.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if SUNSTRIDER_X86
+#include <immintrin.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    // The first 8 qwords of CmpAppendDllSection: xor cs:[rcx], rdx and
+    // xor [rcx+8], rdx to xor [rcx+78h], rdx
+    static const std::uint8_t KNOWN_CODE[] =
+    {
+        0x2E, 0x48, 0x31, 0x11, 0x48, 0x31, 0x51, 0x08,
+        0x48, 0x31, 0x51, 0x10, 0x48, 0x31, 0x51, 0x18,
+        0x48, 0x31, 0x51, 0x20, 0x48, 0x31, 0x51, 0x28,
+        0x48, 0x31, 0x51, 0x30, 0x48, 0x31, 0x51, 0x38,
+        0x48, 0x31, 0x51, 0x40, 0x48, 0x31, 0x51, 0x48,
+        0x48, 0x31, 0x51, 0x50, 0x48, 0x31, 0x51, 0x58,
+        0x48, 0x31, 0x51, 0x60, 0x48, 0x31, 0x51, 0x68,
+        0x48, 0x31, 0x51, 0x70, 0x48, 0x31, 0x51, 0x78,
+    };
+
+    constexpr std::size_t KNOWN_CODE_QWORDS = sizeof(KNOWN_CODE) / sizeof(std::uint64_t);
+
+    constexpr std::size_t CONTEXT_HEADER_QWORDS = CONTEXT_HEADER_BYTES / sizeof(std::uint64_t);
+
+    // ContextSizeInQWord is the upper half of the last qword of the header
+    constexpr std::size_t CONTEXT_SIZE_QWORD = CONTEXT_HEADER_QWORDS - 1;
+
+    constexpr std::uint64_t KERNEL_ADDRESS_START = 0xFFFF800000000000ull;
+
+    static inline auto LoadQword(const std::uint8_t* aAddress)
+        -> std::uint64_t
+    {
+        std::uint64_t vQword;
+        memcpy(&vQword, aAddress, sizeof(vQword));
+        return vQword;
+    }
+
+    static inline auto StoreQword(std::uint8_t* aAddress, std::uint64_t aQword)
+        -> void
+    {
+        memcpy(aAddress, &aQword, sizeof(aQword));
+    }
+
+    static inline auto RotateRight(std::uint64_t aValue, std::uint32_t aBits)
+        -> std::uint64_t
+    {
+        aBits &= 63;
+        return aBits ? (aValue >> aBits) | (aValue << (64 - aBits)) : aValue;
+    }
+
+    // The xor of the first two qwords of the code, which is the xor of the
+    // first two encrypted qwords whatever the key is
+    static auto GetKnownDifference()
+        -> std::uint64_t
+    {
+        return LoadQword(KNOWN_CODE) ^ LoadQword(KNOWN_CODE + sizeof(std::uint64_t));
+    }
+
+    // The key is rotated by i & 63 for i = n, ..., aIndex + 1, which is
+    // (n + ... + aIndex + 1) modulo 64
+    static inline auto GetTriangularNumber(std::uint64_t aValue)
+        -> std::uint64_t
+    {
+        return aValue * (aValue + 1) / 2;
+    }
+
+    auto GetKeyRotation(std::uint32_t aContextSizeInQWord, std::uint64_t aIndex)
+        -> std::uint32_t
+    {
+        return static_cast<std::uint32_t>((GetTriangularNumber(aContextSizeInQWord) - GetTriangularNumber(aIndex)) & 63);
+    }
+
+    auto GetContextBytes(const ContextKey& aKey)
+        -> std::uint64_t
+    {
+        return CONTEXT_HEADER_BYTES + static_cast<std::uint64_t>(aKey.ContextSizeInQWord) * sizeof(std::uint64_t);
+    }
+
+    // Checks the whole known code, the size and the first field of the
+    // context at aOffset, once the first two qwords have matched. The first
+    // field follows the reserved qwords of the header, if any.
+    static auto IsContextAt(
+        const std::uint8_t* aContents,
+        std::size_t         aSize,
+        std::size_t         aOffset,
+        std::uint64_t       aRegionSize,
+        ContextKey&         aKey)
+        -> bool
+    {
+        const auto vCursor = aContents + aOffset;
+        const auto vKey = LoadQword(vCursor) ^ LoadQword(KNOWN_CODE);
+
+        for (std::size_t i = 1; i < KNOWN_CODE_QWORDS; ++i)
+        {
+            const auto vOffset = i * sizeof(std::uint64_t);
+            if ((LoadQword(vCursor + vOffset) ^ vKey) != LoadQword(KNOWN_CODE + vOffset))
+            {
+                return false;
+            }
+        }
+
+        const auto vSize = static_cast<std::uint32_t>(
+            (LoadQword(vCursor + CONTEXT_SIZE_QWORD * sizeof(std::uint64_t)) ^ vKey) >> 32);
+        if (!vSize ||
+            aRegionSize < aOffset + CONTEXT_HEADER_BYTES ||
+            (aRegionSize - aOffset - CONTEXT_HEADER_BYTES) / sizeof(std::uint64_t) < vSize)
+        {
+            return false;
+        }
+
+        auto vHasKernelAddress = false;
+        for (std::uint32_t i = 1; i <= CONTEXT_RESERVED_QWORDS + 1 && i <= vSize && !vHasKernelAddress; ++i)
+        {
+            const auto vFieldOffset = aOffset + CONTEXT_HEADER_BYTES + (i - 1) * sizeof(std::uint64_t);
+            if (vFieldOffset + sizeof(std::uint64_t) > aSize)
+            {
+                break;
+            }
+
+            const auto vField = LoadQword(aContents + vFieldOffset) ^
+                RotateRight(vKey, GetKeyRotation(vSize, i));
+            vHasKernelAddress = vField >= KERNEL_ADDRESS_START;
+        }
+        if (!vHasKernelAddress)
+        {
+            return false;
+        }
+
+        aKey = ContextKey{ aOffset, vKey, vSize };
+        return true;
+    }
+
+    // The header and a qword, which are needed to probe a context, although
+    // the reserved qwords of Windows 10 may hide the first field then
+    constexpr std::size_t MINIMUM_PROBE_BYTES = CONTEXT_HEADER_BYTES + sizeof(std::uint64_t);
+
+    // The number of qword offsets at which a context can be probed
+    static inline auto GetNumberOfOffsets(std::size_t aSize)
+        -> std::size_t
+    {
+        return aSize < MINIMUM_PROBE_BYTES ? 0 : (aSize - MINIMUM_PROBE_BYTES) / sizeof(std::uint64_t) + 1;
+    }
+
+    // Tests the offsets from aFirst to aLast one by one
+    static auto FindContextFrom(
+        const std::uint8_t* aContents,
+        std::size_t         aSize,
+        std::size_t         aFirst,
+        std::size_t         aLast,
+        std::uint64_t       aRegionSize,
+        ContextKey&         aKey)
+        -> bool
+    {
+        const auto vDifference = GetKnownDifference();
+
+        for (auto i = aFirst; i < aLast; ++i)
+        {
+            const auto vOffset = i * sizeof(std::uint64_t);
+            if ((LoadQword(aContents + vOffset) ^ LoadQword(aContents + vOffset + sizeof(std::uint64_t))) == vDifference &&
+                IsContextAt(aContents, aSize, vOffset, aRegionSize, aKey))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    auto RecoverContextKeyScalar(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool
+    {
+        const auto vContents = static_cast<const std::uint8_t*>(aContents);
+        return FindContextFrom(vContents, aSize, 0, GetNumberOfOffsets(aSize), aRegionSize, aKey);
+    }
+
+#if SUNSTRIDER_X86
+
+    // Tests 2 offsets at once. SSE2 has no 64-bit comparison, so both
+    // halves of a lane have to match.
+    static auto RecoverContextKeySse2(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool
+    {
+        const auto vContents = static_cast<const std::uint8_t*>(aContents);
+        const auto vOffsets = GetNumberOfOffsets(aSize);
+        const auto vDifference = _mm_set1_epi64x(static_cast<long long>(GetKnownDifference()));
+
+        std::size_t i = 0;
+        for (; i + 2 <= vOffsets; i += 2)
+        {
+            const auto vCursor = vContents + i * sizeof(std::uint64_t);
+            const auto vLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vCursor));
+            const auto vHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vCursor + sizeof(std::uint64_t)));
+            const auto vMask = static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi32(_mm_xor_si128(vLow, vHigh), vDifference)));
+
+            for (std::size_t j = 0; j < 2; ++j)
+            {
+                if (((vMask >> (j * 8)) & 0xff) == 0xff &&
+                    IsContextAt(vContents, aSize, (i + j) * sizeof(std::uint64_t), aRegionSize, aKey))
+                {
+                    return true;
+                }
+            }
+        }
+
+        return FindContextFrom(vContents, aSize, i, vOffsets, aRegionSize, aKey);
+    }
+
+    // Tests 4 offsets at once
+    SUNSTRIDER_TARGET_AVX2
+    static auto RecoverContextKeyAvx2(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool
+    {
+        const auto vContents = static_cast<const std::uint8_t*>(aContents);
+        const auto vOffsets = GetNumberOfOffsets(aSize);
+        const auto vDifference = _mm256_set1_epi64x(static_cast<long long>(GetKnownDifference()));
+
+        std::size_t i = 0;
+        for (; i + 4 <= vOffsets; i += 4)
+        {
+            const auto vCursor = vContents + i * sizeof(std::uint64_t);
+            const auto vLow = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor));
+            const auto vHigh = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vCursor + sizeof(std::uint64_t)));
+            const auto vMask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(
+                _mm256_cmpeq_epi64(_mm256_xor_si256(vLow, vHigh), vDifference))));
+
+            for (std::size_t j = 0; vMask >> j; ++j)
+            {
+                if (((vMask >> j) & 1) &&
+                    IsContextAt(vContents, aSize, (i + j) * sizeof(std::uint64_t), aRegionSize, aKey))
+                {
+                    return true;
+                }
+            }
+        }
+
+        return FindContextFrom(vContents, aSize, i, vOffsets, aRegionSize, aKey);
+    }
+
+#endif
+
+    // The header qwords of [aFirst, aFirst + aCount) are xored with the key,
+    // and the ones out of the context are copied. Returns the first qword of
+    // the body which is left.
+    static auto DecryptHeader(
+        const std::uint8_t* aContext,
+        std::uint8_t*       aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t&        aCount)
+        -> std::uint64_t
+    {
+        const auto vEnd = CONTEXT_HEADER_QWORDS + static_cast<std::uint64_t>(aKey.ContextSizeInQWord);
+
+        auto i = aFirst;
+        for (; i < aFirst + aCount && i < CONTEXT_HEADER_QWORDS; ++i)
+        {
+            const auto vOffset = (i - aFirst) * sizeof(std::uint64_t);
+            StoreQword(aDecrypted + vOffset, LoadQword(aContext + vOffset) ^ aKey.Key);
+        }
+
+        const auto vBodyEnd = std::max(i, std::min(aFirst + aCount, vEnd));
+        if (aContext != aDecrypted && vBodyEnd < aFirst + aCount)
+        {
+            const auto vOffset = (vBodyEnd - aFirst) * sizeof(std::uint64_t);
+            memcpy(aDecrypted + vOffset, aContext + vOffset, (aFirst + aCount - vBodyEnd) * sizeof(std::uint64_t));
+        }
+
+        aCount = static_cast<std::size_t>(vBodyEnd - i);
+        return i;
+    }
+
+    auto DecryptContextScalar(
+        const void*         aContext,
+        void*               aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t         aCount)
+        -> void
+    {
+        const auto vContext = static_cast<const std::uint8_t*>(aContext);
+        const auto vDecrypted = static_cast<std::uint8_t*>(aDecrypted);
+
+        const auto vBody = DecryptHeader(vContext, vDecrypted, aKey, aFirst, aCount);
+
+        // Qword q of the context is the qword q - 0x18 of the body, and the
+        // key goes back by (q - 0x18) & 63 bits from one qword to the next
+        auto vRotation = GetKeyRotation(aKey.ContextSizeInQWord, vBody - CONTEXT_SIZE_QWORD);
+        for (auto q = vBody; q < vBody + aCount; ++q)
+        {
+            const auto vOffset = (q - aFirst) * sizeof(std::uint64_t);
+            StoreQword(vDecrypted + vOffset, LoadQword(vContext + vOffset) ^ RotateRight(aKey.Key, vRotation));
+
+            vRotation = (vRotation - static_cast<std::uint32_t>(q + 1 - CONTEXT_SIZE_QWORD)) & 63;
+        }
+    }
+
+#if SUNSTRIDER_X86
+
+    // Decrypts 4 qwords at once. The rotation of each lane comes from its
+    // index, as (T(n) - T(i)) & 63 where T(i) = i * (i + 1) / 2, with
+    // 32-bit indexes so that _mm256_mul_epu32 gives the whole product.
+    SUNSTRIDER_TARGET_AVX2
+    static auto DecryptContextAvx2(
+        const void*         aContext,
+        void*               aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t         aCount)
+        -> void
+    {
+        const auto vContext = static_cast<const std::uint8_t*>(aContext);
+        const auto vDecrypted = static_cast<std::uint8_t*>(aDecrypted);
+
+        const auto vBody = DecryptHeader(vContext, vDecrypted, aKey, aFirst, aCount);
+        const auto vFirstIndex = vBody - CONTEXT_SIZE_QWORD;
+
+        const auto vKey     = _mm256_set1_epi64x(static_cast<long long>(aKey.Key));
+        const auto vTotal   = _mm256_set1_epi64x(static_cast<long long>(GetTriangularNumber(aKey.ContextSizeInQWord)));
+        const auto vOne     = _mm256_set1_epi64x(1);
+        const auto vFour    = _mm256_set1_epi64x(4);
+        const auto vMask    = _mm256_set1_epi64x(63);
+        const auto vWidth   = _mm256_set1_epi64x(64);
+
+        auto vIndex = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(vFirstIndex)), _mm256_set_epi64x(3, 2, 1, 0));
+
+        std::size_t i = 0;
+        for (; i + 4 <= aCount; i += 4)
+        {
+            const auto vTriangular = _mm256_srli_epi64(_mm256_mul_epu32(vIndex, _mm256_add_epi64(vIndex, vOne)), 1);
+            const auto vRotation = _mm256_and_si256(_mm256_sub_epi64(vTotal, vTriangular), vMask);
+
+            // A shift by 64 gives 0, so no rotation needs no special case
+            const auto vRotatedKey = _mm256_or_si256(
+                _mm256_srlv_epi64(vKey, vRotation),
+                _mm256_sllv_epi64(vKey, _mm256_sub_epi64(vWidth, vRotation)));
+
+            const auto vOffset = (vBody - aFirst + i) * sizeof(std::uint64_t);
+            const auto vQwords = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(vContext + vOffset));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(vDecrypted + vOffset), _mm256_xor_si256(vQwords, vRotatedKey));
+
+            vIndex = _mm256_add_epi64(vIndex, vFour);
+        }
+
+        for (; i < aCount; ++i)
+        {
+            const auto vOffset = (vBody - aFirst + i) * sizeof(std::uint64_t);
+            const auto vRotation = GetKeyRotation(aKey.ContextSizeInQWord, vFirstIndex + i);
+            StoreQword(vDecrypted + vOffset, LoadQword(vContext + vOffset) ^ RotateRight(aKey.Key, vRotation));
+        }
+    }
+
+#endif
+
+    auto DecryptContext(
+        const void*         aContext,
+        void*               aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t         aCount)
+        -> void
+    {
+        using DecryptContextRoutine = void(*)(const void*, void*, const ContextKey&, std::uint64_t, std::size_t);
+
+#if SUNSTRIDER_X86
+        static const auto sDecryptContext = IsAvx2Supported()
+            ? static_cast<DecryptContextRoutine>(&DecryptContextAvx2)
+            : static_cast<DecryptContextRoutine>(&DecryptContextScalar);
+#else
+        static const auto sDecryptContext = static_cast<DecryptContextRoutine>(&DecryptContextScalar);
+#endif
+
+        sDecryptContext(aContext, aDecrypted, aKey, aFirst, aCount);
+    }
+
+    auto RecoverContextKey(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool
+    {
+        using RecoverContextKeyRoutine = bool(*)(const void*, std::size_t, std::uint64_t, ContextKey&);
+
+#if SUNSTRIDER_X86
+        static const auto sRecoverContextKey = IsAvx2Supported()
+            ? static_cast<RecoverContextKeyRoutine>(&RecoverContextKeyAvx2)
+            : static_cast<RecoverContextKeyRoutine>(&RecoverContextKeySse2);
+#else
+        static const auto sRecoverContextKey = static_cast<RecoverContextKeyRoutine>(&RecoverContextKeyScalar);
+#endif
+
+        return sRecoverContextKey(aContents, aSize, aRegionSize, aKey);
+    }
+
+}
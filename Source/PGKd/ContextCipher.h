@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace Sunstrider
+{
+
+    // An encrypted PatchGuard context starts with a copy of
+    // CmpAppendDllSection, whose instructions decrypt the context:
+    //
+    //   2E 48 31 11        xor     cs:[rcx], rdx
+    //   48 31 51 08        xor     [rcx+8], rdx
+    //   ...
+    //   48 31 51 78        xor     [rcx+78h], rdx
+    //   ...
+    //   for (i = ContextSizeInQWord; i; --i)
+    //       Context[0xC0 + i * 8] ^= Key, Key = ror(Key, i)
+    //
+    // The header (the code and ContextSizeInQWord) is xored with the key
+    // qword by qword, and the rest is xored with a key rotated after each
+    // qword. Since the first qwords of the code are known, the key is their
+    // xor with the encrypted ones.
+    struct ContextKey
+    {
+        std::uint64_t Offset;               // Where the context starts in the contents
+        std::uint64_t Key;
+        std::uint32_t ContextSizeInQWord;
+    };
+
+    // sizeof(PGContextHeader)
+    constexpr std::size_t CONTEXT_HEADER_BYTES = 0xC8;
+
+    // The header of Windows 10 is followed by up to 4 reserved qwords
+    // (wdk::build_15063::PGContextHeader), before the first field of the
+    // context (ExAcquireResourceSharedLite in every build)
+    constexpr std::size_t CONTEXT_RESERVED_QWORDS = 4;
+
+    // The header, and the qwords which may be the first field, one of which
+    // has to decrypt to a kernel address
+    constexpr std::size_t CONTEXT_PROBE_BYTES =
+        CONTEXT_HEADER_BYTES + (CONTEXT_RESERVED_QWORDS + 1) * sizeof(std::uint64_t);
+
+    // Searches aContents for an encrypted context at every qword, and
+    // recovers its key from the known code. A context is only reported when
+    // the whole known code decrypts with that key, ContextSizeInQWord fits in
+    // the aRegionSize bytes which start at aContents, and its first field
+    // decrypts to a kernel address with the rotated key, wherever the header
+    // of the build ends.
+    //
+    // Offsets are first tested in bulk with AVX2 or SSE2, selected at
+    // runtime, by the xor of two neighbouring qwords, which does not depend
+    // on the key. Returns false if no context was found.
+    auto RecoverContextKey(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool;
+
+    // The portable implementation, used as the reference of the vectorized ones
+    auto RecoverContextKeyScalar(
+        const void*     aContents,
+        std::size_t     aSize,
+        std::uint64_t   aRegionSize,
+        ContextKey&     aKey)
+        -> bool;
+
+    // The number of bits the key has been rotated by when the decryption
+    // loop reaches the qword aIndex (1 to ContextSizeInQWord) of the body.
+    // The rotations add up to a triangular number modulo 64, so any qword
+    // can be decrypted without the ones before it.
+    auto GetKeyRotation(std::uint32_t aContextSizeInQWord, std::uint64_t aIndex)
+        -> std::uint32_t;
+
+    // The header and the body of the context of aKey, in bytes
+    auto GetContextBytes(const ContextKey& aKey)
+        -> std::uint64_t;
+
+    // Decrypts aCount qwords of the context of aKey from the qword aFirst
+    // (0 is the start of the header). aContext and aDecrypted point to the
+    // qword aFirst, and may be the same buffer. Qwords out of the context
+    // are copied unchanged.
+    //
+    // Vectorized with AVX2, selected at runtime, as the key of every qword
+    // is rotated by a different number of bits.
+    auto DecryptContext(
+        const void*         aContext,
+        void*               aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t         aCount)
+        -> void;
+
+    // The portable implementation, used as the reference of the vectorized one
+    auto DecryptContextScalar(
+        const void*         aContext,
+        void*               aDecrypted,
+        const ContextKey&   aKey,
+        std::uint64_t       aFirst,
+        std::size_t         aCount)
+        -> void;
+
+}
@@ -0,0 +1,69 @@
+#include "ContextDecryptor.h"
+
+#include <algorithm>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::size_t ContextDecryptor::SLICE_QWORDS;
+
+    auto ContextDecryptor::DecryptSlice(std::size_t aSlice)
+        -> void
+    {
+        const auto& vSlice = _Slices[aSlice];
+        const auto& vContext = _Contexts[vSlice.Context];
+        const auto vOffset = static_cast<std::size_t>(vSlice.First * sizeof(std::uint64_t));
+
+        DecryptContext(
+            static_cast<const std::uint8_t*>(vContext.Context) + vOffset,
+            _Images[vSlice.Context].data() + vOffset,
+            vContext.Key,
+            vSlice.First,
+            vSlice.Count);
+    }
+
+    auto ContextDecryptor::Decrypt(WorkStealingPool& aPool, const EncryptedContext* aContexts, std::size_t aCount)
+        -> void
+    {
+        _Contexts = aContexts;
+        _NumberOfContexts = aCount;
+        _Images.resize(std::max(_Images.size(), aCount));
+        _Slices.clear();
+
+        for (std::size_t i = 0; i < aCount; ++i)
+        {
+            const auto vQwords = GetContextBytes(aContexts[i].Key) / sizeof(std::uint64_t);
+            _Images[i].resize(static_cast<std::size_t>(vQwords * sizeof(std::uint64_t)));
+
+            for (std::uint64_t vFirst = 0; vFirst < vQwords; vFirst += SLICE_QWORDS)
+            {
+                _Slices.push_back(Slice{ i, vFirst, static_cast<std::size_t>(std::min<std::uint64_t>(SLICE_QWORDS, vQwords - vFirst)) });
+            }
+        }
+
+        // The tasks only capture this and an index, so that they are not
+        // allocated by std::function
+        for (std::size_t i = 0; i < _Slices.size(); ++i)
+        {
+            aPool.Submit([this, i](std::size_t)
+            {
+                DecryptSlice(i);
+            });
+        }
+        aPool.Wait();
+    }
+
+    auto ContextDecryptor::Image(std::size_t aContext) const
+        -> const std::uint8_t*
+    {
+        return _Images[aContext].data();
+    }
+
+    auto ContextDecryptor::ImageSize(std::size_t aContext) const
+        -> std::size_t
+    {
+        return aContext < _NumberOfContexts ? _Images[aContext].size() : 0;
+    }
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "ContextCipher.h"
+#include "WorkStealingPool.h"
+
+
+namespace Sunstrider
+{
+
+    // Decrypts many contexts at once on a pool.
+    //
+    // Every context is split into slices, so that the workers share a large
+    // one, and is decrypted into an image which is kept from a call to the
+    // next: once the images are large enough, decrypting the contexts of the
+    // next scan does not allocate. An image starts with the header, so it can
+    // be read as a wdk::build_XXXX::PGContext.
+    class ContextDecryptor
+    {
+    public:
+        struct EncryptedContext
+        {
+            const void* Context;    // The header, followed by the rest of GetContextBytes(Key) bytes
+            ContextKey  Key;
+        };
+
+        // The qwords decrypted by a task (64KB)
+        static constexpr std::size_t SLICE_QWORDS = 0x2000;
+
+    private:
+        struct Slice
+        {
+            std::size_t     Context;
+            std::uint64_t   First;
+            std::size_t     Count;
+        };
+
+        const EncryptedContext*                 _Contexts = nullptr;
+        std::size_t                             _NumberOfContexts = 0;
+        std::vector<std::vector<std::uint8_t>>  _Images;
+        std::vector<Slice>                      _Slices;
+
+        auto DecryptSlice(std::size_t aSlice)
+            -> void;
+
+    public:
+        // Decrypts aContexts into images, which are valid until the next call.
+        // Throws what a task threw.
+        auto Decrypt(WorkStealingPool& aPool, const EncryptedContext* aContexts, std::size_t aCount)
+            -> void;
+
+        auto Image(std::size_t aContext) const
+            -> const std::uint8_t*;
+
+        auto ImageSize(std::size_t aContext) const
+            -> std::size_t;
+    };
+
+}
@@ -0,0 +1,468 @@
+#include "ContextLayout.h"
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::uint32_t ContextLayouts::FORMAT_VERSION;
+
+    static const char* const CONTEXT_FIELD_NAMES[NUMBER_OF_CONTEXT_FIELDS] =
+    {
+        "ContextSizeInQWord",
+        "PGPageBase",
+        "Prcb",
+        "DcpRoutineToBeScheduled",
+        "WorkerRoutine",
+        "OffsetOfPGSelfValidation",
+        "OffsetOfRtlLookupFunctionEntryEx",
+        "OffsetOfFsRtlUninitializeSmallMcb",
+        "OffsetOfFsRtlUnknown0",
+        "OffsetOfFsRtlUnkonwn1",
+        "OffsetOfPGProtectCode2Table",
+        "IsTiggerPG",
+        "BugCheckArg0",
+        "BugCheckArg1",
+        "BugCheckArg2",
+        "BugCheckArg3",
+        "PGProtectStrings.Strings",
+        "NumberOfProtectCodes",
+        "NumberOfProtectValues",
+    };
+
+    static const struct
+    {
+        const char* Name;
+        FieldKind   Kind;
+    } FIELD_KIND_NAMES[] =
+    {
+        { "qword",      FIELD_QWORD,    },
+        { "dword",      FIELD_DWORD,    },
+        { "offset",     FIELD_OFFSET,   },
+        { "location",   FIELD_LOCATION, },
+    };
+
+    // The bytes read for a field of aKind
+    static auto GetFieldBytes(FieldKind aKind)
+        -> std::uint32_t
+    {
+        switch (aKind)
+        {
+        case FIELD_QWORD:   return sizeof(std::uint64_t);
+        case FIELD_DWORD:
+        case FIELD_OFFSET:  return sizeof(std::uint32_t);
+        default:            return 0;
+        }
+    }
+
+    static auto GetFieldKindName(FieldKind aKind)
+        -> const char*
+    {
+        for (const auto& vKind : FIELD_KIND_NAMES)
+        {
+            if (vKind.Kind == aKind)
+            {
+                return vKind.Name;
+            }
+        }
+        return "absent";
+    }
+
+    static auto FormatHex(std::uint32_t aValue, unsigned aDigits)
+        -> std::string
+    {
+        char vBuffer[16];
+        snprintf(vBuffer, sizeof(vBuffer), "0x%0*X", aDigits, aValue);
+        return vBuffer;
+    }
+
+    auto GetContextFieldName(ContextField aField)
+        -> const char*
+    {
+        return aField < NUMBER_OF_CONTEXT_FIELDS ? CONTEXT_FIELD_NAMES[aField] : "Unknown";
+    }
+
+    auto ContextLayout::Has(ContextField aField) const
+        -> bool
+    {
+        return Kinds[aField] != FIELD_ABSENT;
+    }
+
+    auto ContextLayout::Read(const std::uint8_t* aContext, std::uint64_t aAddress, ContextField aField) const
+        -> std::uint64_t
+    {
+        const auto vCursor = aContext + Offsets[aField];
+
+        switch (Kinds[aField])
+        {
+        case FIELD_QWORD:
+        {
+            std::uint64_t vValue;
+            memcpy(&vValue, vCursor, sizeof(vValue));
+            return vValue;
+        }
+
+        case FIELD_DWORD:
+        {
+            std::uint32_t vValue;
+            memcpy(&vValue, vCursor, sizeof(vValue));
+            return vValue;
+        }
+
+        case FIELD_OFFSET:
+        {
+            std::uint32_t vValue;
+            memcpy(&vValue, vCursor, sizeof(vValue));
+            return vValue ? aAddress + vValue : 0;
+        }
+
+        case FIELD_LOCATION:
+            return aAddress + Offsets[aField];
+
+        default:
+            return 0;
+        }
+    }
+
+    static auto ParseNumber(const std::string& aToken)
+        -> std::uint64_t
+    {
+        std::size_t vEnd = 0;
+        auto vValue = 0ull;
+        try
+        {
+            vValue = std::stoull(aToken, &vEnd, 0);
+        }
+        catch (const std::exception&)
+        {
+            vEnd = 0;
+        }
+        if (aToken.empty() || vEnd != aToken.length() || vValue > 0xFFFFFFFFull)
+        {
+            throw std::runtime_error("'" + aToken + "' is not a number.");
+        }
+        return vValue;
+    }
+
+    // The checks of a layout once its end has been read
+    static auto ValidateLayout(const ContextLayout& aLayout)
+        -> void
+    {
+        if (aLayout.Builds.empty())
+        {
+            throw std::runtime_error("The layout " + aLayout.Name + " has no builds.");
+        }
+        if (aLayout.HeaderBytes == 0 || aLayout.HeaderBytes > aLayout.ContextBytes)
+        {
+            throw std::runtime_error("The header of the layout " + aLayout.Name + " does not fit in its size.");
+        }
+
+        // In 64 bits, as an offset near 4GB would wrap past the check
+        for (std::uint32_t i = 0; i < NUMBER_OF_CONTEXT_FIELDS; ++i)
+        {
+            if (aLayout.Kinds[i] != FIELD_ABSENT &&
+                static_cast<std::uint64_t>(aLayout.Offsets[i]) + GetFieldBytes(aLayout.Kinds[i]) > aLayout.ContextBytes)
+            {
+                throw std::runtime_error(std::string("The field ") + CONTEXT_FIELD_NAMES[i] +
+                    " of the layout " + aLayout.Name + " does not fit in its size.");
+            }
+        }
+    }
+
+    auto ContextLayouts::Load(std::istream& aStream)
+        -> void
+    {
+        auto vLayouts = std::vector<ContextLayout>();
+        auto vLayout = static_cast<ContextLayout*>(nullptr);
+        auto vHasVersion = false;
+        auto vLineNumber = 0u;
+
+        try
+        {
+            for (std::string vLine; std::getline(aStream, vLine); )
+            {
+                ++vLineNumber;
+
+                const auto vComment = vLine.find('#');
+                if (vComment != std::string::npos)
+                {
+                    vLine.resize(vComment);
+                }
+
+                std::istringstream vTokens(vLine);
+                auto vKeyword = std::string();
+                if (!(vTokens >> vKeyword))
+                {
+                    continue;
+                }
+
+                auto vArguments = std::vector<std::string>();
+                for (std::string vToken; vTokens >> vToken; )
+                {
+                    vArguments.push_back(vToken);
+                }
+
+                if (!vHasVersion)
+                {
+                    if (vKeyword != "PGContextLayouts" || vArguments.size() != 1)
+                    {
+                        throw std::runtime_error("A layout file starts with 'PGContextLayouts <version>'.");
+                    }
+                    if (ParseNumber(vArguments[0]) != FORMAT_VERSION)
+                    {
+                        throw std::runtime_error("The version " + vArguments[0] + " of the format is not supported.");
+                    }
+                    vHasVersion = true;
+                    continue;
+                }
+
+                if (vKeyword == "layout")
+                {
+                    if (vLayout)
+                    {
+                        throw std::runtime_error("The layout " + vLayout->Name + " has no end.");
+                    }
+                    if (vArguments.size() != 1 && (vArguments.size() != 3 || vArguments[1] != ":"))
+                    {
+                        throw std::runtime_error("Expected 'layout <name> [: <layout>]'.");
+                    }
+
+                    const auto vIsSameName = [&vArguments](const ContextLayout& aLayout) { return aLayout.Name == vArguments[0]; };
+                    if (std::any_of(vLayouts.begin(), vLayouts.end(), vIsSameName))
+                    {
+                        throw std::runtime_error("The layout " + vArguments[0] + " is defined twice.");
+                    }
+
+                    auto vNewLayout = ContextLayout{};
+                    if (vArguments.size() == 3)
+                    {
+                        const auto vIsBase = [&vArguments](const ContextLayout& aLayout) { return aLayout.Name == vArguments[2]; };
+                        const auto vBase = std::find_if(vLayouts.begin(), vLayouts.end(), vIsBase);
+                        if (vBase == vLayouts.end())
+                        {
+                            throw std::runtime_error("The layout " + vArguments[2] + " is not defined before.");
+                        }
+
+                        // The builds are those of the base only
+                        vNewLayout = *vBase;
+                        vNewLayout.Builds.clear();
+                    }
+                    vNewLayout.Name = vArguments[0];
+
+                    vLayouts.push_back(std::move(vNewLayout));
+                    vLayout = &vLayouts.back();
+                    continue;
+                }
+
+                if (!vLayout)
+                {
+                    throw std::runtime_error("'" + vKeyword + "' is out of a layout.");
+                }
+
+                if (vKeyword == "end" && vArguments.empty())
+                {
+                    ValidateLayout(*vLayout);
+                    vLayout = nullptr;
+                }
+                else if (vKeyword == "builds" && !vArguments.empty())
+                {
+                    for (const auto& vArgument : vArguments)
+                    {
+                        vLayout->Builds.push_back(static_cast<std::uint32_t>(ParseNumber(vArgument)));
+                    }
+                }
+                else if (vKeyword == "size" && vArguments.size() == 1)
+                {
+                    vLayout->ContextBytes = static_cast<std::uint32_t>(ParseNumber(vArguments[0]));
+                }
+                else if (vKeyword == "header" && vArguments.size() == 1)
+                {
+                    vLayout->HeaderBytes = static_cast<std::uint32_t>(ParseNumber(vArguments[0]));
+                }
+                else if (vKeyword == "field" && vArguments.size() == 3)
+                {
+                    const auto vName = std::find(std::begin(CONTEXT_FIELD_NAMES), std::end(CONTEXT_FIELD_NAMES), vArguments[0]);
+                    if (vName == std::end(CONTEXT_FIELD_NAMES))
+                    {
+                        throw std::runtime_error("The field " + vArguments[0] + " is unknown.");
+                    }
+
+                    const auto vIsKind = [&vArguments](decltype(FIELD_KIND_NAMES[0])& aKind) { return vArguments[2] == aKind.Name; };
+                    const auto vKind = std::find_if(std::begin(FIELD_KIND_NAMES), std::end(FIELD_KIND_NAMES), vIsKind);
+                    if (vKind == std::end(FIELD_KIND_NAMES))
+                    {
+                        throw std::runtime_error("The kind " + vArguments[2] + " is unknown.");
+                    }
+
+                    const auto vField = static_cast<std::size_t>(vName - std::begin(CONTEXT_FIELD_NAMES));
+                    vLayout->Offsets[vField] = static_cast<std::uint32_t>(ParseNumber(vArguments[1]));
+                    vLayout->Kinds[vField] = vKind->Kind;
+                }
+                else
+                {
+                    throw std::runtime_error("'" + vKeyword + "' is unknown, or has wrong arguments.");
+                }
+            }
+
+            if (!vHasVersion)
+            {
+                throw std::runtime_error("A layout file starts with 'PGContextLayouts <version>'.");
+            }
+            if (vLayout)
+            {
+                throw std::runtime_error("The layout " + vLayout->Name + " has no end.");
+            }
+        }
+        catch (const std::runtime_error& aWhat)
+        {
+            throw std::runtime_error("Line " + std::to_string(vLineNumber) + " of the layouts: " + aWhat.what());
+        }
+
+        _Layouts = std::move(vLayouts);
+    }
+
+    auto ContextLayouts::LoadFile(const std::string& aPath)
+        -> void
+    {
+        std::ifstream vFile(aPath);
+        if (!vFile)
+        {
+            throw std::runtime_error("The layouts could not be read from " + aPath + ".");
+        }
+        Load(vFile);
+    }
+
+    auto ContextLayouts::Append(const std::vector<ContextLayout>& aLayouts)
+        -> void
+    {
+        _Layouts.insert(_Layouts.end(), aLayouts.begin(), aLayouts.end());
+    }
+
+    auto ContextLayouts::Clear()
+        -> void
+    {
+        _Layouts.clear();
+    }
+
+    auto ContextLayouts::Find(std::uint32_t aBuildNumber) const
+        -> const ContextLayout*
+    {
+        for (const auto& vLayout : _Layouts)
+        {
+            if (std::find(vLayout.Builds.begin(), vLayout.Builds.end(), aBuildNumber) != vLayout.Builds.end())
+            {
+                return &vLayout;
+            }
+        }
+        return nullptr;
+    }
+
+    auto ContextLayouts::Find(const std::string& aName) const
+        -> const ContextLayout*
+    {
+        for (const auto& vLayout : _Layouts)
+        {
+            if (vLayout.Name == aName)
+            {
+                return &vLayout;
+            }
+        }
+        return nullptr;
+    }
+
+    auto ContextLayouts::Size() const
+        -> std::size_t
+    {
+        return _Layouts.size();
+    }
+
+    auto WriteContextLayouts(std::ostream& aStream, const std::vector<ContextLayout>& aLayouts)
+        -> void
+    {
+        aStream << "PGContextLayouts " << ContextLayouts::FORMAT_VERSION << "\n";
+
+        for (const auto& vLayout : aLayouts)
+        {
+            aStream << "\nlayout  " << vLayout.Name << "\nbuilds ";
+            for (const auto vBuild : vLayout.Builds)
+            {
+                aStream << " " << vBuild;
+            }
+            aStream << "\nsize    " << FormatHex(vLayout.ContextBytes, 3)
+                    << "\nheader  " << FormatHex(vLayout.HeaderBytes, 2) << "\n";
+
+            // In the order of the members
+            auto vFields = std::vector<std::uint32_t>();
+            for (std::uint32_t i = 0; i < NUMBER_OF_CONTEXT_FIELDS; ++i)
+            {
+                if (vLayout.Kinds[i] != FIELD_ABSENT)
+                {
+                    vFields.push_back(i);
+                }
+            }
+            std::stable_sort(vFields.begin(), vFields.end(), [&vLayout](std::uint32_t aLeft, std::uint32_t aRight)
+            {
+                return vLayout.Offsets[aLeft] < vLayout.Offsets[aRight];
+            });
+
+            for (const auto vField : vFields)
+            {
+                char vLine[128];
+                snprintf(vLine, sizeof(vLine), "field   %-34s %s   %s\n",
+                    CONTEXT_FIELD_NAMES[vField],
+                    FormatHex(vLayout.Offsets[vField], 3).c_str(),
+                    GetFieldKindName(vLayout.Kinds[vField]));
+                aStream << vLine;
+            }
+            aStream << "end\n";
+        }
+    }
+
+    auto WriteLayoutDifferences(std::ostream& aStream, const ContextLayout& aOld, const ContextLayout& aNew)
+        -> bool
+    {
+        auto vDiffers = false;
+        const auto vWriteLine = [&aStream, &vDiffers](const char* aName, const std::string& aOld, const std::string& aNew)
+        {
+            char vLine[160];
+            snprintf(vLine, sizeof(vLine), "    %-34s %s -> %s\n", aName, aOld.c_str(), aNew.c_str());
+            aStream << vLine;
+            vDiffers = true;
+        };
+
+        if (aOld.ContextBytes != aNew.ContextBytes)
+        {
+            vWriteLine("size", FormatHex(aOld.ContextBytes, 3), FormatHex(aNew.ContextBytes, 3));
+        }
+        if (aOld.HeaderBytes != aNew.HeaderBytes)
+        {
+            vWriteLine("header", FormatHex(aOld.HeaderBytes, 2), FormatHex(aNew.HeaderBytes, 2));
+        }
+
+        for (std::uint32_t i = 0; i < NUMBER_OF_CONTEXT_FIELDS; ++i)
+        {
+            const auto vOldKind = aOld.Kinds[i];
+            const auto vNewKind = aNew.Kinds[i];
+            if (vOldKind == vNewKind &&
+                (vOldKind == FIELD_ABSENT || aOld.Offsets[i] == aNew.Offsets[i]))
+            {
+                continue;
+            }
+
+            const auto vOld = vOldKind == FIELD_ABSENT ? std::string("absent") :
+                FormatHex(aOld.Offsets[i], 3) + " " + GetFieldKindName(vOldKind);
+            const auto vNew = vNewKind == FIELD_ABSENT ? std::string("absent") :
+                FormatHex(aNew.Offsets[i], 3) + " " + GetFieldKindName(vNewKind);
+            vWriteLine(CONTEXT_FIELD_NAMES[i], vOld, vNew);
+        }
+
+        return vDiffers;
+    }
+
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+
+namespace Sunstrider
+{
+
+    // The fields of a PatchGuard context which !dumppg displays, named after
+    // the members of wdk::build_XXXX::PGContext in a layout file
+    enum ContextField : std::uint32_t
+    {
+        FIELD_CONTEXT_SIZE_IN_QWORD,                    // ContextSizeInQWord
+        FIELD_PG_PAGE_BASE,                             // PGPageBase
+        FIELD_PRCB,                                     // Prcb
+        FIELD_DPC_ROUTINE,                              // DcpRoutineToBeScheduled
+        FIELD_WORKER_ROUTINE,                           // WorkerRoutine
+        FIELD_OFFSET_OF_PG_SELF_VALIDATION,             // OffsetOfPGSelfValidation
+        FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX,   // OffsetOfRtlLookupFunctionEntryEx
+        FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB,   // OffsetOfFsRtlUninitializeSmallMcb
+        FIELD_OFFSET_OF_FSRTL_UNKNOWN0,                 // OffsetOfFsRtlUnknown0
+        FIELD_OFFSET_OF_FSRTL_UNKNOWN1,                 // OffsetOfFsRtlUnkonwn1
+        FIELD_OFFSET_OF_PG_PROTECT_CODE2_TABLE,         // OffsetOfPGProtectCode2Table
+        FIELD_IS_TRIGGER_PG,                            // IsTiggerPG
+        FIELD_BUG_CHECK_ARG0,                           // BugCheckArg0
+        FIELD_BUG_CHECK_ARG1,                           // BugCheckArg1
+        FIELD_BUG_CHECK_ARG2,                           // BugCheckArg2
+        FIELD_BUG_CHECK_ARG3,                           // BugCheckArg3
+        FIELD_PG_PROTECT_STRINGS,                       // PGProtectStrings.Strings
+        FIELD_NUMBER_OF_PROTECT_CODES,                  // NumberOfProtectCodes
+        FIELD_NUMBER_OF_PROTECT_VALUES,                 // NumberOfProtectValues
+
+        NUMBER_OF_CONTEXT_FIELDS,
+    };
+
+    // How a field is read
+    enum FieldKind : std::uint8_t
+    {
+        FIELD_ABSENT,       // Not in the context of this build
+        FIELD_QWORD,
+        FIELD_DWORD,
+        FIELD_OFFSET,       // A dword offset from the start of the context, 0 if there is nothing
+        FIELD_LOCATION,     // Not read: the field is a table, whose address is the value
+    };
+
+    // The layout of the context of some builds of nt, compiled from a layout
+    // file into a flat table indexed by ContextField, so that reading a field
+    // is an indexed load from the captured bytes of a context.
+    struct ContextLayout
+    {
+        std::string                                         Name;
+        std::vector<std::uint32_t>                          Builds;
+        std::uint32_t                                       ContextBytes = 0;   // sizeof(PGContext), which the Protect* tables follow
+        std::uint32_t                                       HeaderBytes = 0;    // sizeof(PGContextHeader)
+        std::array<std::uint32_t, NUMBER_OF_CONTEXT_FIELDS> Offsets{};
+        std::array<FieldKind, NUMBER_OF_CONTEXT_FIELDS>     Kinds{};
+
+        auto Has(ContextField aField) const
+            -> bool;
+
+        // aField of aContext, the ContextBytes bytes at aAddress: the value of
+        // a qword or a dword, the address an offset or a location is at, or 0
+        // if the layout does not have the field
+        auto Read(const std::uint8_t* aContext, std::uint64_t aAddress, ContextField aField) const
+            -> std::uint64_t;
+    };
+
+    // The layouts of a layout file (see PGContext.layouts):
+    //
+    //   PGContextLayouts 1
+    //
+    //   layout Windows10_1803 [: <layout>]   copies the fields of another layout
+    //   builds 17134                         the builds of nt which use it
+    //   size   0x930                         sizeof(PGContext)
+    //   header 0xE8                          sizeof(PGContextHeader)
+    //   field  Prcb 0x660 qword              a field, with its offset and kind
+    //   end
+    //
+    // The kinds are qword, dword, offset and location (see FieldKind). '#'
+    // starts a comment.
+    class ContextLayouts
+    {
+        std::vector<ContextLayout> _Layouts;
+
+    public:
+        // The version of the format, on the first line of a layout file
+        static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+        // Replaces the layouts with the ones of aStream. Throws
+        // std::runtime_error with the line of the first error, in which case
+        // the layouts are unchanged.
+        auto Load(std::istream& aStream)
+            -> void;
+
+        // Throws std::runtime_error
+        auto LoadFile(const std::string& aPath)
+            -> void;
+
+        // Adds aLayouts after the ones there are, so that a build which both
+        // have is still found in the layouts there were
+        auto Append(const std::vector<ContextLayout>& aLayouts)
+            -> void;
+
+        auto Clear()
+            -> void;
+
+        // nullptr if no layout has aBuildNumber
+        auto Find(std::uint32_t aBuildNumber) const
+            -> const ContextLayout*;
+
+        auto Find(const std::string& aName) const
+            -> const ContextLayout*;
+
+        auto Size() const
+            -> std::size_t;
+    };
+
+    auto GetContextFieldName(ContextField aField)
+        -> const char*;
+
+    // Writes aLayouts in the format of a layout file, which
+    // ContextLayouts::Load reads back
+    auto WriteContextLayouts(std::ostream& aStream, const std::vector<ContextLayout>& aLayouts)
+        -> void;
+
+    // Writes a line for each difference from aOld to aNew: their size, their
+    // header, and the fields which moved, changed their kind, or are in one
+    // of them only. Returns false if they do not differ.
+    auto WriteLayoutDifferences(std::ostream& aStream, const ContextLayout& aOld, const ContextLayout& aNew)
+        -> bool;
+
+}
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "ContextReflection.h"
+
+
+namespace Sunstrider
+{
+
+    // The definitions of the members of the specializations, and the checks
+    // of their fields, so that a field which does not match its member stops
+    // the build
+
+    constexpr char           ContextReflection<wdk::build_7601::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_7601::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_7601::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_7601::PGContext>::FIELDS, sizeof(wdk::build_7601::PGContext)),
+        "The fields of wdk::build_7601::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_9200::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_9200::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_9200::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_9200::PGContext>::FIELDS, sizeof(wdk::build_9200::PGContext)),
+        "The fields of wdk::build_9200::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_10240::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_10240::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_10240::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_10240::PGContext>::FIELDS, sizeof(wdk::build_10240::PGContext)),
+        "The fields of wdk::build_10240::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_10586::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_10586::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_10586::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_10586::PGContext>::FIELDS, sizeof(wdk::build_10586::PGContext)),
+        "The fields of wdk::build_10586::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_14393::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_14393::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_14393::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_14393::PGContext>::FIELDS, sizeof(wdk::build_14393::PGContext)),
+        "The fields of wdk::build_14393::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_15063::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_15063::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_15063::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_15063::PGContext>::FIELDS, sizeof(wdk::build_15063::PGContext)),
+        "The fields of wdk::build_15063::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_16299::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_16299::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_16299::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_16299::PGContext>::FIELDS, sizeof(wdk::build_16299::PGContext)),
+        "The fields of wdk::build_16299::PGContext are not valid.");
+
+    constexpr char           ContextReflection<wdk::build_17134::PGContext>::NAME[];
+    constexpr std::uint32_t  ContextReflection<wdk::build_17134::PGContext>::BUILDS[];
+    constexpr ReflectedField ContextReflection<wdk::build_17134::PGContext>::FIELDS[];
+    static_assert(IsReflectionValid(ContextReflection<wdk::build_17134::PGContext>::FIELDS, sizeof(wdk::build_17134::PGContext)),
+        "The fields of wdk::build_17134::PGContext are not valid.");
+
+    auto GetReflectedLayouts()
+        -> std::vector<ContextLayout>
+    {
+        return
+        {
+            MakeContextLayout<wdk::build_7601::PGContext>(),
+            MakeContextLayout<wdk::build_9200::PGContext>(),
+            MakeContextLayout<wdk::build_10240::PGContext>(),
+            MakeContextLayout<wdk::build_10586::PGContext>(),
+            MakeContextLayout<wdk::build_14393::PGContext>(),
+            MakeContextLayout<wdk::build_15063::PGContext>(),
+            MakeContextLayout<wdk::build_16299::PGContext>(),
+            MakeContextLayout<wdk::build_17134::PGContext>(),
+        };
+    }
+
+}
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "ContextLayout.h"
+
+
+namespace Sunstrider
+{
+
+    // A member of a wdk::build_XXXX::PGContext which a layout describes
+    struct ReflectedField
+    {
+        ContextField    Field;
+        const char*     Name;       // The name of the member
+        std::uint32_t   Offset;     // offsetof
+        std::uint32_t   Bytes;      // sizeof the member
+        FieldKind       Kind;
+    };
+
+    // The fields of PGContextT, known at compile time, so that the layout of
+    // a build is written once, by the compiler, from WDK.PGContext.h. Each
+    // build_XXXX::PGContext which has the fields specializes it with:
+    //
+    //   NAME       the name of its layout
+    //   BUILDS     the builds of nt which use it
+    //   FIELDS     its fields, in the order of the members
+    //
+    // A new build adds its specialization below, and its layout to
+    // PGContext.layouts, which !pglayouts writes from these.
+    template<typename PGContextT>
+    struct ContextReflection;
+
+    // A ReflectedField of the member aMember of Context, the type of the
+    // PGContext in a specialization of ContextReflection
+#define REFLECT_CONTEXT_FIELD(aField, aMember, aKind)                               \
+    ReflectedField{                                                                 \
+        aField,                                                                     \
+        #aMember,                                                                   \
+        static_cast<std::uint32_t>(offsetof(Context, aMember)),                     \
+        static_cast<std::uint32_t>(sizeof(std::declval<Context&>().aMember)),       \
+        aKind }
+
+    // True if aFields are in the order of the members, do not overlap, fit in
+    // aContextBytes, name a field once, and have the size of their kind
+    template<std::size_t N>
+    constexpr auto IsReflectionValid(const ReflectedField (&aFields)[N], std::size_t aContextBytes)
+        -> bool
+    {
+        for (std::size_t i = 0; i < N; ++i)
+        {
+            const auto& vField = aFields[i];
+
+            if (vField.Field >= NUMBER_OF_CONTEXT_FIELDS ||
+                vField.Offset + vField.Bytes > aContextBytes)
+            {
+                return false;
+            }
+            if (i && vField.Offset < aFields[i - 1].Offset + aFields[i - 1].Bytes)
+            {
+                return false;
+            }
+            for (std::size_t j = 0; j < i; ++j)
+            {
+                if (aFields[j].Field == vField.Field)
+                {
+                    return false;
+                }
+            }
+
+            switch (vField.Kind)
+            {
+            case FIELD_QWORD:
+                if (vField.Bytes != sizeof(std::uint64_t))
+                {
+                    return false;
+                }
+                break;
+
+            case FIELD_DWORD:
+            case FIELD_OFFSET:
+                if (vField.Bytes != sizeof(std::uint32_t))
+                {
+                    return false;
+                }
+                break;
+
+            case FIELD_LOCATION:
+                break;
+
+            default:
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Calls aVisitor with each ReflectedField of PGContextT, in the order of
+    // the members. Dumping, diffing or writing a build is a visitor of it.
+    template<typename PGContextT, typename VisitorT>
+    inline auto VisitContextFields(VisitorT&& aVisitor)
+        -> void
+    {
+        for (const auto& vField : ContextReflection<PGContextT>::FIELDS)
+        {
+            aVisitor(vField);
+        }
+    }
+
+    // The layout of PGContextT, as the layout file describes it
+    template<typename PGContextT>
+    inline auto MakeContextLayout()
+        -> ContextLayout
+    {
+        using Reflection = ContextReflection<PGContextT>;
+
+        auto vLayout = ContextLayout{};
+        vLayout.Name = Reflection::NAME;
+        vLayout.Builds.assign(std::begin(Reflection::BUILDS), std::end(Reflection::BUILDS));
+        vLayout.ContextBytes = static_cast<std::uint32_t>(sizeof(PGContextT));
+        vLayout.HeaderBytes = static_cast<std::uint32_t>(sizeof(typename PGContextT::PGContextHeader));
+
+        VisitContextFields<PGContextT>([&vLayout](const ReflectedField& aField)
+        {
+            vLayout.Offsets[aField.Field] = aField.Offset;
+            vLayout.Kinds[aField.Field] = aField.Kind;
+        });
+
+        return vLayout;
+    }
+
+    template<>
+    struct ContextReflection<wdk::build_7601::PGContext>
+    {
+        using Context = wdk::build_7601::PGContext;
+
+        static constexpr char           NAME[] = "Windows7";
+        static constexpr std::uint32_t  BUILDS[] = { 7600, 7601 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_PROTECT_CODE2_TABLE,       OffsetOfPGProtectCode2Table,       FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_9200::PGContext>
+    {
+        using Context = wdk::build_9200::PGContext;
+
+        static constexpr char           NAME[] = "Windows8";
+        static constexpr std::uint32_t  BUILDS[] = { 9200 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_10240::PGContext>
+    {
+        using Context = wdk::build_10240::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1507";
+        static constexpr std::uint32_t  BUILDS[] = { 10240 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_10586::PGContext>
+    {
+        using Context = wdk::build_10586::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1511";
+        static constexpr std::uint32_t  BUILDS[] = { 10586 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_14393::PGContext>
+    {
+        using Context = wdk::build_14393::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1607";
+        static constexpr std::uint32_t  BUILDS[] = { 14393 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_15063::PGContext>
+    {
+        using Context = wdk::build_15063::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1703";
+        static constexpr std::uint32_t  BUILDS[] = { 15063 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_16299::PGContext>
+    {
+        using Context = wdk::build_16299::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1709";
+        static constexpr std::uint32_t  BUILDS[] = { 16299 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    template<>
+    struct ContextReflection<wdk::build_17134::PGContext>
+    {
+        using Context = wdk::build_17134::PGContext;
+
+        static constexpr char           NAME[] = "Windows10_1803";
+        static constexpr std::uint32_t  BUILDS[] = { 17134 };
+        static constexpr ReflectedField FIELDS[] =
+        {
+            REFLECT_CONTEXT_FIELD(FIELD_CONTEXT_SIZE_IN_QWORD,                  ContextSizeInQWord,                FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_WORKER_ROUTINE,                         WorkerRoutine,                     FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PRCB,                                   Prcb,                              FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PAGE_BASE,                           PGPageBase,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_DPC_ROUTINE,                            DcpRoutineToBeScheduled,           FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_PG_SELF_VALIDATION,           OffsetOfPGSelfValidation,          FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_RTL_LOOKUP_FUNCTION_ENTRY_EX, OffsetOfRtlLookupFunctionEntryEx,  FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNINITIALIZE_SMALL_MCB, OffsetOfFsRtlUninitializeSmallMcb, FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN0,               OffsetOfFsRtlUnknown0,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_OFFSET_OF_FSRTL_UNKNOWN1,               OffsetOfFsRtlUnkonwn1,             FIELD_OFFSET),
+            REFLECT_CONTEXT_FIELD(FIELD_IS_TRIGGER_PG,                          IsTiggerPG,                        FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG0,                         BugCheckArg0,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG1,                         BugCheckArg1,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG3,                         BugCheckArg3,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_BUG_CHECK_ARG2,                         BugCheckArg2,                      FIELD_QWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_PG_PROTECT_STRINGS,                     PGProtectStrings.Strings,          FIELD_LOCATION),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_CODES,                NumberOfProtectCodes,              FIELD_DWORD),
+            REFLECT_CONTEXT_FIELD(FIELD_NUMBER_OF_PROTECT_VALUES,               NumberOfProtectValues,             FIELD_DWORD),
+        };
+    };
+
+    // The layouts of every reflected build_XXXX::PGContext, from the oldest
+    // build to the latest
+    auto GetReflectedLayouts()
+        -> std::vector<ContextLayout>;
+
+}
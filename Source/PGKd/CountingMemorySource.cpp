@@ -0,0 +1,58 @@
+#include "CountingMemorySource.h"
+
+#include <chrono>
+
+
+namespace Sunstrider
+{
+
+    CountingMemorySource::CountingMemorySource(MemorySource& aSource, ScanStatistics& aStatistics)
+        : _Source(aSource)
+        , _Statistics(aStatistics)
+    { }
+
+    template<typename Read>
+    auto CountingMemorySource::Count(ScanStatistics::Counter aCounter, std::uint32_t aBytes, Read&& aRead)
+        -> bool
+    {
+        const auto vStart  = std::chrono::steady_clock::now();
+        const auto vResult = aRead();
+        const auto vElapsed = std::chrono::steady_clock::now() - vStart;
+
+        _Statistics.Add(aCounter);
+        _Statistics.Add(ScanStatistics::BYTES_READ, aBytes);
+        _Statistics.Add(ScanStatistics::READ_NANOSECONDS, static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(vElapsed).count()));
+        if (!vResult)
+        {
+            _Statistics.Add(ScanStatistics::FAILED_READS);
+        }
+
+        return vResult;
+    }
+
+    auto CountingMemorySource::ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        return Count(ScanStatistics::VIRTUAL_READS, aBytes, [this, aAddress, aBuffer, aBytes]()
+        {
+            return _Source.ReadVirtual(aAddress, aBuffer, aBytes);
+        });
+    }
+
+    auto CountingMemorySource::ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        return Count(ScanStatistics::PHYSICAL_READS, aBytes, [this, aAddress, aBuffer, aBytes]()
+        {
+            return _Source.ReadPhysical(aAddress, aBuffer, aBytes);
+        });
+    }
+
+    auto CountingMemorySource::AllowsConcurrentReads() const
+        -> bool
+    {
+        return _Source.AllowsConcurrentReads();
+    }
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MemorySource.h"
+#include "ScanStatistics.h"
+
+
+namespace Sunstrider
+{
+
+    // Counts the reads passed to another memory source, the bytes they asked
+    // for, the failed ones and the time they took, into ScanStatistics.
+    //
+    // It is only put in front of the source when statistics are requested,
+    // so that a scan without them reads the source directly. Behind a cache,
+    // it goes under the cache, so that it counts the reads which reach the
+    // target rather than the hits.
+    class CountingMemorySource : public MemorySource
+    {
+        MemorySource&   _Source;
+        ScanStatistics& _Statistics;
+
+        template<typename Read>
+        auto Count(ScanStatistics::Counter aCounter, std::uint32_t aBytes, Read&& aRead)
+            -> bool;
+
+    public:
+        CountingMemorySource(MemorySource& aSource, ScanStatistics& aStatistics);
+
+        auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        // As the source behind it
+        auto AllowsConcurrentReads() const
+            -> bool override;
+    };
+
+}
@@ -0,0 +1,85 @@
+#include "CpuFeatures.h"
+
+#if SUNSTRIDER_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+
+namespace Sunstrider
+{
+
+#if SUNSTRIDER_X86
+    static auto CpuId(unsigned aLeaf, unsigned aSubLeaf, unsigned (&aRegisters)[4])
+        -> void
+    {
+#if defined(_MSC_VER)
+        int vRegisters[4] = {};
+        __cpuidex(vRegisters, static_cast<int>(aLeaf), static_cast<int>(aSubLeaf));
+        for (auto i = 0; i < 4; ++i)
+        {
+            aRegisters[i] = static_cast<unsigned>(vRegisters[i]);
+        }
+#else
+        __cpuid_count(aLeaf, aSubLeaf, aRegisters[0], aRegisters[1], aRegisters[2], aRegisters[3]);
+#endif
+    }
+
+    static auto GetXcr0()
+        -> unsigned long long
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#else
+        unsigned vEax = 0, vEdx = 0;
+        __asm__ __volatile__("xgetbv" : "=a"(vEax), "=d"(vEdx) : "c"(0));
+        return (static_cast<unsigned long long>(vEdx) << 32) | vEax;
+#endif
+    }
+
+    static auto DetectAvx2()
+        -> bool
+    {
+        unsigned vRegisters[4] = {};
+
+        CpuId(0, 0, vRegisters);
+        if (vRegisters[0] < 7)
+        {
+            return false;
+        }
+
+        // CPUID.1:ECX.OSXSAVE[bit 27] and CPUID.1:ECX.AVX[bit 28]
+        CpuId(1, 0, vRegisters);
+        if ((vRegisters[2] & (1u << 27)) == 0 ||
+            (vRegisters[2] & (1u << 28)) == 0)
+        {
+            return false;
+        }
+
+        // XCR0.SSE[bit 1] and XCR0.AVX[bit 2]
+        if ((GetXcr0() & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        // CPUID.(EAX=07H, ECX=0H):EBX.AVX2[bit 5]
+        CpuId(7, 0, vRegisters);
+        return (vRegisters[1] & (1u << 5)) != 0;
+    }
+#endif
+
+    auto IsAvx2Supported()
+        -> bool
+    {
+#if SUNSTRIDER_X86
+        static const auto sAvx2 = DetectAvx2();
+        return sAvx2;
+#else
+        return false;
+#endif
+    }
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SUNSTRIDER_X86 1
+#else
+#define SUNSTRIDER_X86 0
+#endif
+
+// MSVC lets any function use AVX2 intrinsics, while GCC and Clang want the
+// function to be compiled for that target explicitly.
+#if defined(_MSC_VER)
+#define SUNSTRIDER_TARGET_AVX2
+#else
+#define SUNSTRIDER_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+
+namespace Sunstrider
+{
+
+    // Returns true when both the processor and the OS support AVX2
+    // (the OS has to save the YMM registers on context switches).
+    auto IsAvx2Supported()
+        -> bool;
+
+}
@@ -0,0 +1,496 @@
+#include "CrashDump.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    // Layout of DUMP_HEADER64 (the first 0x2000 bytes of the file)
+    namespace DumpHeader64
+    {
+        constexpr std::uint64_t Signature               = 0x000;    // "PAGE"
+        constexpr std::uint64_t ValidDump               = 0x004;    // "DU64"
+        constexpr std::uint64_t MinorVersion            = 0x00C;
+        constexpr std::uint64_t DirectoryTableBase      = 0x010;
+        constexpr std::uint64_t PfnDataBase             = 0x018;
+        constexpr std::uint64_t PsLoadedModuleList      = 0x020;
+        constexpr std::uint64_t PsActiveProcessHead     = 0x028;
+        constexpr std::uint64_t MachineImageType        = 0x030;
+        constexpr std::uint64_t BugCheckCode            = 0x038;
+        constexpr std::uint64_t BugCheckParameters      = 0x040;
+        constexpr std::uint64_t KdDebuggerDataBlock     = 0x080;
+        constexpr std::uint64_t PhysicalMemoryBlock     = 0x088;    // PHYSICAL_MEMORY_DESCRIPTOR64
+        constexpr std::uint64_t PhysicalMemoryBlockSize = 700;
+        constexpr std::uint64_t DumpType                = 0xF98;
+        constexpr std::uint64_t Size                    = 0x2000;
+    }
+
+    // Layout of the bitmap header which follows DUMP_HEADER64 in bitmap dumps
+    namespace BitmapHeader64
+    {
+        constexpr std::uint64_t Signature               = 0x00;     // "SDMP" or "FDMP"
+        constexpr std::uint64_t ValidDump               = 0x04;     // "DUMP"
+        constexpr std::uint64_t FirstPage               = 0x20;     // File offset of the first page
+        constexpr std::uint64_t Pages                   = 0x30;     // Size of the bitmap in bits
+        constexpr std::uint64_t Bitmap                  = 0x38;
+    }
+
+    // Layout of the "RDMP" header used by the kernel/active/complete dumps
+    // written by recent Windows 10 builds
+    namespace RdmpHeader64
+    {
+        constexpr std::uint64_t Signature               = 0x04;     // "RDMP"
+        constexpr std::uint64_t ValidDump               = 0x08;     // "DUMP"
+        constexpr std::uint64_t MetadataSize            = 0x10;
+        constexpr std::uint64_t FirstPageOffset         = 0x18;
+        constexpr std::uint64_t Bitmap                  = 0x30;
+    }
+
+    // Layout of KDDEBUGGER_DATA64, which starts with a DBGKD_DEBUG_DATA_HEADER64
+    namespace KdDebuggerData64
+    {
+        constexpr std::uint64_t OwnerTag                = 0x010;    // "KDBG"
+        constexpr std::uint64_t Size                    = 0x014;
+        constexpr std::uint64_t KernBase                = 0x018;
+        constexpr std::uint64_t MmPfnDatabase           = 0x0C0;
+        constexpr std::uint64_t MmHighestPhysicalPage   = 0x0F0;
+        constexpr std::uint64_t MmSystemRangeStart      = 0x1D0;
+        constexpr std::uint64_t MinimumSize             = 0x1D8;
+    }
+
+    constexpr std::uint64_t PAGE_SIZE   = 0x1000;
+    constexpr std::uint64_t PAGE_SHIFT  = 12;
+    constexpr std::uint64_t PFN_MASK    = 0x000FFFFFFFFFF000;
+
+    constexpr std::uint64_t PTE_VALID       = 1ull << 0;
+    constexpr std::uint64_t PTE_LARGE_PAGE  = 1ull << 7;
+    constexpr std::uint64_t PTE_PROTOTYPE   = 1ull << 10;
+    constexpr std::uint64_t PTE_TRANSITION  = 1ull << 11;
+
+    template<typename T>
+    static auto Peek(const std::uint8_t* aView, std::uint64_t aOffset)
+        -> T
+    {
+        T vValue;
+        memcpy(&vValue, aView + aOffset, sizeof(vValue));
+        return vValue;
+    }
+
+    CrashDump::CrashDump(const std::string& aPath)
+    {
+        Map(aPath);
+
+        try
+        {
+            ParseHeader();
+        }
+        catch (...)
+        {
+            Unmap();
+            throw;
+        }
+    }
+
+    CrashDump::~CrashDump()
+    {
+        Unmap();
+    }
+
+    auto CrashDump::Map(const std::string& aPath)
+        -> void
+    {
+#if defined(_WIN32)
+        auto vFile = CreateFileA(aPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (vFile == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("The dump file could not be opened.");
+        }
+
+        LARGE_INTEGER vSize = {};
+        auto vMapping = GetFileSizeEx(vFile, &vSize)
+            ? CreateFileMappingA(vFile, nullptr, PAGE_READONLY, 0, 0, nullptr)
+            : nullptr;
+        CloseHandle(vFile);
+        if (!vMapping)
+        {
+            throw std::runtime_error("The dump file could not be mapped.");
+        }
+
+        auto vView = MapViewOfFile(vMapping, FILE_MAP_READ, 0, 0, 0);
+        if (!vView)
+        {
+            CloseHandle(vMapping);
+            throw std::runtime_error("The dump file could not be mapped.");
+        }
+
+        _Mapping  = vMapping;
+        _View     = static_cast<const std::uint8_t*>(vView);
+        _ViewSize = static_cast<std::uint64_t>(vSize.QuadPart);
+#else
+        auto vFile = open(aPath.c_str(), O_RDONLY);
+        if (vFile < 0)
+        {
+            throw std::runtime_error("The dump file could not be opened.");
+        }
+
+        struct stat vStat = {};
+        auto vView = (fstat(vFile, &vStat) == 0 && vStat.st_size > 0)
+            ? mmap(nullptr, static_cast<std::size_t>(vStat.st_size), PROT_READ, MAP_SHARED, vFile, 0)
+            : MAP_FAILED;
+        close(vFile);
+        if (vView == MAP_FAILED)
+        {
+            throw std::runtime_error("The dump file could not be mapped.");
+        }
+
+        _View     = static_cast<const std::uint8_t*>(vView);
+        _ViewSize = static_cast<std::uint64_t>(vStat.st_size);
+#endif
+    }
+
+    auto CrashDump::Unmap()
+        -> void
+    {
+        if (!_View)
+        {
+            return;
+        }
+
+#if defined(_WIN32)
+        UnmapViewOfFile(_View);
+        CloseHandle(static_cast<HANDLE>(_Mapping));
+#else
+        munmap(const_cast<std::uint8_t*>(_View), static_cast<std::size_t>(_ViewSize));
+#endif
+
+        _View     = nullptr;
+        _ViewSize = 0;
+        _Mapping  = nullptr;
+    }
+
+    auto CrashDump::ParseHeader()
+        -> void
+    {
+        if (_ViewSize < DumpHeader64::Size ||
+            memcmp(_View + DumpHeader64::Signature, "PAGE", 4) != 0 ||
+            memcmp(_View + DumpHeader64::ValidDump, "DU64", 4) != 0)
+        {
+            throw std::runtime_error("The given file is not a 64-bit crash dump.");
+        }
+
+        if (Peek<std::uint32_t>(_View, DumpHeader64::MachineImageType) != 0x8664)
+        {
+            throw std::runtime_error("The given crash dump is not an x64 dump.");
+        }
+
+        _Header.Type                = static_cast<DumpType>(Peek<std::uint32_t>(_View, DumpHeader64::DumpType));
+        _Header.BuildNumber         = Peek<std::uint32_t>(_View, DumpHeader64::MinorVersion);
+        _Header.DirectoryTableBase  = Peek<std::uint64_t>(_View, DumpHeader64::DirectoryTableBase);
+        _Header.PfnDataBase         = Peek<std::uint64_t>(_View, DumpHeader64::PfnDataBase);
+        _Header.PsLoadedModuleList  = Peek<std::uint64_t>(_View, DumpHeader64::PsLoadedModuleList);
+        _Header.PsActiveProcessHead = Peek<std::uint64_t>(_View, DumpHeader64::PsActiveProcessHead);
+        _Header.KdDebuggerDataBlock = Peek<std::uint64_t>(_View, DumpHeader64::KdDebuggerDataBlock);
+        _Header.BugCheckCode        = Peek<std::uint32_t>(_View, DumpHeader64::BugCheckCode);
+        for (auto i = 0u; i < 4; ++i)
+        {
+            _Header.BugCheckParameters[i] = Peek<std::uint64_t>(_View, DumpHeader64::BugCheckParameters + i * 8);
+        }
+
+        if (_Header.Type == DUMP_TYPE_FULL)
+        {
+            IndexFullDump();
+            return;
+        }
+
+        // Every other supported type is a bitmap dump. Tell the header
+        // formats apart by their signatures rather than by the dump type,
+        // which has been reused across Windows versions.
+        const auto vBitmapHeader = _View + DumpHeader64::Size;
+        if (_ViewSize >= DumpHeader64::Size + BitmapHeader64::Bitmap &&
+            (memcmp(vBitmapHeader + BitmapHeader64::Signature, "SDMP", 4) == 0 ||
+             memcmp(vBitmapHeader + BitmapHeader64::Signature, "FDMP", 4) == 0) &&
+            memcmp(vBitmapHeader + BitmapHeader64::ValidDump, "DUMP", 4) == 0)
+        {
+            IndexBitmap(
+                DumpHeader64::Size + BitmapHeader64::Bitmap,
+                Peek<std::uint64_t>(vBitmapHeader, BitmapHeader64::Pages),
+                Peek<std::uint64_t>(vBitmapHeader, BitmapHeader64::FirstPage));
+            return;
+        }
+
+        if (_ViewSize >= DumpHeader64::Size + RdmpHeader64::Bitmap &&
+            memcmp(vBitmapHeader + RdmpHeader64::Signature, "RDMP", 4) == 0 &&
+            memcmp(vBitmapHeader + RdmpHeader64::ValidDump, "DUMP", 4) == 0)
+        {
+            const auto vMetadataSize = Peek<std::uint64_t>(vBitmapHeader, RdmpHeader64::MetadataSize);
+            const auto vBitmapBytes  = vMetadataSize > RdmpHeader64::Bitmap ? vMetadataSize - RdmpHeader64::Bitmap : 0;
+
+            IndexBitmap(
+                DumpHeader64::Size + RdmpHeader64::Bitmap,
+                vBitmapBytes * 8,
+                Peek<std::uint64_t>(vBitmapHeader, RdmpHeader64::FirstPageOffset));
+            return;
+        }
+
+        throw std::runtime_error("The type of the given crash dump is not supported.");
+    }
+
+    auto CrashDump::IndexFullDump()
+        -> void
+    {
+        const auto vNumberOfRuns = Peek<std::uint32_t>(_View, DumpHeader64::PhysicalMemoryBlock);
+        const auto vMaximumRuns  = (DumpHeader64::PhysicalMemoryBlockSize - 0x10) / 0x10;
+        if (vNumberOfRuns > vMaximumRuns)
+        {
+            throw std::runtime_error("The physical memory block of the crash dump is broken.");
+        }
+
+        auto vFileOffset = DumpHeader64::Size;
+        for (auto i = 0u; i < vNumberOfRuns; ++i)
+        {
+            const auto vRun = DumpHeader64::PhysicalMemoryBlock + 0x10 + i * 0x10;
+            const auto vBasePage  = Peek<std::uint64_t>(_View, vRun);
+            const auto vPageCount = Peek<std::uint64_t>(_View, vRun + 8);
+
+            // A truncated dump only contains a prefix of its runs
+            const auto vAvailable = std::min(vPageCount, (_ViewSize - std::min(vFileOffset, _ViewSize)) / PAGE_SIZE);
+            if (vAvailable)
+            {
+                _Runs.push_back(PhysicalRun{ vBasePage, vAvailable, vFileOffset });
+            }
+            vFileOffset += vPageCount * PAGE_SIZE;
+        }
+
+        std::sort(_Runs.begin(), _Runs.end(),
+            [](const PhysicalRun& aLhs, const PhysicalRun& aRhs) { return aLhs.BasePage < aRhs.BasePage; });
+    }
+
+    auto CrashDump::IndexBitmap(std::uint64_t aBitmapOffset, std::uint64_t aBitmapBits, std::uint64_t aFirstPageOffset)
+        -> void
+    {
+        // Never read the bitmap past the end of the file
+        aBitmapBits = std::min(aBitmapBits, (_ViewSize - std::min(aBitmapOffset, _ViewSize)) * 8);
+
+        // Present pages are stored back to back in the order of their page
+        // frame numbers, so every run of set bits becomes one PhysicalRun
+        auto vFileOffset = aFirstPageOffset;
+        for (std::uint64_t vPage = 0; vPage < aBitmapBits; )
+        {
+            const auto vByte = _View[aBitmapOffset + vPage / 8];
+            if (vByte == 0 && (vPage % 8) == 0)
+            {
+                vPage += 8;
+                continue;
+            }
+            if (!(vByte & (1u << (vPage % 8))))
+            {
+                ++vPage;
+                continue;
+            }
+
+            if (vFileOffset + PAGE_SIZE > _ViewSize)
+            {
+                break;
+            }
+
+            if (!_Runs.empty() &&
+                _Runs.back().BasePage + _Runs.back().PageCount == vPage)
+            {
+                ++_Runs.back().PageCount;
+            }
+            else
+            {
+                _Runs.push_back(PhysicalRun{ vPage, 1, vFileOffset });
+            }
+
+            vFileOffset += PAGE_SIZE;
+            ++vPage;
+        }
+    }
+
+    auto CrashDump::GetHeader() const
+        -> const Header&
+    {
+        return _Header;
+    }
+
+    auto CrashDump::ReadKdDebuggerData(KdDebuggerData& aData)
+        -> bool
+    {
+        std::uint8_t vBlock[KdDebuggerData64::MinimumSize];
+        if (!_Header.KdDebuggerDataBlock ||
+            !ReadVirtual(_Header.KdDebuggerDataBlock, vBlock, sizeof(vBlock)) ||
+            memcmp(vBlock + KdDebuggerData64::OwnerTag, "KDBG", 4) != 0 ||
+            Peek<std::uint32_t>(vBlock, KdDebuggerData64::Size) < KdDebuggerData64::MinimumSize)
+        {
+            return false;
+        }
+
+        aData.KernBase              = Peek<std::uint64_t>(vBlock, KdDebuggerData64::KernBase);
+        aData.MmPfnDatabase         = Peek<std::uint64_t>(vBlock, KdDebuggerData64::MmPfnDatabase);
+        aData.MmHighestPhysicalPage = Peek<std::uint64_t>(vBlock, KdDebuggerData64::MmHighestPhysicalPage);
+        aData.MmSystemRangeStart    = Peek<std::uint64_t>(vBlock, KdDebuggerData64::MmSystemRangeStart);
+        return true;
+    }
+
+    auto CrashDump::NumberOfPages() const
+        -> std::uint64_t
+    {
+        std::uint64_t vPages = 0;
+        for (const auto& vRun : _Runs)
+        {
+            vPages += vRun.PageCount;
+        }
+        return vPages;
+    }
+
+    auto CrashDump::GetPhysicalPage(std::uint64_t aPageFrameNumber) const
+        -> const std::uint8_t*
+    {
+        // Find the last run starting at or below the page
+        auto vRun = std::upper_bound(_Runs.begin(), _Runs.end(), aPageFrameNumber,
+            [](std::uint64_t aPage, const PhysicalRun& aRun) { return aPage < aRun.BasePage; });
+        if (vRun == _Runs.begin())
+        {
+            return nullptr;
+        }
+
+        --vRun;
+        if (aPageFrameNumber >= vRun->BasePage + vRun->PageCount)
+        {
+            return nullptr;
+        }
+
+        return _View + vRun->FileOffset + (aPageFrameNumber - vRun->BasePage) * PAGE_SIZE;
+    }
+
+    auto CrashDump::ReadPhysicalQword(std::uint64_t aAddress, std::uint64_t& aValue) const
+        -> bool
+    {
+        const auto vPage = GetPhysicalPage(aAddress >> PAGE_SHIFT);
+        if (!vPage)
+        {
+            return false;
+        }
+
+        aValue = Peek<std::uint64_t>(vPage, aAddress & (PAGE_SIZE - 1) & ~7ull);
+        return true;
+    }
+
+    auto CrashDump::VirtualToPhysical(std::uint64_t aAddress, std::uint64_t& aPhysical) const
+        -> bool
+    {
+        std::uint64_t vEntry = 0;
+
+        // PML4E
+        if (!ReadPhysicalQword((_Header.DirectoryTableBase & PFN_MASK) + ((aAddress >> 39) & 0x1ff) * 8, vEntry) ||
+            !(vEntry & PTE_VALID))
+        {
+            return false;
+        }
+
+        // PDPTE, which may map a 1GB page
+        if (!ReadPhysicalQword((vEntry & PFN_MASK) + ((aAddress >> 30) & 0x1ff) * 8, vEntry) ||
+            !(vEntry & PTE_VALID))
+        {
+            return false;
+        }
+        if (vEntry & PTE_LARGE_PAGE)
+        {
+            aPhysical = (vEntry & PFN_MASK & ~0x3FFFFFFFull) + (aAddress & 0x3FFFFFFF);
+            return true;
+        }
+
+        // PDE, which may map a 2MB page
+        if (!ReadPhysicalQword((vEntry & PFN_MASK) + ((aAddress >> 21) & 0x1ff) * 8, vEntry) ||
+            !(vEntry & PTE_VALID))
+        {
+            return false;
+        }
+        if (vEntry & PTE_LARGE_PAGE)
+        {
+            aPhysical = (vEntry & PFN_MASK & ~0x1FFFFFull) + (aAddress & 0x1FFFFF);
+            return true;
+        }
+
+        // PTE. A transition PTE still refers to a page in physical memory,
+        // and the debugger reads it as well.
+        if (!ReadPhysicalQword((vEntry & PFN_MASK) + ((aAddress >> 12) & 0x1ff) * 8, vEntry))
+        {
+            return false;
+        }
+        if (!(vEntry & PTE_VALID) &&
+            !((vEntry & PTE_TRANSITION) && !(vEntry & PTE_PROTOTYPE)))
+        {
+            return false;
+        }
+
+        aPhysical = (vEntry & PFN_MASK) + (aAddress & (PAGE_SIZE - 1));
+        return true;
+    }
+
+    auto CrashDump::ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        auto vCursor = static_cast<std::uint8_t*>(aBuffer);
+
+        while (aBytes)
+        {
+            const auto vOffset = aAddress & (PAGE_SIZE - 1);
+            const auto vBytes  = static_cast<std::uint32_t>(std::min<std::uint64_t>(aBytes, PAGE_SIZE - vOffset));
+
+            const auto vPage = GetPhysicalPage(aAddress >> PAGE_SHIFT);
+            if (!vPage)
+            {
+                return false;
+            }
+            memcpy(vCursor, vPage + vOffset, vBytes);
+
+            vCursor  += vBytes;
+            aAddress += vBytes;
+            aBytes   -= vBytes;
+        }
+
+        return true;
+    }
+
+    auto CrashDump::ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        auto vCursor = static_cast<std::uint8_t*>(aBuffer);
+
+        while (aBytes)
+        {
+            const auto vOffset = aAddress & (PAGE_SIZE - 1);
+            const auto vBytes  = static_cast<std::uint32_t>(std::min<std::uint64_t>(aBytes, PAGE_SIZE - vOffset));
+
+            std::uint64_t vPhysical = 0;
+            if (!VirtualToPhysical(aAddress, vPhysical) ||
+                !ReadPhysical(vPhysical, vCursor, vBytes))
+            {
+                return false;
+            }
+
+            vCursor  += vBytes;
+            aAddress += vBytes;
+            aBytes   -= vBytes;
+        }
+
+        return true;
+    }
+
+}
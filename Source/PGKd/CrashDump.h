@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MemorySource.h"
+
+
+namespace Sunstrider
+{
+
+    // A 64-bit Windows kernel crash dump (MEMORY.DMP) mapped into memory.
+    //
+    // Supports full dumps (the pages follow the header in the order of the
+    // physical memory runs) and bitmap dumps (kernel, automatic, active and
+    // complete dumps of Windows 8 and later, where a bitmap tells which
+    // physical pages are present). Virtual addresses are translated by walking
+    // the page tables from the directory table base recorded in the header, so
+    // no debugger is involved at any point.
+    //
+    // Reads are lock-free and can be issued from any number of threads.
+    class CrashDump : public MemorySource
+    {
+    public:
+        enum DumpType : std::uint32_t
+        {
+            DUMP_TYPE_FULL              = 1,
+            DUMP_TYPE_SUMMARY           = 2,
+            DUMP_TYPE_BITMAP_FULL       = 5,
+            DUMP_TYPE_BITMAP_KERNEL     = 6,
+            DUMP_TYPE_KERNEL_MEMORY     = 8,
+            DUMP_TYPE_KERNEL_AND_USER   = 9,
+            DUMP_TYPE_COMPLETE_MEMORY   = 10,
+        };
+
+        struct Header
+        {
+            DumpType        Type;
+            std::uint32_t   BuildNumber;        // MinorVersion of the header
+            std::uint64_t   DirectoryTableBase;
+            std::uint64_t   PfnDataBase;
+            std::uint64_t   PsLoadedModuleList;
+            std::uint64_t   PsActiveProcessHead;
+            std::uint64_t   KdDebuggerDataBlock;
+            std::uint32_t   BugCheckCode;
+            std::uint64_t   BugCheckParameters[4];
+        };
+
+        // The fields of KDDEBUGGER_DATA64 (the block at KdDebuggerDataBlock)
+        // which let a dump be scanned without symbols. They are the addresses
+        // of the variables, not their values.
+        struct KdDebuggerData
+        {
+            std::uint64_t   KernBase;
+            std::uint64_t   MmPfnDatabase;
+            std::uint64_t   MmHighestPhysicalPage;
+            std::uint64_t   MmSystemRangeStart;
+        };
+
+    private:
+        // Physical pages [BasePage, BasePage + PageCount) are stored
+        // contiguously in the file from FileOffset
+        struct PhysicalRun
+        {
+            std::uint64_t BasePage;
+            std::uint64_t PageCount;
+            std::uint64_t FileOffset;
+        };
+
+        const std::uint8_t*         _View       = nullptr;
+        std::uint64_t               _ViewSize   = 0;
+        void*                       _Mapping    = nullptr;  // Platform handle of the mapping
+
+        Header                      _Header     = {};
+        std::vector<PhysicalRun>    _Runs;                  // Sorted by BasePage
+
+        auto Map(const std::string& aPath)
+            -> void;
+
+        auto Unmap()
+            -> void;
+
+        auto ParseHeader()
+            -> void;
+
+        auto IndexFullDump()
+            -> void;
+
+        auto IndexBitmap(std::uint64_t aBitmapOffset, std::uint64_t aBitmapBits, std::uint64_t aFirstPageOffset)
+            -> void;
+
+        // Returns the mapped bytes of the given physical page, or nullptr if the
+        // page is not present in the dump
+        auto GetPhysicalPage(std::uint64_t aPageFrameNumber) const
+            -> const std::uint8_t*;
+
+        auto ReadPhysicalQword(std::uint64_t aAddress, std::uint64_t& aValue) const
+            -> bool;
+
+        auto VirtualToPhysical(std::uint64_t aAddress, std::uint64_t& aPhysical) const
+            -> bool;
+
+    public:
+        // Throws std::runtime_error if the file cannot be mapped or is not a
+        // supported 64-bit kernel dump
+        explicit CrashDump(const std::string& aPath);
+
+        ~CrashDump();
+
+        CrashDump(const CrashDump&) = delete;
+        CrashDump& operator=(const CrashDump&) = delete;
+
+        auto GetHeader() const
+            -> const Header&;
+
+        // Reads the KDDEBUGGER_DATA64 block of the dump. Returns false if it
+        // is not in the dump, or if it is encoded, as it is on Windows 8 and
+        // later when no debugger was attached.
+        auto ReadKdDebuggerData(KdDebuggerData& aData)
+            -> bool;
+
+        // The number of physical pages present in the dump
+        auto NumberOfPages() const
+            -> std::uint64_t;
+
+        auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+    };
+
+}
@@ -0,0 +1,47 @@
+#include "stdafx.h"
+#include "DbgEngMemorySource.h"
+
+
+namespace Sunstrider
+{
+
+    DbgEngMemorySource::DbgEngMemorySource(IDebugDataSpaces* aData)
+        : _Data(aData)
+        , _EngineThread(std::this_thread::get_id())
+    { }
+
+    auto DbgEngMemorySource::ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        if (std::this_thread::get_id() != _EngineThread)
+        {
+            return false;
+        }
+
+        auto vReadBytes = 0ul;
+        auto hr = _Data->ReadVirtual(aAddress, aBuffer, aBytes, &vReadBytes);
+
+        return SUCCEEDED(hr) && vReadBytes == aBytes;
+    }
+
+    auto DbgEngMemorySource::ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        if (std::this_thread::get_id() != _EngineThread)
+        {
+            return false;
+        }
+
+        auto vReadBytes = 0ul;
+        auto hr = _Data->ReadPhysical(aAddress, aBuffer, aBytes, &vReadBytes);
+
+        return SUCCEEDED(hr) && vReadBytes == aBytes;
+    }
+
+    auto DbgEngMemorySource::AllowsConcurrentReads() const
+        -> bool
+    {
+        return false;
+    }
+
+}
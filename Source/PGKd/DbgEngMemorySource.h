@@ -0,0 +1,36 @@
+#pragma once
+
+#include <thread>
+
+#include "MemorySource.h"
+
+
+namespace Sunstrider
+{
+
+    // Reads the memory of the current debugger target through dbgeng.
+    //
+    // The engine must only be entered by the thread of the command, which
+    // is blocked in the extension call while a scan runs, so this source
+    // does not allow concurrent reads, and the scans over it run their tasks
+    // on that thread (see WorkStealingPool). Reads from any other thread
+    // fail.
+    class DbgEngMemorySource : public MemorySource
+    {
+        IDebugDataSpaces*   _Data;
+        std::thread::id     _EngineThread;
+
+    public:
+        explicit DbgEngMemorySource(IDebugDataSpaces* aData);
+
+        auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto AllowsConcurrentReads() const
+            -> bool override;
+    };
+
+}
@@ -0,0 +1,121 @@
+#include "FilterCascade.h"
+
+#include <limits>
+#include <stdexcept>
+
+
+namespace Sunstrider
+{
+
+    auto FilterCascade::AddStage(const char* aName, bool aIsEscalation)
+        -> std::size_t
+    {
+        if (_NumberOfStages == MAXIMUM_STAGES)
+        {
+            throw std::runtime_error("Too many filter stages.");
+        }
+
+        const auto vStage = _NumberOfStages++;
+        _Stages[vStage] = StageCounters{ aName, aIsEscalation, 0, 0, 0 };
+
+        if (!aIsEscalation)
+        {
+            _Order[_NumberOfOrdered++] = vStage;
+        }
+
+        return vStage;
+    }
+
+    auto FilterCascade::AddStage(const char* aName)
+        -> std::size_t
+    {
+        return AddStage(aName, false);
+    }
+
+    auto FilterCascade::AddEscalation(const char* aName)
+        -> std::size_t
+    {
+        return AddStage(aName, true);
+    }
+
+    auto FilterCascade::Reset()
+        -> void
+    {
+        _NumberOfOrdered = 0;
+        for (std::size_t i = 0; i < _NumberOfStages; ++i)
+        {
+            auto& vStage = _Stages[i];
+            vStage.Evaluated   = 0;
+            vStage.Passed      = 0;
+            vStage.Nanoseconds = 0;
+
+            if (!vStage.IsEscalation)
+            {
+                _Order[_NumberOfOrdered++] = i;
+            }
+        }
+
+        _Candidates = 0;
+        _Accepted   = 0;
+    }
+
+    // The expected cost of rejecting a candidate with this stage. Independent
+    // checks cost the least in total when they run by increasing rank.
+    auto FilterCascade::GetRank(std::size_t aStage) const
+        -> double
+    {
+        const auto& vStage = _Stages[aStage];
+        if (!vStage.Evaluated)
+        {
+            return 0.0;
+        }
+
+        const auto vRejected = vStage.Evaluated - vStage.Passed;
+        if (!vRejected)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        const auto vCost = static_cast<double>(vStage.Nanoseconds) / static_cast<double>(vStage.Evaluated);
+        const auto vRejectionRate = static_cast<double>(vRejected) / static_cast<double>(vStage.Evaluated);
+
+        return vCost / vRejectionRate;
+    }
+
+    auto FilterCascade::Reorder()
+        -> void
+    {
+        std::array<double, MAXIMUM_STAGES> vRanks;
+        for (std::size_t i = 0; i < _NumberOfStages; ++i)
+        {
+            vRanks[i] = GetRank(i);
+        }
+
+        // A stable insertion sort: there are only a few stages, and stages of
+        // the same rank keep their order
+        for (std::size_t i = 1; i < _NumberOfOrdered; ++i)
+        {
+            const auto vStage = _Order[i];
+
+            auto j = i;
+            for (; j > 0 && vRanks[_Order[j - 1]] > vRanks[vStage]; --j)
+            {
+                _Order[j] = _Order[j - 1];
+            }
+            _Order[j] = vStage;
+        }
+    }
+
+    auto FilterCascade::Candidates() const
+        -> std::uint64_t
+    {
+        return _Candidates;
+    }
+
+    auto FilterCascade::Accepted() const
+        -> std::uint64_t
+    {
+        return _Accepted;
+    }
+
+}
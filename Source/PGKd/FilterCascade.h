@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <chrono>
+
+
+namespace Sunstrider
+{
+
+    // A sequence of independent checks which a candidate has to pass, and
+    // which stops at the first one it fails.
+    //
+    // Every stage counts the candidates it examined and passed, and the time
+    // it took. Every REORDER_INTERVAL candidates, the stages are sorted by
+    // their cost per rejected candidate, so that the cheap and selective
+    // checks run first, whatever the target looks like. A stage which has
+    // not been measured yet runs first, so that it gets measured.
+    //
+    // An escalation is a stage which is not part of the order: another stage
+    // runs it through Measure for the candidates it cannot decide alone, so
+    // that it is counted as well.
+    //
+    // A cascade is not thread-safe.
+    class FilterCascade
+    {
+    public:
+        static constexpr std::size_t   MAXIMUM_STAGES   = 8;
+        static constexpr std::uint64_t REORDER_INTERVAL = 0x100;
+
+        struct StageCounters
+        {
+            const char*     Name;
+            bool            IsEscalation;
+            std::uint64_t   Evaluated;
+            std::uint64_t   Passed;
+            std::uint64_t   Nanoseconds;
+        };
+
+    private:
+        std::array<StageCounters, MAXIMUM_STAGES>   _Stages;
+        std::size_t                                 _NumberOfStages = 0;
+
+        // The stages which are not escalations, in the order they run
+        std::array<std::size_t, MAXIMUM_STAGES>     _Order;
+        std::size_t                                 _NumberOfOrdered = 0;
+
+        std::uint64_t _Candidates = 0;
+        std::uint64_t _Accepted   = 0;
+
+        auto AddStage(const char* aName, bool aIsEscalation)
+            -> std::size_t;
+
+        auto GetRank(std::size_t aStage) const
+            -> double;
+
+        auto Reorder()
+            -> void;
+
+    public:
+        // Stages run in the order they are added until they are measured.
+        // Returns the index of the stage.
+        auto AddStage(const char* aName)
+            -> std::size_t;
+
+        auto AddEscalation(const char* aName)
+            -> std::size_t;
+
+        // Clears the counters, and restores the order the stages were added in
+        auto Reset()
+            -> void;
+
+        // Runs aCheck() as aStage, and counts it
+        template<typename Routine>
+        auto Measure(std::size_t aStage, Routine&& aCheck)
+            -> bool
+        {
+            const auto vStart  = std::chrono::steady_clock::now();
+            const auto vPassed = static_cast<bool>(aCheck());
+            const auto vElapsed = std::chrono::steady_clock::now() - vStart;
+
+            auto& vStage = _Stages[aStage];
+            ++vStage.Evaluated;
+            vStage.Passed += vPassed ? 1 : 0;
+            vStage.Nanoseconds += static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(vElapsed).count());
+
+            return vPassed;
+        }
+
+        // Runs aEvaluate(aStage) for every stage in the current order, until
+        // one of them fails. Returns true if the candidate passed them all.
+        template<typename Evaluate>
+        auto Run(Evaluate&& aEvaluate)
+            -> bool
+        {
+            auto vPassed = true;
+            for (std::size_t i = 0; i < _NumberOfOrdered; ++i)
+            {
+                const auto vStage = _Order[i];
+                if (!Measure(vStage, [&aEvaluate, vStage]() { return aEvaluate(vStage); }))
+                {
+                    vPassed = false;
+                    break;
+                }
+            }
+
+            _Accepted += vPassed ? 1 : 0;
+            if (++_Candidates % REORDER_INTERVAL == 0)
+            {
+                Reorder();
+            }
+
+            return vPassed;
+        }
+
+        // Calls aRoutine(const StageCounters&) for every stage in the current
+        // order, and then for every escalation
+        template<typename Routine>
+        auto ForEachStage(Routine&& aRoutine) const
+            -> void
+        {
+            for (std::size_t i = 0; i < _NumberOfOrdered; ++i)
+            {
+                aRoutine(_Stages[_Order[i]]);
+            }
+            for (std::size_t i = 0; i < _NumberOfStages; ++i)
+            {
+                if (_Stages[i].IsEscalation)
+                {
+                    aRoutine(_Stages[i]);
+                }
+            }
+        }
+
+        auto Candidates() const
+            -> std::uint64_t;
+
+        auto Accepted() const
+            -> std::uint64_t;
+    };
+
+}
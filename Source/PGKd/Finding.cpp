@@ -0,0 +1,58 @@
+#include "Finding.h"
+
+#include <sstream>
+
+
+namespace Sunstrider
+{
+
+    auto GetSourceName(std::uint32_t aOrigin)
+        -> const char*
+    {
+        switch (aOrigin)
+        {
+        case Finding::BIG_POOL:                             return "bigPool";
+        case Finding::INDEPENDENT_PAGE:                     return "independent";
+        case Finding::BIG_POOL | Finding::INDEPENDENT_PAGE: return "bigPool+independent";
+        default:                                            return "unknown";
+        }
+    }
+
+    // The tag is shown as text as well, with anything which is not printable
+    // or which would have to be escaped replaced by a dot
+    auto ToJsonLine(const Finding& aFinding)
+        -> std::string
+    {
+        std::ostringstream vJson;
+
+        vJson << "{\"id\": " << aFinding.SequenceId
+              << ", \"source\": \"" << GetSourceName(aFinding.Origin) << "\""
+              << ", \"va\": \"0x" << std::hex << aFinding.Va << "\""
+              << ", \"size\": " << std::dec << aFinding.Size
+              << ", \"distinctive\": " << aFinding.Randomness.NumberOfDistinctiveNumbers
+              << ", \"randomness\": " << aFinding.Randomness.Ramdomness;
+
+        if (aFinding.Origin & Finding::BIG_POOL)
+        {
+            char vTag[sizeof(aFinding.Tag) + 1] = {};
+            for (std::size_t i = 0; i < sizeof(aFinding.Tag); ++i)
+            {
+                const auto vChar = static_cast<char>(aFinding.Tag >> (i * 8));
+                vTag[i] = (vChar < 0x20 || vChar > 0x7e || vChar == '"' || vChar == '\\') ? '.' : vChar;
+            }
+            vJson << ", \"tag\": \"" << vTag << "\"";
+        }
+        if (aFinding.Context)
+        {
+            vJson << ", \"context\": \"0x" << std::hex << aFinding.Context << std::dec << "\"";
+        }
+        if (aFinding.Origin & Finding::INDEPENDENT_PAGE)
+        {
+            vJson << ", \"mappingSize\": " << aFinding.MappingSize;
+        }
+
+        vJson << "}";
+        return vJson.str();
+    }
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ByteCensus.h"
+
+
+namespace Sunstrider
+{
+
+    // A page which looks like a PatchGuard context, as the scanner hands it
+    // over as soon as it has been confirmed
+    struct Finding
+    {
+        // Where a page was found. Both when the hits of the two phases were
+        // merged (see CandidateTable::MergeOverlapping).
+        enum Source : std::uint32_t
+        {
+            BIG_POOL            = 1,
+            INDEPENDENT_PAGE    = 2,
+        };
+
+        std::uint64_t   SequenceId;     // 1, 2, ... in the order the pages were confirmed
+        std::uint32_t   Origin;         // Source flags
+        std::uint64_t   Va;
+        std::uint64_t   Size;           // The size of the pool entry or of the region
+        RandomnessInfo  Randomness;
+        std::uint32_t   Tag;            // The pool tag of a big pool entry
+        std::uint64_t   MappingSize;    // The page which holds an independent page (4KB, 2MB or 1GB)
+        std::uint64_t   Context;        // Where the context starts, when it is confirmed, or 0
+    };
+
+    // The name of the Source flags of a finding in JSON
+    auto GetSourceName(std::uint32_t aOrigin)
+        -> const char*;
+
+    // aFinding as a single line of JSON, without the line break, so that a
+    // stream of them is NDJSON
+    auto ToJsonLine(const Finding& aFinding)
+        -> std::string;
+
+}
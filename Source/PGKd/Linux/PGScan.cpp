@@ -0,0 +1,397 @@
+// The discovery of !findpg as a standalone program, which scans a crash dump
+// natively, without the debugger engine.
+//
+// There is no symbol engine either, so the addresses of the kernel variables
+// come from KDDEBUGGER_DATA64, when the dump holds it in clear, or from the
+// command line. PoolBigPageTable is not part of that block: the big pool is
+// only scanned when its addresses are given.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CountingMemorySource.h"
+#include "CrashDump.h"
+#include "PageTableWalk.h"
+#include "ScanStatistics.h"
+#include "Scanner.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    const char USAGE[] =
+        "Usage: PGScan [options] <MEMORY.DMP>\n"
+        "Displays the PatchGuard pages of a 64-bit crash dump (full or bitmap).\n"
+        "\n"
+        "  -PoolBigPageTable <address>       &nt!PoolBigPageTable\n"
+        "  -PoolBigPageTableSize <address>   &nt!PoolBigPageTableSize\n"
+        "                                    The big pool is scanned when both are given\n"
+        "  -MmSystemRangeStart <address>     &nt!MmSystemRangeStart\n"
+        "  -MmHighestPhysicalPage <address>  &nt!MmHighestPhysicalPage\n"
+        "                                    Both default to KDDEBUGGER_DATA64\n"
+        "  -pfn                              Finds independent pages through the PFN database\n"
+        "                                    instead of the page tables\n"
+        "  -confirm                          Keeps only the pages whose context decrypts with a\n"
+        "                                    key recovered from its known code\n"
+        "  -decrypt <directory>              Decrypts the context of every page found, and writes\n"
+        "                                    it to <address>.bin in the directory\n"
+        "  -json <path>                      Writes the counters and timers of the scan\n"
+        "  -ndjson <path>                    Writes every page as soon as it is found, one JSON\n"
+        "                                    object per line\n";
+
+    struct Options
+    {
+        std::string     DumpPath;
+        std::uint64_t   PoolBigPageTable        = 0;
+        std::uint64_t   PoolBigPageTableSize    = 0;
+        std::uint64_t   MmSystemRangeStart      = 0;
+        std::uint64_t   MmHighestPhysicalPage   = 0;
+        bool            UsePfnDatabase          = false;
+        bool            ConfirmContexts         = false;
+        std::string     JsonPath;
+        std::string     NdjsonPath;
+        std::string     DecryptPath;
+    };
+
+    auto ParseAddress(const char* aName, const char* aValue)
+        -> std::uint64_t
+    {
+        // WinDbg displays kernel addresses as fffff800`12345678
+        std::string vDigits;
+        for (auto vCursor = aValue; *vCursor; ++vCursor)
+        {
+            if (*vCursor != '`')
+            {
+                vDigits += *vCursor;
+            }
+        }
+
+        char* vEnd = nullptr;
+        const auto vAddress = std::strtoull(vDigits.c_str(), &vEnd, 16);
+        if (vDigits.empty() || *vEnd)
+        {
+            throw std::invalid_argument(std::string("The address of -") + aName + " is not a hexadecimal number.");
+        }
+        return vAddress;
+    }
+
+    auto ParseOptions(int argc, char* argv[])
+        -> Options
+    {
+        Options vOptions;
+
+        const struct
+        {
+            const char*     Name;
+            std::uint64_t   Options::*Address;
+        }
+        ADDRESSES[] = {
+            { "PoolBigPageTable",       &Options::PoolBigPageTable },
+            { "PoolBigPageTableSize",   &Options::PoolBigPageTableSize },
+            { "MmSystemRangeStart",     &Options::MmSystemRangeStart },
+            { "MmHighestPhysicalPage",  &Options::MmHighestPhysicalPage },
+        };
+
+        for (auto i = 1; i < argc; ++i)
+        {
+            const std::string vArg = argv[i];
+            if (vArg.empty() || vArg[0] != '-')
+            {
+                if (!vOptions.DumpPath.empty())
+                {
+                    throw std::invalid_argument("Only one crash dump can be given.");
+                }
+                vOptions.DumpPath = vArg;
+                continue;
+            }
+
+            const auto vName = vArg.substr(1);
+            if (vName == "pfn")
+            {
+                vOptions.UsePfnDatabase = true;
+                continue;
+            }
+            if (vName == "confirm")
+            {
+                vOptions.ConfirmContexts = true;
+                continue;
+            }
+
+            // Every other option takes a value
+            if (i + 1 == argc)
+            {
+                throw std::invalid_argument("-" + vName + " needs a value.");
+            }
+            const auto vValue = argv[++i];
+
+            if (vName == "json")
+            {
+                vOptions.JsonPath = vValue;
+                continue;
+            }
+            if (vName == "ndjson")
+            {
+                vOptions.NdjsonPath = vValue;
+                continue;
+            }
+            if (vName == "decrypt")
+            {
+                vOptions.DecryptPath = vValue;
+                continue;
+            }
+
+            auto vKnown = false;
+            for (const auto& vAddress : ADDRESSES)
+            {
+                if (vName == vAddress.Name)
+                {
+                    vOptions.*vAddress.Address = ParseAddress(vAddress.Name, vValue);
+                    vKnown = true;
+                }
+            }
+            if (!vKnown)
+            {
+                throw std::invalid_argument("Unknown option -" + vName + ".");
+            }
+        }
+
+        if (vOptions.DumpPath.empty())
+        {
+            throw std::invalid_argument("No crash dump was given.");
+        }
+        if (!vOptions.PoolBigPageTable != !vOptions.PoolBigPageTableSize)
+        {
+            throw std::invalid_argument("-PoolBigPageTable and -PoolBigPageTableSize go together.");
+        }
+
+        return vOptions;
+    }
+
+    auto ReadPointer(MemorySource& aMemory, std::uint64_t aAddress, const char* aName)
+        -> std::uint64_t
+    {
+        std::uint64_t vValue = 0;
+        if (!aMemory.ReadVirtual(aAddress, &vValue, sizeof(vValue)))
+        {
+            throw std::runtime_error(std::string(aName) + " could not be read.");
+        }
+        return vValue;
+    }
+
+    auto ShowFinding(const Finding& aFinding)
+        -> void
+    {
+        // The page is in a 2MB or 1GB page if it is larger than 4KB
+        const auto vMapping = (aFinding.Origin & Finding::BIG_POOL) ? ""
+                            : aFinding.MappingSize >= 0x40000000    ? " 1GB page"
+                            : aFinding.MappingSize >= 0x200000      ? " 2MB page"
+                            : "";
+
+        const auto vOrigin = (aFinding.Origin & Finding::BIG_POOL)
+            ? ((aFinding.Origin & Finding::INDEPENDENT_PAGE) ? "BigPagePool, Independent" : "BigPagePool")
+            : "Independent";
+
+        std::printf("#%-4llu [%s] PatchGuard context page base: %016llx, size: 0x%08llx,"
+            " Randomness %3u:%3u%s\n",
+            static_cast<unsigned long long>(aFinding.SequenceId), vOrigin,
+            static_cast<unsigned long long>(aFinding.Va),
+            static_cast<unsigned long long>(aFinding.Size),
+            aFinding.Randomness.NumberOfDistinctiveNumbers,
+            aFinding.Randomness.Ramdomness,
+            vMapping);
+
+        // Where a confirmed context starts, for !dumppg
+        if (aFinding.Context)
+        {
+            std::printf("      Context: %016llx\n", static_cast<unsigned long long>(aFinding.Context));
+        }
+    }
+
+    // Writes every context to <address>.bin in aDirectory
+    auto WriteContexts(const std::vector<DecryptedContext>& aContexts, const std::string& aDirectory)
+        -> void
+    {
+        std::printf("Decrypted: %zu context(s)\n", aContexts.size());
+        for (const auto& vContext : aContexts)
+        {
+            char vName[sizeof("0123456789abcdef.bin")];
+            std::snprintf(vName, sizeof(vName), "%016llx.bin", static_cast<unsigned long long>(vContext.Va));
+
+            const auto vPath = aDirectory + "/" + vName;
+            const auto vBytes = GetContextBytes(vContext.Key);
+
+            std::ofstream vFile(vPath, std::ios::binary);
+            vFile.write(reinterpret_cast<const char*>(vContext.Image), static_cast<std::streamsize>(vBytes));
+            if (!vFile)
+            {
+                throw std::runtime_error(vPath + " could not be written.");
+            }
+
+            std::printf("Context %016llx: 0x%08llx bytes, key %016llx, written to %s\n",
+                static_cast<unsigned long long>(vContext.Va),
+                static_cast<unsigned long long>(vBytes),
+                static_cast<unsigned long long>(vContext.Key.Key),
+                vPath.c_str());
+        }
+    }
+
+    auto Run(const Options& aOptions)
+        -> void
+    {
+        CrashDump vDump(aOptions.DumpPath);
+        const auto& vHeader = vDump.GetHeader();
+
+        std::printf("Build %u, %llu pages\n", vHeader.BuildNumber,
+            static_cast<unsigned long long>(vDump.NumberOfPages()));
+
+        // The addresses which were not given come from KDDEBUGGER_DATA64
+        auto vDebuggerData = CrashDump::KdDebuggerData{};
+        const auto vHasDebuggerData = vDump.ReadKdDebuggerData(vDebuggerData);
+
+        const auto vGetAddress = [&](std::uint64_t aGiven, std::uint64_t aFromBlock, const char* aName)
+        {
+            if (aGiven)
+            {
+                return aGiven;
+            }
+            if (!vHasDebuggerData)
+            {
+                throw std::runtime_error(std::string("KDDEBUGGER_DATA64 could not be read, so -") + aName +
+                    " has to be given.");
+            }
+            return aFromBlock;
+        };
+
+        const auto vSymbols = ScanSymbols
+        {
+            aOptions.PoolBigPageTable,
+            aOptions.PoolBigPageTableSize,
+            vGetAddress(aOptions.MmSystemRangeStart, vDebuggerData.MmSystemRangeStart, "MmSystemRangeStart"),
+        };
+
+        // Nothing is counted unless it is asked for
+        ScanStatistics vStatisticsStorage;
+        const auto vStatistics = aOptions.JsonPath.empty() ? nullptr : &vStatisticsStorage;
+
+        auto vCountingMemory = std::unique_ptr<CountingMemorySource>();
+        if (vStatistics)
+        {
+            vCountingMemory = std::make_unique<CountingMemorySource>(vDump, *vStatistics);
+        }
+        auto& vScanMemory = vCountingMemory ? static_cast<MemorySource&>(*vCountingMemory) : vDump;
+
+        Scanner vScanner(vScanMemory, vSymbols, PageTableWalk::FindSelfMap(vDump, vHeader.DirectoryTableBase),
+            vHeader.DirectoryTableBase, vHeader.BuildNumber >= 10240);
+        vScanner.SetStatistics(vStatistics);
+        vScanner.SetConfirmation(aOptions.ConfirmContexts);
+
+        // The header holds the value of nt!MmPfnDatabase
+        auto vSource = IndependentPageSource{ aOptions.UsePfnDatabase, 0, 0 };
+        if (vSource.UsePfnDatabase)
+        {
+            vSource.PfnDatabase = vHeader.PfnDataBase;
+            if (!vSource.PfnDatabase)
+            {
+                throw std::runtime_error("The crash dump does not record nt!MmPfnDatabase.");
+            }
+            vSource.HighestPhysicalPage = ReadPointer(vDump,
+                vGetAddress(aOptions.MmHighestPhysicalPage, vDebuggerData.MmHighestPhysicalPage, "MmHighestPhysicalPage"),
+                "nt!MmHighestPhysicalPage");
+        }
+
+        std::ofstream vSink;
+        if (!aOptions.NdjsonPath.empty())
+        {
+            vSink.open(aOptions.NdjsonPath);
+            if (!vSink)
+            {
+                throw std::runtime_error("The NDJSON file could not be created.");
+            }
+        }
+
+        vScanner.SetFindingRoutine([&vSink](const Finding& aFinding)
+        {
+            ShowFinding(aFinding);
+            if (vSink.is_open())
+            {
+                vSink << ToJsonLine(aFinding) << std::endl;
+            }
+        });
+
+        auto vFound = CandidateTable();
+        {
+            ScanStatistics::PhaseTimer vTimer(vStatistics, ScanStatistics::PHASE_SCAN);
+
+            if (vSymbols.PoolBigPageTable)
+            {
+                vFound = vScanner.FindAll(vSource);
+            }
+            else if (vSource.UsePfnDatabase)
+            {
+                std::fprintf(stderr, "The big pool is not scanned without -PoolBigPageTable.\n");
+                vFound = vScanner.FindFromPfnDatabase(vSource.PfnDatabase, vSource.HighestPhysicalPage);
+            }
+            else
+            {
+                std::fprintf(stderr, "The big pool is not scanned without -PoolBigPageTable.\n");
+                vFound = vScanner.FindFromIndependentPages();
+            }
+        }
+
+        std::printf("Summary: %zu page(s) found\n", vFound.Size());
+        for (std::size_t i = 0; i < vFound.Size(); ++i)
+        {
+            ShowFinding(vFound.Get(i));
+        }
+
+        if (!aOptions.DecryptPath.empty())
+        {
+            WriteContexts(vScanner.DecryptContexts(vFound), aOptions.DecryptPath);
+        }
+
+        if (vStatistics)
+        {
+            std::ofstream vFile(aOptions.JsonPath);
+            vFile << vStatistics->ToJson(vScanner.BigPoolFilters());
+            if (!vFile)
+            {
+                throw std::runtime_error("The statistics could not be written.");
+            }
+        }
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    auto vOptions = Options{};
+    try
+    {
+        vOptions = ParseOptions(argc, argv);
+    }
+    catch (std::exception& aWhat)
+    {
+        std::fprintf(stderr, "%s\n\n%s", aWhat.what(), USAGE);
+        return 2;
+    }
+
+    try
+    {
+        Run(vOptions);
+    }
+    catch (std::exception& aWhat)
+    {
+        std::fprintf(stderr, "Error: %s\n", aWhat.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace Sunstrider
+{
+
+    // Where the memory of the analyzed system comes from: the debugger engine
+    // (a live target or a dump opened in WinDbg) or a crash dump file mapped
+    // directly into this process.
+    //
+    // Discovery and dump code only ever see this interface, so they do not
+    // depend on dbgeng. Implementations allow reads from several threads at
+    // once, unless AllowsConcurrentReads says otherwise.
+    class MemorySource
+    {
+    public:
+        virtual ~MemorySource() = default;
+
+        // Reads aBytes at the virtual address aAddress of the kernel address
+        // space. Returns false unless the whole range could be read.
+        virtual auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool = 0;
+
+        // Reads aBytes at the physical address aAddress.
+        virtual auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool = 0;
+
+        // False if the source must only be read from the thread which created
+        // it. Scans over such a source run their tasks on that thread.
+        virtual auto AllowsConcurrentReads() const
+            -> bool
+        {
+            return true;
+        }
+    };
+
+}
@@ -3,17 +3,25 @@
 #include <tuple>
 #include <vector>
 #include <array>
-#include <set>
+#include <memory>
+
+#include "MemorySource.h"
+#include "ReadCache.h"
+#include "CountingMemorySource.h"
+#include "CrashDump.h"
+#include "DbgEngMemorySource.h"
+#include "Scanner.h"
+#include "ContextCipher.h"
+#include "StubEmulator.h"
+#include "ContextLayout.h"
+#include "ByteCensus.h"
+#include "ScratchArena.h"
+#include "AllocationCounter.h"
+#include "SymbolTable.h"
 
 namespace Sunstrider
 {
 
-    struct RandomnessInfo
-    {
-        ULONG NumberOfDistinctiveNumbers;
-        ULONG Ramdomness;
-    };
-
     // Returns the number of 0x00 and 0xff in the given range
     auto GetNumberOfDistinctiveNumbers(
         __in PVOID  aAddress,
@@ -31,23 +39,6 @@ namespace Sunstrider
 
     class PGKd : public ExtExtension
     {
-        // The number of bytes to examine to calculate the number of distinctive
-        // bytes and randomness
-        static constexpr auto EXAMINATION_BYTES = 100;
-
-        // It is not a PatchGuard page if the number of distinctive bytes are bigger
-        // than this number
-        static constexpr auto MAXIMUM_DISTINCTIVE_NUMBER = 5;
-
-        // It is not a PatchGuard page if randomness is smaller than this number
-        static constexpr auto MINIMUM_RANDOMNESS = 50;
-
-        // It is not a PatchGuard page if the size of the page is smaller than this
-        static constexpr auto MINIMUM_REGION_SIZE = 0x004000;
-
-        // It is not a PatchGuard page if the size of the page is larger than this
-        static constexpr auto MAXIMUM_REGION_SIZE = 0xf00000;
-
         // PG$VerifictionPatchGuardImpl 
         // (CmpAppendDllSection : call rax ; rax == PG$VerifictionPatchGuardImpl)
         //
@@ -61,13 +52,49 @@ namespace Sunstrider
         static constexpr auto BUGCHECK_109_ARGS0_KEY = 0xA3A03F5891C8B4E8UI64;
         static constexpr auto BUGCHECK_109_ARGS1_KEY = 0xB3B74BDEE4453415UI64;
 
+        // The memory of the target of the current command (see OpenMemorySource).
+        // Every memory access of PGKd goes through _Memory, which is either the
+        // crash dump given by -dump, or the debugger target behind a cache.
+        // _CountingMemory counts the reads which reach either of them.
+        std::unique_ptr<CrashDump>              _CrashDump;
+        std::unique_ptr<DbgEngMemorySource>     _DbgEngMemory;
+        std::unique_ptr<CountingMemorySource>   _CountingMemory;
+        std::unique_ptr<ReadCache>              _ReadCache;
+        MemorySource*                           _Memory = nullptr;
+
+        // Scratch memory of the commands, allocated once for the extension.
+        // Buffers are released when the scope which allocated them ends.
+        static constexpr std::size_t SCRATCH_ARENA_SIZE = 0x10000;
+        ScratchArena _Scratch { SCRATCH_ARENA_SIZE };
+
+        // Runs the code of an encrypted context to decrypt it (see DumpPatchGuardImpl)
+        StubEmulator _StubEmulator;
+
+        // The nt symbols of the current session. Resolved by the first command
+        // which needs one, and dropped when the session changes.
+        SymbolTable _SymbolTable;
+
+        // The version of the debugger target, for the current session
+        wdk::SystemVersion _SystemVersion = wdk::SystemVersion::Unknown;
+
+        // The layouts of the contexts, read again by every command which
+        // dumps one, so that the layout file can be edited in a session
+        ContextLayouts _ContextLayouts;
+
     public:
         virtual auto Initialize() 
             -> HRESULT override;
 
+        virtual auto OnSessionActive(ULONG64 aArgument)
+            -> void override;
+
+        virtual auto OnSessionInactive(ULONG64 aArgument)
+            -> void override;
+
         EXT_COMMAND_METHOD(findpg);
         EXT_COMMAND_METHOD(analyzepg);
         EXT_COMMAND_METHOD(dumppg);
+        EXT_COMMAND_METHOD(pglayouts);
 
         auto _EFN_Analyze(
             PDEBUG_CLIENT4            aClient,
@@ -79,39 +106,69 @@ namespace Sunstrider
         auto GetSystemVersion(PDEBUG_CONTROL aDbgControl = nullptr, std::string* aTarget = nullptr)
             -> wdk::SystemVersion;
 
+        // The version of the crash dump given by -dump, or of the debugger target
+        auto GetTargetVersion()
+            -> wdk::SystemVersion;
+
+        // The version and the self-map of the target of the current command.
+        // Throws std::runtime_error.
+        auto GetAddressSpace()
+            -> wdk::AddressSpace;
+
         auto IsWindows10OrGreater()
             -> bool;
 
         auto IsWindowsRS1OrGreater()
             -> bool;
 
+        // Must be called at the beginning of every command which reads the
+        // memory of the target. The reads which reach the target, under the
+        // cache, are counted into aStatistics, if it is given, until the
+        // source is closed. Throws std::runtime_error.
+        auto OpenMemorySource(ScanStatistics* aStatistics = nullptr)
+            -> void;
+
+        auto CloseMemorySource()
+            -> void;
+
+        auto ReadVirtual(UINT64 aAddress, PVOID aBuffer, ULONG aBytes)
+            -> HRESULT;
+
+        auto ReadPointer(UINT64 aAddress, UINT64* aPointer)
+            -> HRESULT;
+
         auto GetPfnDatabase()
             -> UINT64;
 
-        auto GetPteBase() 
+        // The physical address of the PML4 of the current process
+        auto GetDirectoryTableBase()
             -> UINT64;
 
-        auto GetPtes(UINT64 aPteBase)
-            -> std::unique_ptr<std::array<wdk::HARDWARE_PTE, wdk::PTE_PER_PAGE>>;
-
-        auto IsNonPagedBigPool(const wdk::POOL_TRACKER_BIG_PAGES& aEntry)
-            -> bool;
-        
-        auto IsPageValidReadWriteExecutable(UINT64 aPteAddress)
-            -> bool;
-
-        auto IsPatchGuardPageAttribute(UINT64 aPageBase)
-            -> bool;
+        auto GetPteBase() 
+            -> UINT64;
 
-        auto FindPatchGuardContextFromBigPagePool()
-            -> std::vector <std::tuple<wdk::POOL_TRACKER_BIG_PAGES, RandomnessInfo>>;
+        // The address of the symbol in the target of the current command.
+        // Throws std::runtime_error if the symbol could not be found, or not
+        // be located in the crash dump given by -dump.
+        auto GetSymbolAddress(SymbolTable::Symbol aSymbol)
+            -> UINT64;
 
-        auto FindPatchGuardContextFromIndependentPages()
-            -> std::vector <std::tuple<UINT64, SIZE_T, RandomnessInfo>>;
+        // Moves the address of a symbol of the debugger session into the
+        // crash dump given by -dump (see GetSymbolAddress)
+        auto GetDumpSymbolAddress(SymbolTable::Symbol aSymbol, UINT64 aSessionAddress)
+            -> UINT64;
 
         auto FindPatchGuardContext()
             -> HRESULT;
 
+        // Displays the statistics of !findpg for -stats, and writes them to
+        // the file given by -json
+        auto ShowScanStatistics(
+            const ScanStatistics&   aStatistics,
+            const FilterCascade&    aBigPoolFilters,
+            std::uint64_t           aHeapAllocations)
+            -> void;
+
         auto GetPGContextTypeString(
             UINT64  aErrorWasFound,
             UINT64  aTypeOfCorruption)
@@ -121,21 +178,33 @@ namespace Sunstrider
             UINT64  aFailureDependent)
             -> void;
 
-        template<typename T>
+        // Reads the layouts from the file given by -layouts, or from
+        // PGContext.layouts next to the extension if there is one, in front
+        // of the reflected ones. Throws std::runtime_error.
+        auto LoadContextLayouts()
+            -> void;
+
+        // Warns of each layout which differs from the reflected
+        // build_XXXX::PGContext of its build (see ContextReflection.h)
+        auto CheckContextLayouts()
+            -> void;
+
+        // Displays aContext, the decrypted bytes of the context at aPGContext
         auto DumpPatchGuardContext(
-            UINT64  aPGContext,
-            UINT64  aPGReason,
-            UINT64  aFailureDependent,
-            UINT64  aTypeOfCorruption,
-            T& aContext)
-            ->HRESULT;
-
-        template<typename PGContextT>
+            UINT64                  aPGContext,
+            UINT64                  aPGReason,
+            UINT64                  aFailureDependent,
+            UINT64                  aTypeOfCorruption,
+            const ContextLayout&    aLayout,
+            const UINT8*            aContext)
+            -> HRESULT;
+
         auto DumpPatchGuardImpl(
-            UINT64  aPGContext,
-            UINT64  aPGReason,
-            UINT64  aFailureDependent, 
-            UINT64  aTypeOfCorruption)
+            UINT64                  aPGContext,
+            UINT64                  aPGReason,
+            UINT64                  aFailureDependent,
+            UINT64                  aTypeOfCorruption,
+            const ContextLayout&    aLayout)
             -> HRESULT;
 
         auto DumpPatchGuard(
@@ -147,45 +216,6 @@ namespace Sunstrider
             -> HRESULT;
     };
 
-    template<typename PGContextT>
-    inline auto PGKd::DumpPatchGuardImpl(
-        UINT64 aPGContext, 
-        UINT64 aPGReason, 
-        UINT64 aFailureDependent,
-        UINT64 aTypeOfCorruption) 
-        -> HRESULT
-    {
-        HRESULT hr = S_OK;
-
-        for (;;)
-        {
-            // In the case of type 0x106, neither the address of PatchGuard context nor
-            // the address of the validation structure are given (do not exist).
-            if (0 == aPGContext && 
-                0 == aPGReason  &&
-                0x106 == aTypeOfCorruption)  // CcBcbProfiler
-            {
-                DumpPatchGuardContextForType106(aFailureDependent);
-                break;
-            }
-
-            auto vReadBytes = 0ul;
-            auto vPGContext = std::make_unique<PGContextT>();
-            hr = m_Data->ReadVirtual(aPGContext, vPGContext.get(), sizeof(PGContextT), &vReadBytes);
-            if (FAILED(hr))
-            {
-                Err("The given address 0x%016I64x is not readable. [DumpPatchGuard]\n",
-                    aPGContext);
-                break;
-            }
-
-            hr = DumpPatchGuardContext(aPGContext, aPGReason, aFailureDependent, aTypeOfCorruption, *vPGContext);
-            break;
-        }
-
-        return hr;
-    }
-
 }
 
 #undef  EXT_CLASS
@@ -0,0 +1,47 @@
+#include "PageTableWalk.h"
+
+#include <array>
+#include <stdexcept>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::uint64_t PageTableWalk::PAGE_SIZE;
+    constexpr PteFilter PageTableWalk::NEXT_TABLE;
+    constexpr PteFilter PageTableWalk::LARGE_PAGE;
+
+    auto PageTableWalk::FindSelfMap(MemorySource& aMemory, std::uint64_t aDirectoryTableBase)
+        -> SelfMap
+    {
+        const auto vPml4 = aDirectoryTableBase & PTE_PFN_MASK;
+
+        std::array<std::uint64_t, ENTRIES_PER_TABLE> vPxes;
+        if (!aMemory.ReadPhysical(vPml4, vPxes.data(), static_cast<std::uint32_t>(TABLE_SIZE)))
+        {
+            throw std::runtime_error("The page directory could not be read.");
+        }
+
+        // The self-map is in the kernel half, so that it is shared by every
+        // process. Only the kernel can access it.
+        for (auto vIndex = ENTRIES_PER_TABLE / 2; vIndex < ENTRIES_PER_TABLE; ++vIndex)
+        {
+            const auto vPxe = vPxes[vIndex];
+            if (!(vPxe & PTE_VALID) || (vPxe & PTE_PFN_MASK) != vPml4)
+            {
+                continue;
+            }
+
+            // Each level is the self-map applied to the previous one
+            const auto vPteBase = 0xFFFF000000000000 | (vIndex << 39);
+            const auto vPdeBase = vPteBase | (vIndex << 30);
+            const auto vPpeBase = vPdeBase | (vIndex << 21);
+            const auto vPxeBase = vPpeBase | (vIndex << 12);
+
+            return SelfMap{ vPxeBase, vPpeBase, vPdeBase, vPteBase };
+        }
+
+        throw std::runtime_error("The self-map could not be found in the page directory.");
+    }
+
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "WorkStealingPool.h"
+#include "ScratchArena.h"
+#include "MemorySource.h"
+#include "PteFilter.h"
+
+
+namespace Sunstrider
+{
+
+    // The definitions shared by every page-table walk
+    class PageTableWalk
+    {
+    public:
+        // x64 (PXE -> PPE -> PDE -> PTE)
+        static constexpr std::size_t   PAGING_LEVELS     = 4;
+
+        static constexpr std::uint64_t PAGE_SIZE         = 0x1000;
+        static constexpr std::uint64_t ENTRIES_PER_TABLE = 512;
+        static constexpr std::uint64_t TABLE_SIZE        = ENTRIES_PER_TABLE * sizeof(std::uint64_t);
+
+        static constexpr std::uint64_t PTE_VALID         = 1ull << 0;
+        static constexpr std::uint64_t PTE_WRITE         = 1ull << 1;
+        static constexpr std::uint64_t PTE_LARGE_PAGE    = 1ull << 7;
+        static constexpr std::uint64_t PTE_NO_EXECUTE    = 1ull << 63;
+
+        // The self-map bases of each level (wdk::PXE_BASE and so on)
+        struct SelfMap
+        {
+            std::uint64_t PxeBase;
+            std::uint64_t PpeBase;
+            std::uint64_t PdeBase;
+            std::uint64_t PteBase;
+        };
+
+        static constexpr std::uint64_t PTE_PFN_MASK      = 0x000FFFFFFFFFF000;
+
+        // Finds the self-map of the page tables at aDirectoryTableBase (the
+        // physical address of the PML4, a CR3 value): the kernel PML4 entry
+        // which maps the PML4 itself. The bases of every level follow from
+        // its index. Throws std::runtime_error if there is no such entry.
+        static auto FindSelfMap(MemorySource& aMemory, std::uint64_t aDirectoryTableBase)
+            -> SelfMap;
+
+    protected:
+        // Entries of the upper levels which lead to a lower table: a large
+        // page is a leaf of its own
+        static constexpr PteFilter NEXT_TABLE = { PTE_VALID, PTE_LARGE_PAGE };
+
+        // Valid large pages of the PDE and PPE levels
+        static constexpr PteFilter LARGE_PAGE = { PTE_VALID | PTE_LARGE_PAGE, 0 };
+
+        // A table to visit: its index among the tables of its level, which
+        // tells the virtual addresses it maps, and its page frame. It fits in
+        // a single qword so that a task only captures two words.
+        struct TableRef
+        {
+            std::uint64_t Index : 24;
+            std::uint64_t Frame : 40;
+        };
+    };
+
+    // The default decisions of a PageTableWalker visitor. A visitor derives
+    // from it and hides the routines it needs, which are called by name, so
+    // they are inlined into the walk. They are called from every worker at
+    // once.
+    //
+    // Levels are numbered from the leaf: 1 is a PTE page, 2 a PDE page, 3 a
+    // PPE page and 4 the PXE page. A visitor also provides:
+    //
+    //   // Reads the 512 entries of the page-table page at the physical
+    //   // address aTableAddress
+    //   auto ReadTable(std::uint64_t aTableAddress, std::uint64_t* aEntries) -> bool;
+    //
+    //   // Called for every PTE selected by LeafFilter. aWorker identifies
+    //   // the calling worker.
+    //   auto Leaf(std::size_t aWorker, std::uint64_t aVirtualAddress, std::uint64_t aPte) -> void;
+    struct PageTableVisitor
+    {
+        // Whether LargePage is called for the valid 2MB and 1GB pages
+        static constexpr bool VISITS_LARGE_PAGES = false;
+
+        // The PTEs of a 4KB page which are passed to Leaf
+        auto LeafFilter() const
+            -> PteFilter
+        {
+            return PteFilter{ PageTableWalk::PTE_VALID, 0 };
+        }
+
+        // Whether the table under aEntry, the entry of aLevel which maps
+        // aVirtualAddress, is not walked
+        auto SkipSubtree(std::size_t /*aLevel*/, std::uint64_t /*aVirtualAddress*/, std::uint64_t /*aEntry*/) const
+            -> bool
+        {
+            return false;
+        }
+
+        auto LargePage(std::size_t /*aWorker*/, std::size_t /*aLevel*/, std::uint64_t /*aVirtualAddress*/, std::uint64_t /*aEntry*/)
+            -> void
+        { }
+
+        // Called once by the thread which completes the walk, which may be a
+        // worker when the pool is shared with other work
+        auto Finish()
+            -> void
+        { }
+    };
+
+    // Walks the kernel half of a page table of Levels levels from the
+    // directory table base, and hands the pages it maps to a Visitor.
+    //
+    // Tables are read by physical address, following the PageFrameNumber of
+    // each entry as the processor does, so reading a table does not need a
+    // translation of its own. The virtual address of a page is computed from
+    // the indexes which lead to it.
+    //
+    // Every table is reduced to a mask of the entries to follow by
+    // FilterPteTable first, so an empty table costs one pass of the kernel,
+    // and only the selected entries are visited. The levels are unrolled at
+    // compile time, and the visitor is called directly, so a visitor which
+    // keeps the default of a decision does not cost anything for it.
+    //
+    // The walk does not depend on the debugger engine, so it can run against
+    // a live target, a dump file or a synthetic image. The root is split into
+    // one task per valid entry, and each of them spawns one task per valid
+    // entry of its table, so that WorkStealingPool can balance the (very
+    // uneven) kernel subtrees between its workers. The lower levels are
+    // walked by the task which reaches them.
+    //
+    // Every worker reads the tables of each level into its own frame, which
+    // is allocated once per walk and reused for every table of that level.
+    template<std::size_t Levels, typename Visitor>
+    class PageTableWalker : public PageTableWalk
+    {
+        static_assert(Levels >= 2, "A page table has at least two levels.");
+
+        template<std::size_t Level>
+        using LevelTag = std::integral_constant<std::size_t, Level>;
+
+        // The levels read by the workers (the root is read by Run)
+        static constexpr std::size_t FRAME_LEVELS = Levels - 1;
+
+        // The bits of a virtual address which are translated
+        static constexpr std::size_t ADDRESS_BITS = 12 + 9 * Levels;
+
+        Visitor&        _Visitor;
+        std::uint64_t   _DirectoryTableBase;
+
+        WorkStealingPool*               _Pool = nullptr;
+        std::vector<ScratchArena>       _Arenas;    // One per worker
+        std::vector<std::uint64_t*>     _Frames;    // FRAME_LEVELS per worker
+
+        std::atomic<std::uint64_t> _LeafTablesVisited { 0 };
+        std::atomic<std::uint64_t> _LeafTablesFound   { 0 };
+
+        // The tasks of the walk which have not completed yet, and one more
+        // until Start has queued all of them
+        std::atomic<std::uint64_t> _PendingTasks      { 0 };
+
+        auto CompleteTask()
+            -> void
+        {
+            if (--_PendingTasks == 0)
+            {
+                _Visitor.Finish();
+            }
+        }
+
+        // Canonical (sign-extended) address of the entry aIndex of aLevel,
+        // counted over the whole level
+        static auto GetVirtualAddress(std::uint64_t aIndex, std::size_t aLevel)
+            -> std::uint64_t
+        {
+            const auto vAddress = aIndex << (12 + 9 * (aLevel - 1));
+            return static_cast<std::uint64_t>(static_cast<std::int64_t>(vAddress << (64 - ADDRESS_BITS)) >> (64 - ADDRESS_BITS));
+        }
+
+        auto ReadTable(std::uint64_t aFrame, std::uint64_t* aEntries)
+            -> void
+        {
+            if (!_Visitor.ReadTable(aFrame << 12, aEntries))
+            {
+                throw std::runtime_error("The given Ptes address could not be read.");
+            }
+        }
+
+        // A worker runs one task at a time, and a task never waits for another
+        // one, so a frame is never used by two tables of the same level at once
+        auto GetFrame(std::size_t aWorker, std::size_t aLevel)
+            -> std::uint64_t*
+        {
+            return _Frames[aWorker * FRAME_LEVELS + aLevel - 1];
+        }
+
+        template<std::size_t Level>
+        auto WalkTable(std::size_t aWorker, std::uint64_t aIndex, std::uint64_t aFrame)
+            -> void
+        {
+            const auto vEntries = GetFrame(aWorker, Level);
+            ReadTable(aFrame, vEntries);
+
+            VisitTable(aWorker, aIndex, vEntries, LevelTag<Level>());
+        }
+
+        // The tables right below the root spawn a task for every table under
+        // them, and the lower tables are walked in place
+        template<std::size_t Level>
+        auto Descend(std::size_t aWorker, std::uint64_t aIndex, std::uint64_t aFrame, LevelTag<Level>, std::true_type)
+            -> void
+        {
+            TableRef vTable;
+            vTable.Index = aIndex;
+            vTable.Frame = aFrame;
+
+            ++_PendingTasks;
+            _Pool->Spawn(aWorker, [this, vTable](std::size_t aWorker)
+            {
+                WalkTable<Level>(aWorker, vTable.Index, vTable.Frame);
+                CompleteTask();
+            });
+        }
+
+        template<std::size_t Level>
+        auto Descend(std::size_t aWorker, std::uint64_t aIndex, std::uint64_t aFrame, LevelTag<Level>, std::false_type)
+            -> void
+        {
+            WalkTable<Level>(aWorker, aIndex, aFrame);
+        }
+
+        // aEntries is the table aIndex of Level, which is above the leaves
+        template<std::size_t Level>
+        auto VisitTable(std::size_t aWorker, std::uint64_t aIndex, const std::uint64_t* aEntries, LevelTag<Level>)
+            -> void
+        {
+            std::uint64_t vMask[PTE_FILTER_MASK_WORDS];
+
+            // Only the PDE and PPE levels map large pages
+            if (Visitor::VISITS_LARGE_PAGES && Level <= 3 &&
+                FilterPteTable(aEntries, LARGE_PAGE, vMask))
+            {
+                ForEachSelectedPte(vMask, [&](std::uint64_t i)
+                {
+                    const auto vIndex = aIndex * ENTRIES_PER_TABLE + i;
+                    _Visitor.LargePage(aWorker, Level, GetVirtualAddress(vIndex, Level), aEntries[i]);
+                });
+            }
+
+            if (!FilterPteTable(aEntries, NEXT_TABLE, vMask))
+            {
+                return;
+            }
+
+            std::uint64_t vDescended = 0;
+            ForEachSelectedPte(vMask, [&](std::uint64_t i)
+            {
+                const auto vIndex = aIndex * ENTRIES_PER_TABLE + i;
+                if (_Visitor.SkipSubtree(Level, GetVirtualAddress(vIndex, Level), aEntries[i]))
+                {
+                    return;
+                }
+
+                ++vDescended;
+                Descend(aWorker, vIndex, (aEntries[i] & PTE_PFN_MASK) >> 12,
+                    LevelTag<Level - 1>(), std::integral_constant<bool, Level == Levels - 1>());
+            });
+
+            // The PTE pages are known one PDE page ahead of the walk
+            if (Level == 2)
+            {
+                _LeafTablesFound += vDescended;
+            }
+        }
+
+        // aEntries is the PTE page aIndex
+        auto VisitTable(std::size_t aWorker, std::uint64_t aIndex, const std::uint64_t* aEntries, LevelTag<1>)
+            -> void
+        {
+            ++_LeafTablesVisited;
+
+            std::uint64_t vMask[PTE_FILTER_MASK_WORDS];
+            if (!FilterPteTable(aEntries, _Visitor.LeafFilter(), vMask))
+            {
+                return;
+            }
+
+            ForEachSelectedPte(vMask, [&](std::uint64_t j)
+            {
+                const auto vIndex = aIndex * ENTRIES_PER_TABLE + j;
+                _Visitor.Leaf(aWorker, GetVirtualAddress(vIndex, 1), aEntries[j]);
+            });
+        }
+
+    public:
+        // aDirectoryTableBase is the physical address of the root (a CR3 value)
+        PageTableWalker(std::uint64_t aDirectoryTableBase, Visitor& aVisitor)
+            : _Visitor(aVisitor)
+            , _DirectoryTableBase(aDirectoryTableBase)
+        { }
+
+        // Walks every root entry from the one mapping aStartAddress to the
+        // last one, and returns when the whole subtree has been visited.
+        auto Run(
+            WorkStealingPool& aPool,
+            std::uint64_t aStartAddress,
+            const std::function<void()>& aPoll = nullptr)
+            -> void
+        {
+            Start(aPool, aStartAddress);
+            aPool.Wait(aPoll);
+        }
+
+        // Queues the walk on aPool, which may run other tasks as well, and
+        // returns at once. The walk is over once aPool.Wait() returns, or
+        // when Visitor::Finish is called.
+        auto Start(WorkStealingPool& aPool, std::uint64_t aStartAddress)
+            -> void
+        {
+            _LeafTablesVisited = 0;
+            _LeafTablesFound   = 0;
+            _PendingTasks      = 1;
+            _Pool = &aPool;
+
+            // The frames of the previous walk are reused if the pool is the same size
+            if (_Arenas.size() != aPool.Size())
+            {
+                _Arenas.clear();
+                _Frames.clear();
+
+                for (std::size_t i = 0; i < aPool.Size(); ++i)
+                {
+                    _Arenas.emplace_back(FRAME_LEVELS * TABLE_SIZE);
+                    for (std::size_t vLevel = 0; vLevel < FRAME_LEVELS; ++vLevel)
+                    {
+                        _Frames.push_back(_Arenas.back().template Allocate<std::uint64_t>(ENTRIES_PER_TABLE));
+                    }
+                }
+            }
+
+            std::array<std::uint64_t, ENTRIES_PER_TABLE> vRoot;
+            ReadTable((_DirectoryTableBase & PTE_PFN_MASK) >> 12, vRoot.data());
+
+            // The root has no large page bit
+            std::uint64_t vMask[PTE_FILTER_MASK_WORDS];
+            FilterPteTable(vRoot.data(), PteFilter{ PTE_VALID, 0 }, vMask);
+
+            const auto vStartIndex = (aStartAddress >> (ADDRESS_BITS - 9)) & (ENTRIES_PER_TABLE - 1);
+            ForEachSelectedPte(vMask, [&](std::uint64_t i)
+            {
+                if (i < vStartIndex || _Visitor.SkipSubtree(Levels, GetVirtualAddress(i, Levels), vRoot[i]))
+                {
+                    return;
+                }
+
+                TableRef vTable;
+                vTable.Index = i;
+                vTable.Frame = (vRoot[i] & PTE_PFN_MASK) >> 12;
+
+                ++_PendingTasks;
+                aPool.Submit([this, vTable](std::size_t aWorker)
+                {
+                    WalkTable<Levels - 1>(aWorker, vTable.Index, vTable.Frame);
+                    CompleteTask();
+                });
+            });
+
+            CompleteTask();
+        }
+
+        // The number of PTE pages visited so far. Safe to call while running.
+        auto LeafTablesVisited() const
+            -> std::uint64_t
+        {
+            return _LeafTablesVisited;
+        }
+
+        // The number of PTE pages found in the PDE pages visited so far, which
+        // grows with the walk. Safe to call while running.
+        auto LeafTablesFound() const
+            -> std::uint64_t
+        {
+            return _LeafTablesFound;
+        }
+    };
+
+}
@@ -5,26 +5,59 @@
 namespace Sunstrider
 {
 
-    Progress::Progress(__in ExtExtension * aExt)
+    constexpr std::chrono::milliseconds Progress::REPORT_INTERVAL;
+
+    Progress::Progress(__in ExtExtension* aExt, const char* aUnit, std::uint64_t aBytesPerItem)
         : _Ext(aExt)
-        , _Progress(0)
+        , _Unit(aUnit)
+        , _BytesPerItem(aBytesPerItem)
+        , _Start(Clock::now())
+        , _LastReport(_Start)
     { }
 
+    // The last line shows the whole phase
     Progress::~Progress()
     {
-        _Ext->Out("\n");
+        Report(Clock::now());
+    }
+
+    auto Progress::Report(Clock::time_point aNow)
+        -> void
+    {
+        const auto vElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(aNow - _Start).count();
+        const auto vMilliseconds = static_cast<std::uint64_t>(vElapsed > 0 ? vElapsed : 1);
+
+        const auto vItemsPerSecond = _Completed * 1000 / vMilliseconds;
+        const auto vKilobytesPerSecond = _Completed * _BytesPerItem / vMilliseconds;
+
+        // The total of a page-table walk grows as tables are found, so it is
+        // never less than what has been done
+        const auto vTotal = _Total > _Completed ? _Total : _Completed;
+        const auto vRemaining = vTotal - _Completed;
+        const auto vSecondsLeft = vItemsPerSecond ? vRemaining / vItemsPerSecond : 0;
+
+        _Ext->Out("    %I64u / %I64u %s (%I64u%%), %I64u %s/s, %I64u KB/s, %I64u s left\n",
+            _Completed, vTotal, _Unit,
+            vTotal ? _Completed * 100 / vTotal : 100,
+            vItemsPerSecond, _Unit, vKilobytesPerSecond, vSecondsLeft);
+
+        _LastReport = aNow;
     }
 
-    Progress & Progress::operator++()
+    auto Progress::Update(std::uint64_t aCompleted, std::uint64_t aTotal)
+        -> bool
     {
-        if (_Progress == 70)
+        _Completed = aCompleted;
+        _Total     = aTotal;
+
+        const auto vNow = Clock::now();
+        if (vNow - _LastReport >= REPORT_INTERVAL)
         {
-            _Progress = 0, _Ext->Out("\n");
+            Report(vNow);
         }
-        ++_Progress, _Ext->Out(".");
 
-        return *this;
+        // S_OK means that an interrupt has been requested
+        return _Ext->m_Control->GetInterrupt() != S_OK;
     }
 
-
 }
@@ -1,21 +1,48 @@
 #pragma once
 #include <cstdint>
+#include <chrono>
 
 
 namespace Sunstrider
 {
 
+    // Displays the progress of a long phase: the items done out of the known
+    // total, the throughput and the estimated time left. A line is written at
+    // most once per REPORT_INTERVAL, however often it is updated.
+    //
+    // Every update also checks whether the user pressed Ctrl+Break, so that
+    // the scan can stop as soon as it asks for it.
     class Progress
     {
-        ExtExtension*   _Ext        = nullptr;
-        std::uint64_t   _Progress   = 0;
+        using Clock = std::chrono::steady_clock;
+
+        ExtExtension*       _Ext            = nullptr;
+        const char*         _Unit           = nullptr;
+        std::uint64_t       _BytesPerItem   = 0;
+        Clock::time_point   _Start;
+        Clock::time_point   _LastReport;
+        std::uint64_t       _Completed      = 0;
+        std::uint64_t       _Total          = 0;
+
+        auto Report(Clock::time_point aNow)
+            -> void;
 
     public:
-        Progress(__in ExtExtension* aExt);
+        static constexpr std::chrono::milliseconds REPORT_INTERVAL{ 1000 };
+
+        // aUnit names the items (such as "tables"), and aBytesPerItem is the
+        // size of one of them in the target
+        Progress(__in ExtExtension* aExt, const char* aUnit, std::uint64_t aBytesPerItem);
 
         ~Progress();
 
-        Progress& operator++();
+        Progress(const Progress&) = delete;
+        Progress& operator=(const Progress&) = delete;
+
+        // Advances the progress up to aCompleted items out of aTotal. Returns
+        // false if the user asked to stop.
+        auto Update(std::uint64_t aCompleted, std::uint64_t aTotal)
+            -> bool;
     };
 
 }
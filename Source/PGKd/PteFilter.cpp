@@ -0,0 +1,84 @@
+#include "PteFilter.h"
+#include "CpuFeatures.h"
+
+#if SUNSTRIDER_X86
+#include <immintrin.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    auto FilterPteTableScalar(const std::uint64_t* aEntries, const PteFilter& aFilter, std::uint64_t* aMask)
+        -> bool
+    {
+        const auto vTested = aFilter.Required | aFilter.Rejected;
+        auto vAny = 0ull;
+
+        for (std::uint64_t vWord = 0; vWord < PTE_FILTER_MASK_WORDS; ++vWord)
+        {
+            auto vBits = 0ull;
+            for (std::uint64_t i = 0; i < 64; ++i)
+            {
+                if ((aEntries[vWord * 64 + i] & vTested) == aFilter.Required)
+                {
+                    vBits |= 1ull << i;
+                }
+            }
+
+            aMask[vWord] = vBits;
+            vAny |= vBits;
+        }
+
+        return vAny != 0;
+    }
+
+#if SUNSTRIDER_X86
+
+    SUNSTRIDER_TARGET_AVX2
+    static auto FilterPteTableAvx2(const std::uint64_t* aEntries, const PteFilter& aFilter, std::uint64_t* aMask)
+        -> bool
+    {
+        const auto vTested   = _mm256_set1_epi64x(static_cast<long long>(aFilter.Required | aFilter.Rejected));
+        const auto vRequired = _mm256_set1_epi64x(static_cast<long long>(aFilter.Required));
+        auto vAny = 0ull;
+
+        for (std::uint64_t vWord = 0; vWord < PTE_FILTER_MASK_WORDS; ++vWord)
+        {
+            const auto vCursor = reinterpret_cast<const __m256i*>(aEntries + vWord * 64);
+            auto vBits = 0ull;
+
+            // 16 compares of 4 entries make the 64 bits of a word
+            for (int i = 0; i < 16; ++i)
+            {
+                const auto vEntries = _mm256_loadu_si256(vCursor + i);
+                const auto vMatch   = _mm256_cmpeq_epi64(_mm256_and_si256(vEntries, vTested), vRequired);
+                vBits |= static_cast<std::uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(vMatch))) << (i * 4);
+            }
+
+            aMask[vWord] = vBits;
+            vAny |= vBits;
+        }
+
+        return vAny != 0;
+    }
+
+#endif
+
+    auto FilterPteTable(const std::uint64_t* aEntries, const PteFilter& aFilter, std::uint64_t* aMask)
+        -> bool
+    {
+        using FilterRoutine = bool(*)(const std::uint64_t*, const PteFilter&, std::uint64_t*);
+
+#if SUNSTRIDER_X86
+        static const auto sFilter = IsAvx2Supported()
+            ? static_cast<FilterRoutine>(&FilterPteTableAvx2)
+            : static_cast<FilterRoutine>(&FilterPteTableScalar);
+#else
+        static const auto sFilter = static_cast<FilterRoutine>(&FilterPteTableScalar);
+#endif
+
+        return sFilter(aEntries, aFilter, aMask);
+    }
+
+}
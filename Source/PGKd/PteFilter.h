@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace Sunstrider
+{
+
+    // The number of entries of a page-table page, and of qwords of its mask
+    static constexpr std::uint64_t PTE_FILTER_ENTRIES    = 512;
+    static constexpr std::uint64_t PTE_FILTER_MASK_WORDS = PTE_FILTER_ENTRIES / 64;
+
+    // Selects the entries e for which (e & (Required | Rejected)) == Required
+    struct PteFilter
+    {
+        std::uint64_t Required;
+        std::uint64_t Rejected;
+    };
+
+    // Sets bit i of aMask (PTE_FILTER_MASK_WORDS qwords) for every entry i of
+    // the page-table page aEntries selected by aFilter, and returns true if
+    // any was. Applied to an upper level with { Valid, LargePage }, the
+    // result tells at once whether the subtree is empty.
+    //
+    // The kernel tests 4 entries per compare with AVX2 when available, and
+    // all implementations return the same mask.
+    auto FilterPteTable(const std::uint64_t* aEntries, const PteFilter& aFilter, std::uint64_t* aMask)
+        -> bool;
+
+    // The portable implementation, used as the reference of the vectorized one
+    auto FilterPteTableScalar(const std::uint64_t* aEntries, const PteFilter& aFilter, std::uint64_t* aMask)
+        -> bool;
+
+    // Returns the index of the lowest set bit of aBits, which must not be 0
+    inline auto FindLowestSetBit(std::uint64_t aBits)
+        -> std::uint64_t
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long vIndex = 0;
+        _BitScanForward64(&vIndex, aBits);
+        return vIndex;
+#elif defined(__GNUC__)
+        return static_cast<std::uint64_t>(__builtin_ctzll(aBits));
+#else
+        std::uint64_t vIndex = 0;
+        while (!(aBits & 1))
+        {
+            aBits >>= 1;
+            ++vIndex;
+        }
+        return vIndex;
+#endif
+    }
+
+    // Calls aRoutine with the index of every entry set in aMask, in order
+    template<typename Routine>
+    inline auto ForEachSelectedPte(const std::uint64_t* aMask, Routine&& aRoutine)
+        -> void
+    {
+        for (std::uint64_t vWord = 0; vWord < PTE_FILTER_MASK_WORDS; ++vWord)
+        {
+            for (auto vBits = aMask[vWord]; vBits; vBits &= vBits - 1)
+            {
+                aRoutine(vWord * 64 + FindLowestSetBit(vBits));
+            }
+        }
+    }
+
+}
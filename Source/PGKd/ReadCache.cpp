@@ -0,0 +1,261 @@
+#include "ReadCache.h"
+
+#include <cstring>
+#include <algorithm>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::uint32_t ReadCache::NO_PAGE;
+
+    ReadCache::ReadCache(MemorySource& aSource, std::size_t aCapacity)
+        : _Source(aSource)
+        , _Capacity(std::max<std::size_t>(aCapacity, 1))
+        , _Pages(new CachePage[_Capacity])
+    {
+        auto vIndexSize = std::size_t(1);
+        while (vIndexSize < _Capacity * 2)
+        {
+            vIndexSize *= 2;
+        }
+
+        _Index.reset(new std::uint32_t[vIndexSize]);
+        _IndexMask = vIndexSize - 1;
+        std::fill(_Index.get(), _Index.get() + vIndexSize, NO_PAGE);
+    }
+
+    auto ReadCache::IndexSlot(std::uint64_t aPageBase) const
+        -> std::size_t
+    {
+        // Fibonacci hashing of the page number
+        return static_cast<std::size_t>(((aPageBase / CACHE_PAGE_SIZE) * 0x9E3779B97F4A7C15ull) >> 32) & _IndexMask;
+    }
+
+    auto ReadCache::Find(std::uint64_t aPageBase) const
+        -> std::uint32_t
+    {
+        for (auto vSlot = IndexSlot(aPageBase); _Index[vSlot] != NO_PAGE; vSlot = (vSlot + 1) & _IndexMask)
+        {
+            if (_Pages[_Index[vSlot]].Base == aPageBase)
+            {
+                return _Index[vSlot];
+            }
+        }
+        return NO_PAGE;
+    }
+
+    auto ReadCache::RemoveFromIndex(std::uint64_t aPageBase)
+        -> void
+    {
+        auto vSlot = IndexSlot(aPageBase);
+        while (_Pages[_Index[vSlot]].Base != aPageBase)
+        {
+            vSlot = (vSlot + 1) & _IndexMask;
+        }
+
+        // Shift back the following entries of the cluster which would not be
+        // found anymore once this slot is free
+        for (auto vNext = (vSlot + 1) & _IndexMask; _Index[vNext] != NO_PAGE; vNext = (vNext + 1) & _IndexMask)
+        {
+            const auto vHome = IndexSlot(_Pages[_Index[vNext]].Base);
+            if (((vNext - vHome) & _IndexMask) >= ((vNext - vSlot) & _IndexMask))
+            {
+                _Index[vSlot] = _Index[vNext];
+                vSlot = vNext;
+            }
+        }
+
+        _Index[vSlot] = NO_PAGE;
+    }
+
+    auto ReadCache::Unlink(std::uint32_t aPage)
+        -> void
+    {
+        auto& vPage = _Pages[aPage];
+        (vPage.Newer != NO_PAGE ? _Pages[vPage.Newer].Older : _Newest) = vPage.Older;
+        (vPage.Older != NO_PAGE ? _Pages[vPage.Older].Newer : _Oldest) = vPage.Newer;
+    }
+
+    auto ReadCache::LinkAsNewest(std::uint32_t aPage)
+        -> void
+    {
+        auto& vPage = _Pages[aPage];
+        vPage.Newer = NO_PAGE;
+        vPage.Older = _Newest;
+        (_Newest != NO_PAGE ? _Pages[_Newest].Newer : _Oldest) = aPage;
+        _Newest = aPage;
+    }
+
+    auto ReadCache::Lookup(std::uint64_t aPageBase, std::uint64_t aOffset, void* aBuffer, std::uint64_t aBytes, bool& aReadable)
+        -> bool
+    {
+        const auto vFound = Find(aPageBase);
+        if (vFound == NO_PAGE)
+        {
+            return false;
+        }
+
+        ++_Hits;
+
+        // Move it to the front as the most recently used one
+        Unlink(vFound);
+        LinkAsNewest(vFound);
+
+        const auto& vPage = _Pages[vFound];
+        aReadable = vPage.Readable;
+        if (aReadable)
+        {
+            memcpy(aBuffer, vPage.Bytes.data() + aOffset, static_cast<std::size_t>(aBytes));
+        }
+        return true;
+    }
+
+    auto ReadCache::Insert(std::uint64_t aPageBase, bool aReadable, const std::uint8_t* aBytes)
+        -> void
+    {
+        // Another worker may have fetched the same page in the meantime
+        if (Find(aPageBase) != NO_PAGE)
+        {
+            return;
+        }
+
+        // Recycle the least recently used page once the cache is full
+        auto vPage = NO_PAGE;
+        if (_PagesInUse >= _Capacity)
+        {
+            vPage = _Oldest;
+            RemoveFromIndex(_Pages[vPage].Base);
+            Unlink(vPage);
+        }
+        else
+        {
+            vPage = static_cast<std::uint32_t>(_PagesInUse++);
+        }
+
+        auto& vEntry = _Pages[vPage];
+        vEntry.Base     = aPageBase;
+        vEntry.Readable = aReadable;
+        memcpy(vEntry.Bytes.data(), aBytes, vEntry.Bytes.size());
+        LinkAsNewest(vPage);
+
+        auto vSlot = IndexSlot(aPageBase);
+        while (_Index[vSlot] != NO_PAGE)
+        {
+            vSlot = (vSlot + 1) & _IndexMask;
+        }
+        _Index[vSlot] = vPage;
+    }
+
+    auto ReadCache::ReadPage(std::uint64_t aPageBase, std::uint64_t aOffset, void* aBuffer, std::uint64_t aBytes)
+        -> bool
+    {
+        {
+            std::lock_guard<std::mutex> vLock(_Lock);
+
+            auto vReadable = false;
+            if (Lookup(aPageBase, aOffset, aBuffer, aBytes, vReadable))
+            {
+                return vReadable;
+            }
+
+            ++_Misses;
+        }
+
+        std::array<std::uint8_t, CACHE_PAGE_SIZE> vBytes;
+        const auto vReadable = _Source.ReadVirtual(aPageBase, vBytes.data(), static_cast<std::uint32_t>(vBytes.size()));
+        if (vReadable)
+        {
+            memcpy(aBuffer, vBytes.data() + aOffset, static_cast<std::size_t>(aBytes));
+        }
+
+        std::lock_guard<std::mutex> vLock(_Lock);
+        Insert(aPageBase, vReadable, vBytes.data());
+
+        return vReadable;
+    }
+
+    auto ReadCache::ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        if (aBytes > MAXIMUM_CACHEABLE_READ)
+        {
+            {
+                std::lock_guard<std::mutex> vLock(_Lock);
+                ++_Bypasses;
+            }
+            return _Source.ReadVirtual(aAddress, aBuffer, aBytes);
+        }
+
+        auto vCursor    = static_cast<std::uint8_t*>(aBuffer);
+        auto vAddress   = aAddress;
+        auto vRemaining = static_cast<std::uint64_t>(aBytes);
+
+        while (vRemaining)
+        {
+            const auto vPageBase   = vAddress & ~CACHE_PAGE_MASK;
+            const auto vPageOffset = vAddress &  CACHE_PAGE_MASK;
+            const auto vBytes      = std::min(vRemaining, CACHE_PAGE_SIZE - vPageOffset);
+
+            if (!ReadPage(vPageBase, vPageOffset, vCursor, vBytes))
+            {
+                return false;
+            }
+
+            vCursor    += vBytes;
+            vAddress   += vBytes;
+            vRemaining -= vBytes;
+        }
+
+        return true;
+    }
+
+    auto ReadCache::ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        return _Source.ReadPhysical(aAddress, aBuffer, aBytes);
+    }
+
+    auto ReadCache::AllowsConcurrentReads() const
+        -> bool
+    {
+        return _Source.AllowsConcurrentReads();
+    }
+
+    auto ReadCache::Clear()
+        -> void
+    {
+        std::lock_guard<std::mutex> vLock(_Lock);
+
+        std::fill(_Index.get(), _Index.get() + _IndexMask + 1, NO_PAGE);
+        _PagesInUse = 0;
+        _Newest     = NO_PAGE;
+        _Oldest     = NO_PAGE;
+
+        _Hits     = 0;
+        _Misses   = 0;
+        _Bypasses = 0;
+    }
+
+    auto ReadCache::Hits() const
+        -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> vLock(_Lock);
+        return _Hits;
+    }
+
+    auto ReadCache::Misses() const
+        -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> vLock(_Lock);
+        return _Misses;
+    }
+
+    auto ReadCache::Bypasses() const
+        -> std::uint64_t
+    {
+        std::lock_guard<std::mutex> vLock(_Lock);
+        return _Bypasses;
+    }
+
+}
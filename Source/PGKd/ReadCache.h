@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <mutex>
+
+#include "MemorySource.h"
+
+
+namespace Sunstrider
+{
+
+    // Page-granular LRU cache in front of a slow memory source.
+    //
+    // Every read issued by the debugger engine is a round-trip to the target
+    // (or to the dump file), and !findpg issues a lot of tiny ones: a single
+    // PTE, a single PDE, a 100 bytes sample. Neighbouring candidates share
+    // the same page-table pages, so caching whole pages turns hundreds of
+    // round-trips into one.
+    //
+    // The cache is shared between the workers of a parallel walk. A miss is
+    // served without holding the lock, so that hits from other workers are not
+    // blocked behind a slow read. Physical reads are passed through.
+    //
+    // All the pages and the index are allocated when the cache is created:
+    // the LRU list links the pages by index, and the index is an open
+    // addressing table, so neither a hit nor a miss allocates.
+    class ReadCache : public MemorySource
+    {
+    public:
+        static constexpr std::uint64_t CACHE_PAGE_SIZE  = 0x1000;
+        static constexpr std::uint64_t CACHE_PAGE_MASK  = CACHE_PAGE_SIZE - 1;
+
+        // The default capacity (in pages) of the cache, 32MB
+        static constexpr std::size_t   DEFAULT_CAPACITY = 0x2000;
+
+        // Reads larger than this are passed through without being cached,
+        // so that a one-shot bulk read does not flush the whole cache.
+        static constexpr std::uint32_t MAXIMUM_CACHEABLE_READ = 0x10 * CACHE_PAGE_SIZE;
+
+    private:
+        static constexpr std::uint32_t NO_PAGE = ~0u;
+
+        struct CachePage
+        {
+            std::uint64_t   Base;
+            bool            Readable;
+            std::uint32_t   Newer;      // The previous page of the LRU list
+            std::uint32_t   Older;      // The next page of the LRU list
+            std::array<std::uint8_t, CACHE_PAGE_SIZE> Bytes;
+        };
+
+        mutable std::mutex _Lock;
+
+        MemorySource&   _Source;
+        std::size_t     _Capacity;
+
+        std::unique_ptr<CachePage[]>        _Pages;
+        std::size_t                         _PagesInUse = 0;
+        std::uint32_t                       _Newest     = NO_PAGE;
+        std::uint32_t                       _Oldest     = NO_PAGE;
+
+        // Linear probing table of page indexes (NO_PAGE when free), at least
+        // twice as large as the capacity
+        std::unique_ptr<std::uint32_t[]>    _Index;
+        std::size_t                         _IndexMask  = 0;
+
+        std::uint64_t   _Hits       = 0;
+        std::uint64_t   _Misses     = 0;
+        std::uint64_t   _Bypasses   = 0;
+
+        // Copies the cached bytes to aBuffer, or returns false on a miss.
+        // Must be called with _Lock held.
+        auto Lookup(std::uint64_t aPageBase, std::uint64_t aOffset, void* aBuffer, std::uint64_t aBytes, bool& aReadable)
+            -> bool;
+
+        // Inserts a page fetched by the caller. Must be called with _Lock held.
+        auto Insert(std::uint64_t aPageBase, bool aReadable, const std::uint8_t* aBytes)
+            -> void;
+
+        // The LRU list and the index. Must be called with _Lock held.
+        auto Find(std::uint64_t aPageBase) const
+            -> std::uint32_t;
+
+        auto IndexSlot(std::uint64_t aPageBase) const
+            -> std::size_t;
+
+        auto RemoveFromIndex(std::uint64_t aPageBase)
+            -> void;
+
+        auto Unlink(std::uint32_t aPage)
+            -> void;
+
+        auto LinkAsNewest(std::uint32_t aPage)
+            -> void;
+
+        auto ReadPage(std::uint64_t aPageBase, std::uint64_t aOffset, void* aBuffer, std::uint64_t aBytes)
+            -> bool;
+
+    public:
+        ReadCache(MemorySource& aSource, std::size_t aCapacity = DEFAULT_CAPACITY);
+
+        // Served from the cache whenever possible
+        auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        // As the source behind it
+        auto AllowsConcurrentReads() const
+            -> bool override;
+
+        // Drops all cached pages. Must be called whenever the target may have
+        // run since the last read. Counters are reset as well.
+        auto Clear()
+            -> void;
+
+        auto Hits() const
+            -> std::uint64_t;
+
+        auto Misses() const
+            -> std::uint64_t;
+
+        auto Bypasses() const
+            -> std::uint64_t;
+    };
+
+}
@@ -0,0 +1,121 @@
+#include "ScanStatistics.h"
+
+#include <sstream>
+
+
+namespace Sunstrider
+{
+
+    ScanStatistics::ScanStatistics()
+    {
+        for (auto& vCounter : _Counters)
+        {
+            vCounter = 0;
+        }
+        _PhaseNanoseconds.fill(0);
+    }
+
+    auto ScanStatistics::Set(Counter aCounter, std::uint64_t aValue)
+        -> void
+    {
+        _Counters[aCounter] = aValue;
+    }
+
+    auto ScanStatistics::Get(Counter aCounter) const
+        -> std::uint64_t
+    {
+        return _Counters[aCounter];
+    }
+
+    // Each phase is timed by a single thread, which may be a worker
+    auto ScanStatistics::AddPhaseTime(Phase aPhase, std::chrono::steady_clock::duration aElapsed)
+        -> void
+    {
+        _PhaseNanoseconds[aPhase] += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(aElapsed).count());
+    }
+
+    auto ScanStatistics::GetPhaseNanoseconds(Phase aPhase) const
+        -> std::uint64_t
+    {
+        return _PhaseNanoseconds[aPhase];
+    }
+
+    auto ScanStatistics::GetName(Counter aCounter)
+        -> const char*
+    {
+        switch (aCounter)
+        {
+        case BIG_POOL_ENTRIES:      return "bigPoolEntries";
+        case BIG_POOL_PREFILTERED:  return "bigPoolPrefiltered";
+        case BIG_POOL_ACCEPTED:     return "bigPoolAccepted";
+        case PAGE_TABLES:           return "pageTables";
+        case PFN_ENTRIES:           return "pfnEntries";
+        case LARGE_PAGES:           return "largePages";
+        case PAGES_SCORED:          return "pagesScored";
+        case PAGES_ACCEPTED:        return "pagesAccepted";
+        case CONTEXTS_CONFIRMED:    return "contextsConfirmed";
+        case CONTEXTS_REJECTED:     return "contextsRejected";
+        case VIRTUAL_READS:         return "virtualReads";
+        case PHYSICAL_READS:        return "physicalReads";
+        case FAILED_READS:          return "failedReads";
+        case BYTES_READ:            return "bytesRead";
+        case READ_NANOSECONDS:      return "readNanoseconds";
+        case CACHE_HITS:            return "cacheHits";
+        case CACHE_MISSES:          return "cacheMisses";
+        case CACHE_BYPASSES:        return "cacheBypasses";
+        default:                    return "unknown";
+        }
+    }
+
+    auto ScanStatistics::GetName(Phase aPhase)
+        -> const char*
+    {
+        switch (aPhase)
+        {
+        case PHASE_SETUP:               return "setup";
+        case PHASE_BIG_POOL:            return "bigPool";
+        case PHASE_INDEPENDENT_PAGES:   return "independentPages";
+        case PHASE_SCAN:                return "scan";
+        default:                        return "unknown";
+        }
+    }
+
+    // Every name is a fixed identifier, so nothing has to be escaped
+    auto ScanStatistics::ToJson(const FilterCascade& aBigPoolFilters) const
+        -> std::string
+    {
+        std::ostringstream vJson;
+
+        vJson << "{\n  \"counters\": {";
+        for (std::size_t i = 0; i < NUMBER_OF_COUNTERS; ++i)
+        {
+            const auto vCounter = static_cast<Counter>(i);
+            vJson << (i ? "," : "") << "\n    \"" << GetName(vCounter) << "\": " << Get(vCounter);
+        }
+
+        vJson << "\n  },\n  \"phaseNanoseconds\": {";
+        for (std::size_t i = 0; i < NUMBER_OF_PHASES; ++i)
+        {
+            const auto vPhase = static_cast<Phase>(i);
+            vJson << (i ? "," : "") << "\n    \"" << GetName(vPhase) << "\": " << GetPhaseNanoseconds(vPhase);
+        }
+
+        vJson << "\n  },\n  \"bigPoolFilters\": [";
+        auto vFirst = true;
+        aBigPoolFilters.ForEachStage([&vJson, &vFirst](const FilterCascade::StageCounters& aStage)
+        {
+            vJson << (vFirst ? "" : ",")
+                  << "\n    { \"name\": \"" << aStage.Name << "\""
+                  << ", \"escalation\": " << (aStage.IsEscalation ? "true" : "false")
+                  << ", \"evaluated\": " << aStage.Evaluated
+                  << ", \"rejected\": " << aStage.Evaluated - aStage.Passed
+                  << ", \"nanoseconds\": " << aStage.Nanoseconds << " }";
+            vFirst = false;
+        });
+        vJson << "\n  ]\n}\n";
+
+        return vJson.str();
+    }
+
+}
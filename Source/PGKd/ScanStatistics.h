@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "FilterCascade.h"
+
+
+namespace Sunstrider
+{
+
+    // Counters and timers of a whole !findpg run, which tell where the time
+    // goes: how many entries and pages each phase visited, what the filters
+    // rejected, how many reads reached the memory source and how long they
+    // took, and the wall time of each phase.
+    //
+    // The scanner only updates them when it has been given one, and it adds
+    // its counts once per chunk or per table, so a scan without statistics
+    // does not pay for them. Counters are atomic, as the workers of a phase
+    // update them at once.
+    class ScanStatistics
+    {
+    public:
+        enum Counter : std::size_t
+        {
+            BIG_POOL_ENTRIES,       // PoolBigPageTable entries read
+            BIG_POOL_PREFILTERED,   // Entries which passed the prefilter
+            BIG_POOL_ACCEPTED,      // Entries which passed every check
+            PAGE_TABLES,            // PTE pages walked
+            PFN_ENTRIES,            // MMPFN entries read
+            LARGE_PAGES,            // Executable large pages scanned
+            PAGES_SCORED,           // Pages whose contents were examined
+            PAGES_ACCEPTED,         // Independent pages which passed
+            CONTEXTS_CONFIRMED,     // Candidates whose key was recovered, with -confirm
+            CONTEXTS_REJECTED,      // Candidates which did not decrypt
+            VIRTUAL_READS,          // Reads which reached the target, under the cache
+            PHYSICAL_READS,
+            FAILED_READS,
+            BYTES_READ,             // Bytes fetched from the target
+            READ_NANOSECONDS,       // Time spent in reads, summed over threads
+            CACHE_HITS,
+            CACHE_MISSES,
+            CACHE_BYPASSES,
+            NUMBER_OF_COUNTERS,
+        };
+
+        enum Phase : std::size_t
+        {
+            PHASE_SETUP,            // Symbols, self-map and directory table base
+            PHASE_BIG_POOL,
+            PHASE_INDEPENDENT_PAGES,
+            PHASE_SCAN,             // Both phases above, which run at once
+            NUMBER_OF_PHASES,
+        };
+
+        // Adds the time from its creation to its destruction to aPhase.
+        // Does nothing without statistics.
+        class PhaseTimer
+        {
+            ScanStatistics*                         _Statistics;
+            Phase                                   _Phase;
+            std::chrono::steady_clock::time_point   _Start;
+
+        public:
+            PhaseTimer(ScanStatistics* aStatistics, Phase aPhase)
+                : _Statistics(aStatistics)
+                , _Phase(aPhase)
+                , _Start(std::chrono::steady_clock::now())
+            { }
+
+            ~PhaseTimer()
+            {
+                if (_Statistics)
+                {
+                    _Statistics->AddPhaseTime(_Phase, std::chrono::steady_clock::now() - _Start);
+                }
+            }
+
+            PhaseTimer(const PhaseTimer&) = delete;
+            PhaseTimer& operator=(const PhaseTimer&) = delete;
+        };
+
+    private:
+        std::array<std::atomic<std::uint64_t>, NUMBER_OF_COUNTERS>  _Counters;
+        std::array<std::uint64_t, NUMBER_OF_PHASES>                 _PhaseNanoseconds;
+
+    public:
+        ScanStatistics();
+
+        ScanStatistics(const ScanStatistics&) = delete;
+        ScanStatistics& operator=(const ScanStatistics&) = delete;
+
+        auto Add(Counter aCounter, std::uint64_t aValue = 1)
+            -> void
+        {
+            _Counters[aCounter].fetch_add(aValue, std::memory_order_relaxed);
+        }
+
+        auto Set(Counter aCounter, std::uint64_t aValue)
+            -> void;
+
+        auto Get(Counter aCounter) const
+            -> std::uint64_t;
+
+        auto AddPhaseTime(Phase aPhase, std::chrono::steady_clock::duration aElapsed)
+            -> void;
+
+        auto GetPhaseNanoseconds(Phase aPhase) const
+            -> std::uint64_t;
+
+        // The names used in the JSON document
+        static auto GetName(Counter aCounter)
+            -> const char*;
+
+        static auto GetName(Phase aPhase)
+            -> const char*;
+
+        // A JSON document of every counter and phase, and of the stages of
+        // aBigPoolFilters
+        auto ToJson(const FilterCascade& aBigPoolFilters) const
+            -> std::string;
+    };
+
+}
@@ -0,0 +1,1202 @@
+#include "Scanner.h"
+#include "WorkStealingPool.h"
+#include "BigPoolPrefilter.h"
+#include "ScratchArena.h"
+#include "scope_guard.h"
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace Sunstrider
+{
+
+    // Bound to references by std::min
+    constexpr std::uint64_t Scanner::PFN_CHUNK_ENTRIES;
+    constexpr std::uint64_t Scanner::BIG_POOL_CHUNK_ENTRIES;
+    constexpr std::uint64_t Scanner::CANCEL_POLL_INTERVAL;
+
+    Scanner::Scanner(
+        MemorySource&                   aMemory,
+        const ScanSymbols&              aSymbols,
+        const PageTableWalk::SelfMap&   aSelfMap,
+        std::uint64_t                   aDirectoryTableBase,
+        bool                            aIsWindows10OrGreater)
+        : _Memory(aMemory)
+        , _Symbols(aSymbols)
+        , _SelfMap(aSelfMap)
+        , _DirectoryTableBase(aDirectoryTableBase)
+        , _IsWindows10OrGreater(aIsWindows10OrGreater)
+        , _Pool(GetWorkers(std::max<std::size_t>(std::thread::hardware_concurrency(), 2)))
+        , _BigPoolReader(GetWorkers(1))
+    {
+        // The size has been checked by the prefilter already
+        _BigPoolFilters.AddStage("pool type");
+        _BigPoolFilters.AddStage("page attribute");
+        _BigPoolFilters.AddStage("sample");
+        _BigPoolFilters.AddEscalation("full page");
+    }
+
+    auto Scanner::GetWorkers(std::size_t aWorkers) const
+        -> std::size_t
+    {
+        return _Memory.AllowsConcurrentReads() ? std::max<std::size_t>(aWorkers, 1) : 0;
+    }
+
+    auto Scanner::SetStatistics(ScanStatistics* aStatistics)
+        -> void
+    {
+        _Statistics = aStatistics;
+    }
+
+    auto Scanner::SetFindingRoutine(FindingRoutine aRoutine)
+        -> void
+    {
+        _FindingRoutine = std::move(aRoutine);
+    }
+
+    auto Scanner::SetConfirmation(bool aConfirmContexts)
+        -> void
+    {
+        _ConfirmContexts = aConfirmContexts;
+    }
+
+    auto Scanner::Count(ScanStatistics::Counter aCounter, std::uint64_t aValue)
+        -> void
+    {
+        if (_Statistics)
+        {
+            _Statistics->Add(aCounter, aValue);
+        }
+    }
+
+    auto Scanner::RecordPhase(ScanStatistics::Phase aPhase, std::chrono::steady_clock::time_point aStart)
+        -> void
+    {
+        if (_Statistics)
+        {
+            _Statistics->AddPhaseTime(aPhase, std::chrono::steady_clock::now() - aStart);
+        }
+    }
+
+    auto Scanner::ReportProgress(
+        const ProgressRoutine&  aProgress,
+        std::uint64_t           aCompleted,
+        std::uint64_t           aTotal,
+        WorkStealingPool*       aPool)
+        -> void
+    {
+        if (!aProgress || aProgress(aCompleted, aTotal))
+        {
+            return;
+        }
+
+        _Cancelled = true;
+        if (aPool)
+        {
+            aPool->Cancel();
+        }
+    }
+
+    auto Scanner::IsCancelled() const
+        -> bool
+    {
+        return _Cancelled.load(std::memory_order_relaxed);
+    }
+
+    auto Scanner::BeginScan()
+        -> void
+    {
+        _Cancelled = false;
+
+        std::lock_guard<std::mutex> vLock(_FindingsLock);
+        _Candidates.Clear();
+        _DeliveredFindings = 0;
+    }
+
+    auto Scanner::Publish(Finding aFinding)
+        -> void
+    {
+        std::lock_guard<std::mutex> vLock(_FindingsLock);
+        aFinding.SequenceId = _Candidates.Size() + 1;
+        _Candidates.Append(aFinding);
+    }
+
+    auto Scanner::Publish(const BigPoolEntry& aEntry, const RandomnessInfo& aCensus, std::uint64_t aContext)
+        -> void
+    {
+        Count(ScanStatistics::BIG_POOL_ACCEPTED);
+        Publish(Finding{ 0, Finding::BIG_POOL, aEntry.Va, aEntry.NumberOfBytes, aCensus, aEntry.Tag, 0, aContext });
+    }
+
+    auto Scanner::Publish(
+        std::uint64_t           aVirtualAddress,
+        std::uint64_t           aSize,
+        const RandomnessInfo&   aCensus,
+        std::uint64_t           aMappingSize,
+        std::uint64_t           aContext)
+        -> void
+    {
+        Count(ScanStatistics::PAGES_ACCEPTED);
+        Publish(Finding{ 0, Finding::INDEPENDENT_PAGE, aVirtualAddress, aSize, aCensus, 0, aMappingSize, aContext });
+    }
+
+    // The pool is idle, so the candidates can be taken without the lock
+    auto Scanner::TakeCandidates()
+        -> CandidateTable
+    {
+        auto vCandidates = std::move(_Candidates);
+        _Candidates.Clear();
+        _DeliveredFindings = 0;
+
+        vCandidates.SortByAddress();
+        return vCandidates;
+    }
+
+    // The routine is called without the lock, so the workers can go on
+    // publishing while the host displays what they found
+    auto Scanner::DeliverFindings()
+        -> void
+    {
+        if (!_FindingRoutine)
+        {
+            return;
+        }
+
+        _Delivering.clear();
+        {
+            std::lock_guard<std::mutex> vLock(_FindingsLock);
+            for (; _DeliveredFindings < _Candidates.Size(); ++_DeliveredFindings)
+            {
+                _Delivering.push_back(_Candidates.Get(_DeliveredFindings));
+            }
+        }
+
+        for (const auto& vFinding : _Delivering)
+        {
+            _FindingRoutine(vFinding);
+        }
+    }
+
+    auto Scanner::ThrowIfCancelled() const
+        -> void
+    {
+        if (IsCancelled())
+        {
+            throw std::runtime_error("The analysis has been cancelled.");
+        }
+    }
+
+    auto Scanner::ReadPointer(std::uint64_t aAddress, const char* aName)
+        -> std::uint64_t
+    {
+        auto vPointer = 0ull;
+        if (!_Memory.ReadVirtual(aAddress, &vPointer, sizeof(vPointer)))
+        {
+            throw std::runtime_error(std::string(aName) + " could not be read.");
+        }
+        return vPointer;
+    }
+
+    auto Scanner::IsNonPagedBigPool(const BigPoolEntry& aEntry)
+        -> bool
+    {
+        bool vNonPaged = false;
+        switch (aEntry.PoolType)
+        {
+        default:
+            break;
+
+        case 0:     // NonPagedPool
+        case 2:     // NonPagedPoolMustSucceed
+        case 4:     // NonPagedPoolCacheAligned
+        case 6:     // NonPagedPoolCacheAlignedMustS
+        case 32:    // NonPagedPoolSession
+        case 34:    // NonPagedPoolMustSucceedSession
+        case 36:    // NonPagedPoolCacheAlignedSession
+        case 512:   // NonPagedPoolNx
+        case 516:   // NonPagedPoolNxCacheAligned
+        case 544:   // NonPagedPoolSessionNx
+            vNonPaged = true;
+            break;
+        }
+
+        return vNonPaged;
+    }
+
+    // Returns true when page protection of the given page is
+    // Readable/Writable/Executable.
+    auto Scanner::IsPageValidReadWriteExecutable(std::uint64_t aPteAddress)
+        -> bool
+    {
+        auto vPte = 0ull;
+        if (!_Memory.ReadVirtual(aPteAddress, &vPte, sizeof(vPte)))
+        {
+            return false;
+        }
+
+        return (vPte & PageTableWalk::PTE_VALID) &&
+               (vPte & PageTableWalk::PTE_WRITE) &&
+              !(vPte & PageTableWalk::PTE_NO_EXECUTE);
+    }
+
+    // Returns true when page protection of the given page or a parant page
+    // of the given page is Valid and Readable/Writable/Executable.
+    auto Scanner::IsPatchGuardPageAttribute(std::uint64_t aPageBase)
+        -> bool
+    {
+        // A 1GB page has neither a PDE nor a PTE, and the self-map would read
+        // the page itself as its tables
+        const auto vPpe = _SelfMap.PpeBase + ((aPageBase >> 27) & 0x1FFFF8);
+        auto vPpeValue = 0ull;
+        if (_Memory.ReadVirtual(vPpe, &vPpeValue, sizeof(vPpeValue)) &&
+            (vPpeValue & PageTableWalk::PTE_VALID) &&
+            (vPpeValue & PageTableWalk::PTE_LARGE_PAGE))
+        {
+            return IsPageValidReadWriteExecutable(vPpe);
+        }
+
+        const auto vPte = _SelfMap.PteBase + ((aPageBase >> 9) & 0x7FFFFFFFF8);
+        if (IsPageValidReadWriteExecutable(vPte))
+        {
+            return true;
+        }
+        const auto vPde = _SelfMap.PdeBase + ((aPageBase >> 18) & 0x3FFFFFF8);
+        if (IsPageValidReadWriteExecutable(vPde))
+        {
+            return true;
+        }
+        return false;
+    }
+
+    auto Scanner::IsPatchGuardSample(std::uint64_t aAddress, RandomnessInfo& aCensus)
+        -> bool
+    {
+        // Read and check randomness of the contents
+        std::array<std::uint8_t, EXAMINATION_BYTES> vContents;
+        if (!_Memory.ReadVirtual(aAddress, vContents.data(), static_cast<std::uint32_t>(vContents.size())))
+        {
+            return false;
+        }
+
+        aCensus = TakeByteCensus(vContents.data(), EXAMINATION_BYTES);
+
+        if (aCensus.NumberOfDistinctiveNumbers <= MAXIMUM_DISTINCTIVE_NUMBER &&
+            aCensus.Ramdomness >= MINIMUM_RANDOMNESS)
+        {
+            return true;
+        }
+
+        // Only look at the rest of the page when the sample is close
+        if (aCensus.NumberOfDistinctiveNumbers > MAXIMUM_DISTINCTIVE_NUMBER + BORDERLINE_DISTINCTIVE_MARGIN ||
+            aCensus.Ramdomness + BORDERLINE_RANDOMNESS_MARGIN < MINIMUM_RANDOMNESS)
+        {
+            return false;
+        }
+
+        return _BigPoolFilters.Measure(STAGE_FULL_PAGE, [this, aAddress]()
+        {
+            return IsPatchGuardFullPage(aAddress);
+        });
+    }
+
+    auto Scanner::IsPatchGuardFullPage(std::uint64_t aAddress)
+        -> bool
+    {
+        constexpr auto NUMBER_OF_SAMPLES = PageTableWalk::PAGE_SIZE / EXAMINATION_BYTES;
+
+        std::array<std::uint8_t, PageTableWalk::PAGE_SIZE> vContents;
+        if (!_Memory.ReadVirtual(aAddress, vContents.data(), static_cast<std::uint32_t>(vContents.size())))
+        {
+            return false;
+        }
+
+        std::uint64_t vPassed = 0;
+        for (std::uint64_t i = 0; i < NUMBER_OF_SAMPLES; ++i)
+        {
+            const auto vCensus = TakeByteCensus(vContents.data() + i * EXAMINATION_BYTES, EXAMINATION_BYTES);
+            if (vCensus.NumberOfDistinctiveNumbers <= MAXIMUM_DISTINCTIVE_NUMBER &&
+                vCensus.Ramdomness >= MINIMUM_RANDOMNESS)
+            {
+                ++vPassed;
+            }
+        }
+
+        return vPassed * 2 > NUMBER_OF_SAMPLES;
+    }
+
+    auto Scanner::IsConfirmedContext(std::uint64_t aAddress, std::uint64_t aRegionSize, std::uint64_t& aContext)
+        -> bool
+    {
+        aContext = 0;
+        if (!_ConfirmContexts)
+        {
+            return true;
+        }
+
+        std::array<std::uint8_t, PageTableWalk::PAGE_SIZE> vContents;
+        const auto vSize = static_cast<std::uint32_t>(std::min<std::uint64_t>(vContents.size(), aRegionSize));
+
+        auto vKey = ContextKey{};
+        if (!_Memory.ReadVirtual(aAddress, vContents.data(), vSize) ||
+            !RecoverContextKey(vContents.data(), vSize, aRegionSize, vKey))
+        {
+            Count(ScanStatistics::CONTEXTS_REJECTED);
+            return false;
+        }
+
+        // The context may start a few qwords into the page
+        aContext = aAddress + vKey.Offset;
+
+        Count(ScanStatistics::CONTEXTS_CONFIRMED);
+        return true;
+    }
+
+    auto Scanner::IsIndependentPatchGuardPage(const std::uint8_t* aContents, std::uint64_t& aSize, RandomnessInfo& aCensus)
+        -> bool
+    {
+        // Check randomness of the contents
+        aCensus = TakeByteCensus(aContents + sizeof(std::uint64_t), EXAMINATION_BYTES);
+
+        if (aCensus.NumberOfDistinctiveNumbers > MAXIMUM_DISTINCTIVE_NUMBER ||
+            aCensus.Ramdomness < MINIMUM_RANDOMNESS)
+        {
+            return false;
+        }
+
+        // Also, check the size of the region. The first page of
+        // allocated pages as independent pages has its own page
+        // size in bytes at the first 8 bytes
+        memcpy(&aSize, aContents, sizeof(aSize));
+        if (MINIMUM_REGION_SIZE > aSize || aSize > MAXIMUM_REGION_SIZE)
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // The big pool is streamed in order by a single task, which takes one
+    // worker of the pool, and the cascade learns from one entry after the
+    // other
+    struct Scanner::BigPoolScan
+    {
+        Scanner&                    Owner;
+        const ProgressRoutine&      Progress;
+        WorkStealingPool*           Pool = nullptr;
+        std::uint64_t               TableSize;
+        std::uint64_t               Table;
+        std::atomic<std::uint64_t>  Completed { 0 };
+
+        BigPoolScan(Scanner& aOwner, const ProgressRoutine& aProgress)
+            : Owner(aOwner)
+            , Progress(aProgress)
+            , TableSize(aOwner.ReadPointer(aOwner._Symbols.PoolBigPageTableSize, "nt!PoolBigPageTableSize"))
+            , Table(aOwner.ReadPointer(aOwner._Symbols.PoolBigPageTable, "nt!PoolBigPageTable"))
+        { }
+
+        auto Start(WorkStealingPool& aPool)
+            -> void
+        {
+            Pool = &aPool;
+            aPool.Submit([this](std::size_t)
+            {
+                Owner.ScanBigPagePool(*this);
+            });
+        }
+
+        auto Report()
+            -> void
+        {
+            Owner.ReportProgress(Progress, Completed, TableSize, Pool);
+        }
+    };
+
+    template<typename Phase>
+    auto Scanner::RunPhases(WorkStealingPool& aPool, Phase& aPhase)
+        -> void
+    {
+        aPhase.Start(aPool);
+
+        // The pool calls this back on this thread while it is waiting. What
+        // was found before a cancellation is delivered as well.
+        aPool.Wait([this, &aPhase]()
+        {
+            aPhase.Report();
+            DeliverFindings();
+        });
+        DeliverFindings();
+        ThrowIfCancelled();
+    }
+
+    template<typename FirstPhase, typename SecondPhase>
+    auto Scanner::RunPhases(WorkStealingPool& aPool, FirstPhase& aFirst, SecondPhase& aSecond)
+        -> void
+    {
+        aFirst.Start(aPool);
+        try
+        {
+            aSecond.Start(aPool);
+        }
+        catch (...)
+        {
+            // The tasks of the first phase must not outlive it
+            aPool.Cancel();
+            aPool.Wait();
+            throw;
+        }
+
+        aPool.Wait([this, &aFirst, &aSecond]()
+        {
+            aFirst.Report();
+            aSecond.Report();
+            DeliverFindings();
+        });
+        DeliverFindings();
+        ThrowIfCancelled();
+    }
+
+    auto Scanner::FindFromBigPagePool(const ProgressRoutine& aProgress)
+        -> CandidateTable
+    {
+        BeginScan();
+
+        BigPoolScan vScan(*this, aProgress);
+        RunPhases(_Pool, vScan);
+
+        return TakeCandidates();
+    }
+
+    // Reads aCount entries of the table at aTable from aFirst into aRecords.
+    // Parts of the table may be missing, from a dump for example, so when the
+    // bulk read fails, every page of the chunk is read on its own, and the
+    // entries which overlap a page that could not be read are cleared, which
+    // the prefilter drops as unused. The failed reads are counted into
+    // FAILED_READS by CountingMemorySource, which the host puts in front of
+    // its memory source whenever there are statistics.
+    auto Scanner::ReadBigPoolChunk(
+        std::uint64_t   aTable,
+        std::uint64_t   aFirst,
+        std::uint64_t   aCount,
+        BigPoolRecord*  aRecords)
+        -> void
+    {
+        const auto vAddress = aTable + aFirst * sizeof(BigPoolRecord);
+        const auto vBytes   = aCount * sizeof(BigPoolRecord);
+        const auto vCursor  = reinterpret_cast<std::uint8_t*>(aRecords);
+
+        if (_Memory.ReadVirtual(vAddress, aRecords, static_cast<std::uint32_t>(vBytes)))
+        {
+            return;
+        }
+
+        constexpr std::uint64_t PAGE_SIZE = 0x1000;
+
+        // A chunk which is not aligned on a page spans one more page
+        std::array<bool, BIG_POOL_CHUNK_ENTRIES * sizeof(BigPoolRecord) / PAGE_SIZE + 2> vUnreadable = {};
+        const auto vGetPage = [vAddress](std::uint64_t aOffset)
+        {
+            return static_cast<std::size_t>(((vAddress + aOffset) / PAGE_SIZE) - (vAddress / PAGE_SIZE));
+        };
+
+        for (std::uint64_t vOffset = 0; vOffset < vBytes; )
+        {
+            const auto vPageBytes = std::min(PAGE_SIZE - ((vAddress + vOffset) & (PAGE_SIZE - 1)), vBytes - vOffset);
+
+            if (!_Memory.ReadVirtual(vAddress + vOffset, vCursor + vOffset, static_cast<std::uint32_t>(vPageBytes)))
+            {
+                vUnreadable[vGetPage(vOffset)] = true;
+            }
+
+            vOffset += vPageBytes;
+        }
+
+        for (std::uint64_t i = 0; i < aCount; ++i)
+        {
+            const auto vOffset = i * sizeof(BigPoolRecord);
+            if (vUnreadable[vGetPage(vOffset)] || vUnreadable[vGetPage(vOffset + sizeof(BigPoolRecord) - 1)])
+            {
+                aRecords[i] = BigPoolRecord{};
+            }
+        }
+    }
+
+    auto Scanner::ScanBigPagePool(BigPoolScan& aScan)
+        -> void
+    {
+        const auto vStart = std::chrono::steady_clock::now();
+
+        const auto PoolBigPageTableSize = aScan.TableSize;
+        const auto PoolBigPageTable     = aScan.Table;
+
+        // Stream the table through two fixed-size buffers, whatever its
+        // size: the next chunk is read in the background while the current
+        // one is filtered
+        const auto vChunkBytes = static_cast<std::size_t>(BIG_POOL_CHUNK_ENTRIES * sizeof(BigPoolRecord));
+        const auto vMaskWords  = static_cast<std::size_t>((BIG_POOL_CHUNK_ENTRIES + 63) / 64);
+
+        ScratchArena vArena(2 * vChunkBytes + vMaskWords * sizeof(std::uint64_t) + 2 * ScratchArena::DEFAULT_ALIGNMENT);
+
+        BigPoolRecord* vChunks[2] =
+        {
+            vArena.Allocate<BigPoolRecord>(static_cast<std::size_t>(BIG_POOL_CHUNK_ENTRIES)),
+            vArena.Allocate<BigPoolRecord>(static_cast<std::size_t>(BIG_POOL_CHUNK_ENTRIES)),
+        };
+        const auto vMask = vArena.Allocate<std::uint64_t>(vMaskWords);
+
+        // The task only captures a pointer to this, so that it is not
+        // allocated by std::function
+        struct ChunkReader
+        {
+            Scanner*        This;
+            std::uint64_t   Table;
+            std::uint64_t   TableSize;
+            BigPoolRecord** Chunks;
+        };
+        const auto vChunkReader = ChunkReader{ this, PoolBigPageTable, PoolBigPageTableSize, vChunks };
+
+        // The read in flight writes to the chunks, so it is joined before they
+        // are gone, even when the scan throws
+        const auto vJoinReader = std::experimental::scope_guard(&_BigPoolReader, [](WorkStealingPool* aReader)
+        {
+            try
+            {
+                aReader->Wait();
+            }
+            catch (...)
+            {
+            }
+        });
+
+        auto vReadChunk = [this, &vChunkReader](std::uint64_t aChunk)
+        {
+            _BigPoolReader.Submit([&vChunkReader, aChunk](std::size_t)
+            {
+                const auto vFirst = aChunk * BIG_POOL_CHUNK_ENTRIES;
+                const auto vCount = std::min(BIG_POOL_CHUNK_ENTRIES, vChunkReader.TableSize - vFirst);
+
+                vChunkReader.This->ReadBigPoolChunk(vChunkReader.Table, vFirst, vCount, vChunkReader.Chunks[aChunk & 1]);
+            });
+        };
+
+        const auto vPrefilter = BigPoolPrefilter
+        {
+            MINIMUM_REGION_SIZE, MAXIMUM_REGION_SIZE, _IsWindows10OrGreater,
+        };
+
+        _BigPoolFilters.Reset();
+
+        const auto vNumberOfChunks = (PoolBigPageTableSize + BIG_POOL_CHUNK_ENTRIES - 1) / BIG_POOL_CHUNK_ENTRIES;
+
+        if (vNumberOfChunks)
+        {
+            vReadChunk(0);
+        }
+
+        // Walk BigPageTable
+        for (std::uint64_t vChunkIndex = 0; vChunkIndex < vNumberOfChunks && !IsCancelled(); ++vChunkIndex)
+        {
+            _BigPoolReader.Wait();
+            if (vChunkIndex + 1 < vNumberOfChunks)
+            {
+                vReadChunk(vChunkIndex + 1);
+            }
+
+            const auto vFirst = vChunkIndex * BIG_POOL_CHUNK_ENTRIES;
+            const auto vCount = std::min(BIG_POOL_CHUNK_ENTRIES, PoolBigPageTableSize - vFirst);
+            const auto vChunk = vChunks[vChunkIndex & 1];
+
+            // Drop unused entries, entries of a wrong size and paged pool
+            // entries at once, and only look at the rest one by one
+            PrefilterBigPoolRecords(vChunk, static_cast<std::size_t>(vCount), vPrefilter, vMask);
+
+            std::uint64_t vPrefiltered = 0;
+            for (std::size_t i = 0; i < vCount; ++i)
+            {
+                // The entries which passed the prefilter may take a read
+                // each, so the cancellation is checked often
+                if (i % CANCEL_POLL_INTERVAL == 0)
+                {
+                    // When the scan runs on the calling thread, the progress
+                    // is reported from here
+                    aScan.Completed.store(vFirst + i, std::memory_order_relaxed);
+                    aScan.Pool->Poll();
+                    if (IsCancelled())
+                    {
+                        break;
+                    }
+                }
+
+                if (!(vMask[i / 64] & (1ull << (i % 64))))
+                {
+                    continue;
+                }
+                ++vPrefiltered;
+
+                const auto& vRaw = vChunk[i];
+                const auto vEntry = BigPoolEntry
+                {
+                    vRaw.Va,
+                    vRaw.Tag,
+                    GetBigPoolType(vRaw, _IsWindows10OrGreater),
+                    vRaw.NumberOfBytes,
+                };
+
+                // The checks are independent, so the cascade runs them
+                // in the order which rejects the entries the soonest
+                auto vCensus = RandomnessInfo{};
+                const auto vPassed = _BigPoolFilters.Run([this, &vEntry, &vCensus](std::size_t aStage)
+                {
+                    switch (aStage)
+                    {
+                    default:
+                    case STAGE_POOL_TYPE:
+                        // The prefilter only tells that the pool type may be non-paged
+                        return IsNonPagedBigPool(vEntry);
+
+                    case STAGE_PAGE_ATTRIBUTE:
+                        // Filter by the page protection
+                        return IsPatchGuardPageAttribute(vEntry.Va);
+
+                    case STAGE_SAMPLE:
+                        return IsPatchGuardSample(vEntry.Va, vCensus);
+                    }
+                });
+                std::uint64_t vContext = 0;
+                if (!vPassed || !IsConfirmedContext(vEntry.Va, vEntry.NumberOfBytes, vContext))
+                {
+                    continue;
+                }
+
+                // It seems to be a PatchGuard page
+                Publish(vEntry, vCensus, vContext);
+            }
+
+            Count(ScanStatistics::BIG_POOL_ENTRIES, vCount);
+            Count(ScanStatistics::BIG_POOL_PREFILTERED, vPrefiltered);
+        }
+
+        aScan.Completed = PoolBigPageTableSize;
+        RecordPhase(ScanStatistics::PHASE_BIG_POOL, vStart);
+    }
+
+    auto Scanner::BigPoolFilters() const
+        -> const FilterCascade&
+    {
+        return _BigPoolFilters;
+    }
+
+    // Reads the tables from physical memory, and analyzes the pages
+    // which are Readable/Writable/Executable, 4KB or large
+    struct Scanner::IndependentPageVisitor : PageTableVisitor
+    {
+        static constexpr bool VISITS_LARGE_PAGES = true;
+
+        Scanner&                                    Owner;
+        std::vector<ScratchArena>&                  Arenas;
+        std::chrono::steady_clock::time_point       StartTime;
+
+        IndependentPageVisitor(Scanner& aOwner, std::vector<ScratchArena>& aArenas)
+            : Owner(aOwner)
+            , Arenas(aArenas)
+        { }
+
+        auto ReadTable(std::uint64_t aTableAddress, std::uint64_t* aEntries)
+            -> bool
+        {
+            return Owner._Memory.ReadPhysical(aTableAddress, aEntries, static_cast<std::uint32_t>(PageTableWalk::TABLE_SIZE));
+        }
+
+        // Nothing more is walked once the scan has been cancelled
+        auto SkipSubtree(std::size_t, std::uint64_t, std::uint64_t) const
+            -> bool
+        {
+            return Owner.IsCancelled();
+        }
+
+        auto LeafFilter() const
+            -> PteFilter
+        {
+            return PteFilter{ PageTableWalk::PTE_VALID | PageTableWalk::PTE_WRITE, PageTableWalk::PTE_NO_EXECUTE };
+        }
+
+        auto Leaf(std::size_t /*aWorker*/, std::uint64_t aVirtualAddress, std::uint64_t)
+            -> void
+        {
+            // This page might be PatchGuard page, so let's analyze it.
+            // Read the contents of the address that is managed by the PTE
+            Owner.Count(ScanStatistics::PAGES_SCORED);
+
+            std::array<std::uint8_t, INDEPENDENT_PAGE_SAMPLE_BYTES> vContents;
+            if (!Owner._Memory.ReadVirtual(aVirtualAddress, vContents.data(), static_cast<std::uint32_t>(vContents.size())))
+            {
+                return;
+            }
+
+            std::uint64_t vIndependentPageSize = 0;
+            std::uint64_t vContext = 0;
+            auto vCensus = RandomnessInfo{};
+            if (!Owner.IsIndependentPatchGuardPage(vContents.data(), vIndependentPageSize, vCensus) ||
+                !Owner.IsConfirmedContext(aVirtualAddress, vIndependentPageSize, vContext))
+            {
+                return;
+            }
+
+            // It seems to be a PatchGuard page
+            Owner.Publish(aVirtualAddress, vIndependentPageSize, vCensus, PageTableWalk::PAGE_SIZE, vContext);
+        }
+
+        auto LargePage(std::size_t aWorker, std::size_t aLevel, std::uint64_t aVirtualAddress, std::uint64_t aEntry)
+            -> void
+        {
+            if (!(aEntry & PageTableWalk::PTE_WRITE) || (aEntry & PageTableWalk::PTE_NO_EXECUTE))
+            {
+                return;
+            }
+
+            // 2MB for a PDE, 1GB for a PPE
+            const auto vMappingSize = PageTableWalk::PAGE_SIZE << (9 * (aLevel - 1));
+            Owner.ScanLargePage(aVirtualAddress, aEntry, vMappingSize, Arenas[aWorker]);
+        }
+
+        auto Finish()
+            -> void
+        {
+            Owner.RecordPhase(ScanStatistics::PHASE_INDEPENDENT_PAGES, StartTime);
+        }
+    };
+
+    // Walk entire page table (PXE -> PPE -> PDE -> PTE) in parallel. Start
+    // parse PXE (PML4) which represents the beginning of kernel address.
+    struct Scanner::IndependentPageScan
+    {
+        using Walker = PageTableWalker<PageTableWalk::PAGING_LEVELS, IndependentPageVisitor>;
+
+        Scanner&                                    Owner;
+        const ProgressRoutine&                      Progress;
+        WorkStealingPool*                           Pool = nullptr;
+        std::uint64_t                               SystemRangeStart;
+        std::vector<ScratchArena>                   Arenas;     // The large pages are read into them
+        IndependentPageVisitor                      Visitor;
+        Walker                                      Walk;
+
+        IndependentPageScan(Scanner& aOwner, const ProgressRoutine& aProgress)
+            : Owner(aOwner)
+            , Progress(aProgress)
+            , SystemRangeStart(aOwner.ReadPointer(aOwner._Symbols.MmSystemRangeStart, "nt!MmSystemRangeStart"))
+            , Visitor(aOwner, Arenas)
+            , Walk(aOwner._DirectoryTableBase, Visitor)
+        { }
+
+        auto Start(WorkStealingPool& aPool)
+            -> void
+        {
+            Pool = &aPool;
+            for (std::size_t i = 0; i < aPool.Size(); ++i)
+            {
+                Arenas.emplace_back(static_cast<std::size_t>(LARGE_PAGE_READ_BYTES));
+            }
+
+            Visitor.StartTime = std::chrono::steady_clock::now();
+            Walk.Start(aPool, SystemRangeStart);
+        }
+
+        // The total grows as the PDE pages are visited
+        auto Report()
+            -> void
+        {
+            Owner.ReportProgress(Progress, Walk.LeafTablesVisited(), Walk.LeafTablesFound(), Pool);
+        }
+
+        // Called once the pool is idle
+        auto Finish()
+            -> void
+        {
+            Owner.Count(ScanStatistics::PAGE_TABLES, Walk.LeafTablesVisited());
+        }
+    };
+
+    auto Scanner::FindFromIndependentPages(const ProgressRoutine& aProgress)
+        -> CandidateTable
+    {
+        BeginScan();
+
+        IndependentPageScan vScan(*this, aProgress);
+        RunPhases(_Pool, vScan);
+        vScan.Finish();
+
+        return TakeCandidates();
+    }
+
+    auto Scanner::ScanLargePage(
+        std::uint64_t   aVirtualAddress,
+        std::uint64_t   aEntry,
+        std::uint64_t   aMappingSize,
+        ScratchArena&   aArena)
+        -> void
+    {
+        Count(ScanStatistics::LARGE_PAGES);
+        Count(ScanStatistics::PAGES_SCORED, aMappingSize / PageTableWalk::PAGE_SIZE);
+
+        ScratchArena::Scope vScope(aArena);
+        const auto vBuffer = aArena.Allocate<std::uint8_t>(static_cast<std::size_t>(LARGE_PAGE_READ_BYTES));
+
+        // The frame of a large page is aligned on its size
+        const auto vPhysicalAddress = aEntry & PageTableWalk::PTE_PFN_MASK & ~(aMappingSize - 1);
+
+        // A 1GB page takes 512 reads, so stop between them once cancelled
+        for (std::uint64_t vOffset = 0; vOffset < aMappingSize && !IsCancelled(); vOffset += LARGE_PAGE_READ_BYTES)
+        {
+            // A large page is physically contiguous, so every slice of this
+            // part comes with a single read
+            const auto vBulkRead = _Memory.ReadPhysical(
+                vPhysicalAddress + vOffset, vBuffer, static_cast<std::uint32_t>(LARGE_PAGE_READ_BYTES));
+
+            for (std::uint64_t vSlice = 0; vSlice < LARGE_PAGE_READ_BYTES; vSlice += PageTableWalk::PAGE_SIZE)
+            {
+                // Some of the frames may be missing, from a dump for example,
+                // so the sample of each slice is read on its own then
+                const auto vContents = vBuffer + vSlice;
+                if (!vBulkRead &&
+                    !_Memory.ReadPhysical(vPhysicalAddress + vOffset + vSlice, vContents, INDEPENDENT_PAGE_SAMPLE_BYTES))
+                {
+                    continue;
+                }
+
+                std::uint64_t vIndependentPageSize = 0;
+                std::uint64_t vContext = 0;
+                auto vCensus = RandomnessInfo{};
+                if (!IsIndependentPatchGuardPage(vContents, vIndependentPageSize, vCensus) ||
+                    !IsConfirmedContext(aVirtualAddress + vOffset + vSlice, vIndependentPageSize, vContext))
+                {
+                    continue;
+                }
+
+                // It seems to be a PatchGuard page
+                Publish(aVirtualAddress + vOffset + vSlice, vIndependentPageSize, vCensus, aMappingSize, vContext);
+            }
+        }
+    }
+
+    // Reads aCount entries of the PFN database from aFirstPage into aEntries.
+    // Parts of the database which describe no physical memory are not mapped,
+    // so when the bulk read fails, every page of the chunk is read on its own
+    // and aReadable tells which entries could be read.
+    auto Scanner::ReadPfnChunk(
+        std::uint64_t   aPfnDatabase,
+        std::uint64_t   aFirstPage,
+        std::uint64_t   aCount,
+        std::uint8_t*   aEntries,
+        bool*           aReadable)
+        -> void
+    {
+        const auto vAddress = aPfnDatabase + aFirstPage * PFN_ENTRY_SIZE;
+        const auto vBytes   = aCount * PFN_ENTRY_SIZE;
+
+        std::fill(aReadable, aReadable + aCount, true);
+
+        if (_Memory.ReadVirtual(vAddress, aEntries, static_cast<std::uint32_t>(vBytes)))
+        {
+            return;
+        }
+
+        constexpr std::uint64_t PAGE_SIZE = 0x1000;
+
+        for (std::uint64_t vOffset = 0; vOffset < vBytes; )
+        {
+            const auto vPageBytes = std::min(PAGE_SIZE - ((vAddress + vOffset) & (PAGE_SIZE - 1)), vBytes - vOffset);
+
+            if (!_Memory.ReadVirtual(vAddress + vOffset, aEntries + vOffset, static_cast<std::uint32_t>(vPageBytes)))
+            {
+                // Drop every entry which overlaps the unreadable page
+                const auto vFirst = vOffset / PFN_ENTRY_SIZE;
+                const auto vLast  = (vOffset + vPageBytes - 1) / PFN_ENTRY_SIZE;
+                for (auto i = vFirst; i <= vLast; ++i)
+                {
+                    aReadable[i] = false;
+                }
+            }
+
+            vOffset += vPageBytes;
+        }
+    }
+
+    auto Scanner::ScanPfnChunk(
+        std::uint64_t       aPfnDatabase,
+        std::uint64_t       aFirstPage,
+        std::uint64_t       aCount,
+        std::uint64_t       aSystemRangeStart,
+        ScratchArena&       aArena)
+        -> void
+    {
+        // PTEs in [PdeBase, PdeBase + PDE_REGION_SIZE) map page-table pages
+        constexpr std::uint64_t PTE_REGION_SIZE = 1ull << 39;
+        constexpr std::uint64_t PDE_REGION_SIZE = 1ull << 30;
+
+        const auto vPteAddressOffset   = _IsWindows10OrGreater ? PFN_LAYOUT_WIN10.PteAddress   : PFN_LAYOUT_WIN7.PteAddress;
+        const auto vPageLocationOffset = _IsWindows10OrGreater ? PFN_LAYOUT_WIN10.PageLocation : PFN_LAYOUT_WIN7.PageLocation;
+
+        ScratchArena::Scope vScope(aArena);
+        const auto vEntries  = aArena.Allocate<std::uint8_t>(static_cast<std::size_t>(aCount * PFN_ENTRY_SIZE));
+        const auto vReadable = aArena.Allocate<bool>(static_cast<std::size_t>(aCount));
+        ReadPfnChunk(aPfnDatabase, aFirstPage, aCount, vEntries, vReadable);
+
+        std::uint64_t vScored = 0;
+        for (std::uint64_t i = 0; i < aCount; ++i)
+        {
+            if (i % CANCEL_POLL_INTERVAL == 0 && IsCancelled())
+            {
+                break;
+            }
+
+            if (!vReadable[i])
+            {
+                continue;
+            }
+
+            const auto vEntry = vEntries + i * PFN_ENTRY_SIZE;
+
+            // Only frames in use, and mapped at the moment
+            if ((vEntry[vPageLocationOffset] & PFN_PAGE_LOCATION_MASK) != PFN_ACTIVE_AND_VALID)
+            {
+                continue;
+            }
+
+            // Keep frames mapped by a hardware PTE of a 4KB page. Prototype
+            // PTEs live in paged pool, and frames mapped through the PDE
+            // region are page-table pages. The low bits may be used as a lock.
+            auto vPteAddress = 0ull;
+            memcpy(&vPteAddress, vEntry + vPteAddressOffset, sizeof(vPteAddress));
+            vPteAddress &= ~7ull;
+
+            if (vPteAddress <  _SelfMap.PteBase ||
+                vPteAddress >= _SelfMap.PteBase + PTE_REGION_SIZE ||
+               (vPteAddress >= _SelfMap.PdeBase && vPteAddress < _SelfMap.PdeBase + PDE_REGION_SIZE))
+            {
+                continue;
+            }
+
+            // The canonical address mapped by the PTE
+            auto vVirtualAddress = ((vPteAddress - _SelfMap.PteBase) >> 3) << 12;
+            if (vVirtualAddress & (1ull << 47))
+            {
+                vVirtualAddress |= 0xffff000000000000;
+            }
+            if (vVirtualAddress < aSystemRangeStart)
+            {
+                continue;
+            }
+
+            // Make sure that this PTE still maps the frame, and that it is
+            // Readable/Writable/Executable
+            const auto vPageFrameNumber = aFirstPage + i;
+
+            auto vPte = 0ull;
+            if (!_Memory.ReadVirtual(vPteAddress, &vPte, sizeof(vPte)) ||
+                !(vPte & PageTableWalk::PTE_VALID) ||
+                !(vPte & PageTableWalk::PTE_WRITE) ||
+                 (vPte & PageTableWalk::PTE_NO_EXECUTE) ||
+                ((vPte & 0x000FFFFFFFFFF000) >> 12) != vPageFrameNumber)
+            {
+                continue;
+            }
+
+            // The frame is known, so there is no need to translate the address
+            ++vScored;
+
+            std::array<std::uint8_t, INDEPENDENT_PAGE_SAMPLE_BYTES> vContents;
+            if (!_Memory.ReadPhysical(vPageFrameNumber << 12, vContents.data(), static_cast<std::uint32_t>(vContents.size())))
+            {
+                continue;
+            }
+
+            std::uint64_t vIndependentPageSize = 0;
+            std::uint64_t vContext = 0;
+            auto vCensus = RandomnessInfo{};
+            if (!IsIndependentPatchGuardPage(vContents.data(), vIndependentPageSize, vCensus) ||
+                !IsConfirmedContext(vVirtualAddress, vIndependentPageSize, vContext))
+            {
+                continue;
+            }
+
+            // It seems to be a PatchGuard page
+            Publish(vVirtualAddress, vIndependentPageSize, vCensus, PageTableWalk::PAGE_SIZE, vContext);
+        }
+
+        Count(ScanStatistics::PFN_ENTRIES, aCount);
+        Count(ScanStatistics::PAGES_SCORED, vScored);
+    }
+
+    // The PFN database is one dense array, so it is split into chunks which
+    // are read sequentially by the workers. Each worker reads its chunks into
+    // its own arena.
+    struct Scanner::PfnScan
+    {
+        Scanner&                                    Owner;
+        const ProgressRoutine&                      Progress;
+        WorkStealingPool*                           Pool = nullptr;
+        std::uint64_t                               PfnDatabase;
+        std::uint64_t                               NumberOfPages;
+        std::uint64_t                               NumberOfChunks;
+        std::uint64_t                               SystemRangeStart;
+        std::chrono::steady_clock::time_point       StartTime;
+        std::vector<ScratchArena>                   Arenas;
+        std::atomic<std::uint64_t>                  ChunksScanned { 0 };
+
+        PfnScan(Scanner& aOwner, const ProgressRoutine& aProgress, std::uint64_t aPfnDatabase, std::uint64_t aHighestPhysicalPage)
+            : Owner(aOwner)
+            , Progress(aProgress)
+            , PfnDatabase(aPfnDatabase)
+            , NumberOfPages(aHighestPhysicalPage + 1)
+            , NumberOfChunks((NumberOfPages + PFN_CHUNK_ENTRIES - 1) / PFN_CHUNK_ENTRIES)
+            , SystemRangeStart(aOwner.ReadPointer(aOwner._Symbols.MmSystemRangeStart, "nt!MmSystemRangeStart"))
+        { }
+
+        auto Start(WorkStealingPool& aPool)
+            -> void
+        {
+            Pool = &aPool;
+            for (std::size_t i = 0; i < aPool.Size(); ++i)
+            {
+                Arenas.emplace_back(static_cast<std::size_t>(PFN_CHUNK_ARENA_SIZE));
+            }
+
+            StartTime = std::chrono::steady_clock::now();
+
+            // The tasks only capture this and a number, so that they are not
+            // allocated by std::function
+            for (std::uint64_t vFirstPage = 0; vFirstPage < NumberOfPages; vFirstPage += PFN_CHUNK_ENTRIES)
+            {
+                aPool.Submit([this, vFirstPage](std::size_t aWorker)
+                {
+                    ScanChunk(aWorker, vFirstPage);
+                });
+            }
+        }
+
+        auto ScanChunk(std::size_t aWorker, std::uint64_t aFirstPage)
+            -> void
+        {
+            const auto vCount = std::min(PFN_CHUNK_ENTRIES, NumberOfPages - aFirstPage);
+
+            Owner.ScanPfnChunk(PfnDatabase, aFirstPage, vCount, SystemRangeStart, Arenas[aWorker]);
+
+            if (++ChunksScanned == NumberOfChunks)
+            {
+                Owner.RecordPhase(ScanStatistics::PHASE_INDEPENDENT_PAGES, StartTime);
+            }
+        }
+
+        auto Report()
+            -> void
+        {
+            const auto vScanned = std::min(ChunksScanned * PFN_CHUNK_ENTRIES, NumberOfPages);
+            Owner.ReportProgress(Progress, vScanned, NumberOfPages, Pool);
+        }
+    };
+
+    auto Scanner::FindFromPfnDatabase(
+        std::uint64_t           aPfnDatabase,
+        std::uint64_t           aHighestPhysicalPage,
+        const ProgressRoutine&  aProgress)
+        -> CandidateTable
+    {
+        BeginScan();
+
+        PfnScan vScan(*this, aProgress, aPfnDatabase, aHighestPhysicalPage);
+        RunPhases(_Pool, vScan);
+
+        return TakeCandidates();
+    }
+
+    auto Scanner::FindAll(
+        const IndependentPageSource&    aSource,
+        const ProgressRoutine&          aBigPoolProgress,
+        const ProgressRoutine&          aIndependentProgress)
+        -> CandidateTable
+    {
+        BeginScan();
+
+        BigPoolScan vBigPool(*this, aBigPoolProgress);
+
+        // The big pool takes a worker for the whole phase, and the pool has
+        // at least two, so there is always another one for the independent
+        // pages, unless the tasks run on this thread, one phase after the other
+        if (aSource.UsePfnDatabase)
+        {
+            PfnScan vIndependent(*this, aIndependentProgress, aSource.PfnDatabase, aSource.HighestPhysicalPage);
+            RunPhases(_Pool, vBigPool, vIndependent);
+        }
+        else
+        {
+            IndependentPageScan vIndependent(*this, aIndependentProgress);
+            RunPhases(_Pool, vBigPool, vIndependent);
+            vIndependent.Finish();
+        }
+
+        // A page found by both phases is reported once
+        auto vResult = TakeCandidates();
+        vResult.MergeOverlapping();
+        return vResult;
+    }
+
+    auto Scanner::DecryptContexts(const CandidateTable& aFound)
+        -> const std::vector<DecryptedContext>&
+    {
+        _DecryptedContexts.clear();
+        _DecryptionBatch.clear();
+
+        for (std::size_t i = 0; i < aFound.Size(); ++i)
+        {
+            const auto& vFinding = aFound.Get(i);
+
+            std::array<std::uint8_t, PageTableWalk::PAGE_SIZE> vContents;
+            const auto vSize = static_cast<std::uint32_t>(std::min<std::uint64_t>(vContents.size(), vFinding.Size));
+
+            auto vKey = ContextKey{};
+            if (!_Memory.ReadVirtual(vFinding.Va, vContents.data(), vSize) ||
+                !RecoverContextKey(vContents.data(), vSize, vFinding.Size, vKey))
+            {
+                continue;
+            }
+
+            // The staging buffers keep their capacity from a call to the next
+            const auto vIndex = _DecryptedContexts.size();
+            if (_EncryptedContexts.size() == vIndex)
+            {
+                _EncryptedContexts.emplace_back();
+            }
+
+            const auto vVa = vFinding.Va + vKey.Offset;
+            auto& vContext = _EncryptedContexts[vIndex];
+            vContext.resize(static_cast<std::size_t>(GetContextBytes(vKey)));
+            if (!_Memory.ReadVirtual(vVa, vContext.data(), static_cast<std::uint32_t>(vContext.size())))
+            {
+                continue;
+            }
+
+            _DecryptedContexts.push_back(DecryptedContext{ vVa, vKey, nullptr });
+            _DecryptionBatch.push_back(ContextDecryptor::EncryptedContext{ vContext.data(), vKey });
+        }
+
+        if (_DecryptedContexts.empty())
+        {
+            return _DecryptedContexts;
+        }
+
+        // A context may take megabytes, so the workers share every one
+        _Decryptor.Decrypt(_Pool, _DecryptionBatch.data(), _DecryptionBatch.size());
+
+        for (std::size_t i = 0; i < _DecryptedContexts.size(); ++i)
+        {
+            _DecryptedContexts[i].Image = _Decryptor.Image(i);
+        }
+        return _DecryptedContexts;
+    }
+
+}
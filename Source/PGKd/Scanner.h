@@ -0,0 +1,417 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "MemorySource.h"
+#include "PageTableWalk.h"
+#include "ByteCensus.h"
+#include "ScratchArena.h"
+#include "FilterCascade.h"
+#include "ScanStatistics.h"
+#include "Finding.h"
+#include "CandidateTable.h"
+#include "ContextCipher.h"
+#include "ContextDecryptor.h"
+
+
+namespace Sunstrider
+{
+
+    // Addresses of the kernel variables the scanner reads. They are resolved
+    // by the host, so the scanner itself does not need a symbol engine.
+    struct ScanSymbols
+    {
+        std::uint64_t PoolBigPageTable;         // &nt!PoolBigPageTable
+        std::uint64_t PoolBigPageTableSize;     // &nt!PoolBigPageTableSize
+        std::uint64_t MmSystemRangeStart;       // &nt!MmSystemRangeStart
+    };
+
+    // A raw POOL_TRACKER_BIG_PAGES entry (see BigPoolPrefilter.h)
+    struct BigPoolRecord;
+
+    // A POOL_TRACKER_BIG_PAGES entry, decoded for the version of the target
+    struct BigPoolEntry
+    {
+        std::uint64_t Va;
+        std::uint32_t Tag;
+        std::uint32_t PoolType;
+        std::uint64_t NumberOfBytes;
+    };
+
+    // Where Scanner::FindAll looks for the independent pages: in the page
+    // tables, or in the PFN database (see Scanner::FindFromPfnDatabase)
+    struct IndependentPageSource
+    {
+        bool            UsePfnDatabase;
+        std::uint64_t   PfnDatabase;            // The value of nt!MmPfnDatabase
+        std::uint64_t   HighestPhysicalPage;    // The value of nt!MmHighestPhysicalPage
+    };
+
+    // The context held by a page found by a scan, decrypted by
+    // Scanner::DecryptContexts
+    struct DecryptedContext
+    {
+        std::uint64_t       Va;         // Where the header is, in the page
+        ContextKey          Key;
+        const std::uint8_t* Image;      // GetContextBytes(Key) bytes
+    };
+
+
+    // The discovery half of !findpg: looks for PatchGuard contexts in the big
+    // page pool and in independent pages.
+    //
+    // Every read goes through a MemorySource, so the same code runs against
+    // a live target through the debugger engine and against a crash dump
+    // mapped into the process.
+    class Scanner
+    {
+    public:
+        // The number of bytes to examine to calculate the number of distinctive
+        // bytes and randomness
+        static constexpr std::uint32_t EXAMINATION_BYTES = 100;
+
+        // It is not a PatchGuard page if the number of distinctive bytes are bigger
+        // than this number
+        static constexpr std::uint32_t MAXIMUM_DISTINCTIVE_NUMBER = 5;
+
+        // It is not a PatchGuard page if randomness is smaller than this number
+        static constexpr std::uint32_t MINIMUM_RANDOMNESS = 50;
+
+        // A sample which misses the thresholds above by no more than these is
+        // borderline, and the rest of its page decides
+        static constexpr std::uint32_t BORDERLINE_DISTINCTIVE_MARGIN = 3;
+        static constexpr std::uint32_t BORDERLINE_RANDOMNESS_MARGIN = 10;
+
+        // It is not a PatchGuard page if the size of the page is smaller than this
+        static constexpr std::uint64_t MINIMUM_REGION_SIZE = 0x004000;
+
+        // It is not a PatchGuard page if the size of the page is larger than this
+        static constexpr std::uint64_t MAXIMUM_REGION_SIZE = 0xf00000;
+
+        // The size header of an independent page followed by the examined bytes
+        static constexpr std::uint32_t INDEPENDENT_PAGE_SAMPLE_BYTES = EXAMINATION_BYTES + sizeof(std::uint64_t);
+
+        // The MMPFN fields read by FindFromPfnDatabase. PteAddress is the
+        // offset of wdk::MMPFN::PteAddress (wdk::build_10240::MMPFN::PteAddress
+        // on Windows 10), and PageLocation the offset of u3.e1, whose low 3 bits
+        // are the page location.
+        struct PfnLayout
+        {
+            std::uint32_t PteAddress;
+            std::uint32_t PageLocation;
+        };
+
+        static constexpr std::uint64_t  PFN_ENTRY_SIZE          = 0x30;
+        static constexpr PfnLayout      PFN_LAYOUT_WIN7         = { 0x10, 0x1a };
+        static constexpr PfnLayout      PFN_LAYOUT_WIN10        = { 0x08, 0x22 };
+        static constexpr std::uint8_t   PFN_PAGE_LOCATION_MASK  = 0x7;
+        static constexpr std::uint8_t   PFN_ACTIVE_AND_VALID    = 6;
+
+        // The number of MMPFN entries read at once (192KB), and the size of
+        // the arena of each worker, which holds one chunk and its bitmap
+        static constexpr std::uint64_t  PFN_CHUNK_ENTRIES       = 0x1000;
+        static constexpr std::size_t    PFN_CHUNK_ARENA_SIZE    = PFN_CHUNK_ENTRIES * (PFN_ENTRY_SIZE + 1) + 2 * ScratchArena::DEFAULT_ALIGNMENT;
+
+        // The number of PoolBigPageTable entries read at once (192KB). Two
+        // chunks are in memory at any time, whatever the size of the table.
+        static constexpr std::uint64_t  BIG_POOL_CHUNK_ENTRIES  = 0x2000;
+
+        // The bytes of a large page read at once: a whole 2MB page, or one
+        // 2MB part of a 1GB page
+        static constexpr std::uint64_t  LARGE_PAGE_READ_BYTES   = 0x200000;
+
+        // How often the workers look at the cancellation of a scan, in items
+        // (table entries, PFN entries or 2MB parts of a large page)
+        static constexpr std::uint64_t  CANCEL_POLL_INTERVAL    = 0x40;
+
+        // Called on the calling thread with the number of work items completed
+        // so far and the number known in total (PoolBigPageTable entries, PTE
+        // pages or PFN entries), so that the host can display the progress.
+        // Returns false to cancel the scan, which then throws
+        // std::runtime_error.
+        using ProgressRoutine = std::function<bool(std::uint64_t aCompleted, std::uint64_t aTotal)>;
+
+        // Called on the calling thread with the pages found so far, in the
+        // order of their sequence ids, while the scan goes on
+        using FindingRoutine = std::function<void(const Finding& aFinding)>;
+
+        // The checks of a big pool entry which passed the prefilter, in the
+        // order they are added to the cascade
+        enum BigPoolStage : std::size_t
+        {
+            STAGE_POOL_TYPE,
+            STAGE_PAGE_ATTRIBUTE,
+            STAGE_SAMPLE,
+            STAGE_FULL_PAGE,        // Escalation of STAGE_SAMPLE
+        };
+
+    private:
+        MemorySource&           _Memory;
+        ScanSymbols             _Symbols;
+        PageTableWalk::SelfMap  _SelfMap;
+        std::uint64_t           _DirectoryTableBase;
+        bool                    _IsWindows10OrGreater;
+        FilterCascade           _BigPoolFilters;
+        ScanStatistics*         _Statistics = nullptr;
+        bool                    _ConfirmContexts = false;
+
+        // Set when the progress routine cancels the current scan, and polled
+        // by the workers
+        std::atomic<bool>       _Cancelled { false };
+
+        // Every page found by the current scan, in the order it was
+        // confirmed, and how many of them have been delivered. _Delivering is
+        // kept from a delivery to the next, so that it does not allocate.
+        std::mutex              _FindingsLock;
+        CandidateTable          _Candidates;
+        std::size_t             _DeliveredFindings = 0;
+        std::vector<Finding>    _Delivering;
+        FindingRoutine          _FindingRoutine;
+
+        // The workers of every scan and of DecryptContexts. They are kept from
+        // one to the next, so that a scan does not start threads.
+        WorkStealingPool        _Pool;
+
+        // Reads the next chunk of PoolBigPageTable while the current one is
+        // filtered. The thread is kept from a scan to the next. Over a source
+        // which does not allow concurrent reads, it has no thread, and the
+        // chunks are read in turn.
+        WorkStealingPool        _BigPoolReader;
+
+        // Keep the encrypted contexts read by DecryptContexts, and their
+        // images, from a call to the next, so that their buffers only grow
+        ContextDecryptor                                _Decryptor;
+        std::vector<std::vector<std::uint8_t>>          _EncryptedContexts;
+        std::vector<ContextDecryptor::EncryptedContext> _DecryptionBatch;
+        std::vector<DecryptedContext>                   _DecryptedContexts;
+
+        // Scores the pages found by FindFromIndependentPages
+        struct IndependentPageVisitor;
+
+        // The phases of a scan while their tasks run on a pool, which may be
+        // shared with another phase. Each of them can Start() on a pool, and
+        // Report() its progress while the pool is waited for. What they find
+        // is published into _Candidates.
+        struct BigPoolScan;
+        struct IndependentPageScan;
+        struct PfnScan;
+
+        template<typename Phase>
+        auto RunPhases(WorkStealingPool& aPool, Phase& aPhase)
+            -> void;
+
+        // Runs both phases at once on aPool
+        template<typename FirstPhase, typename SecondPhase>
+        auto RunPhases(WorkStealingPool& aPool, FirstPhase& aFirst, SecondPhase& aSecond)
+            -> void;
+
+        // The workers of a pool of aWorkers threads over _Memory: none if it
+        // does not allow concurrent reads, so that the tasks run on the
+        // calling thread
+        auto GetWorkers(std::size_t aWorkers) const
+            -> std::size_t;
+
+        auto ReadPointer(std::uint64_t aAddress, const char* aName)
+            -> std::uint64_t;
+
+        // Adds to a counter of the statistics, if there are any
+        auto Count(ScanStatistics::Counter aCounter, std::uint64_t aValue = 1)
+            -> void;
+
+        // Adds the time since aStart to a phase of the statistics, if there
+        // are any
+        auto RecordPhase(ScanStatistics::Phase aPhase, std::chrono::steady_clock::time_point aStart)
+            -> void;
+
+        auto ReadBigPoolChunk(
+            std::uint64_t   aTable,
+            std::uint64_t   aFirst,
+            std::uint64_t   aCount,
+            BigPoolRecord*  aRecords)
+            -> void;
+
+        // The body of the task of BigPoolScan
+        auto ScanBigPagePool(BigPoolScan& aScan)
+            -> void;
+
+        // Calls aProgress, if any, and cancels the scan and aPool, if any,
+        // when it returns false
+        auto ReportProgress(
+            const ProgressRoutine&  aProgress,
+            std::uint64_t           aCompleted,
+            std::uint64_t           aTotal,
+            WorkStealingPool*       aPool)
+            -> void;
+
+        auto IsCancelled() const
+            -> bool;
+
+        // Clears the cancellation and the findings of the previous scan
+        auto BeginScan()
+            -> void;
+
+        // Numbers a page which passed every check, from any thread
+        auto Publish(Finding aFinding)
+            -> void;
+
+        // aContext is where the context starts, as IsConfirmedContext found it
+        auto Publish(const BigPoolEntry& aEntry, const RandomnessInfo& aCensus, std::uint64_t aContext)
+            -> void;
+
+        // An independent page of the region of aSize bytes at aVirtualAddress,
+        // held by a mapping of aMappingSize bytes (4KB, 2MB or 1GB)
+        auto Publish(
+            std::uint64_t           aVirtualAddress,
+            std::uint64_t           aSize,
+            const RandomnessInfo&   aCensus,
+            std::uint64_t           aMappingSize,
+            std::uint64_t           aContext)
+            -> void;
+
+        // The candidates of the scan which is over, sorted by address
+        auto TakeCandidates()
+            -> CandidateTable;
+
+        // Hands the findings published since the last call to the finding
+        // routine. Called on the calling thread.
+        auto DeliverFindings()
+            -> void;
+
+        auto ThrowIfCancelled() const
+            -> void;
+
+        auto IsNonPagedBigPool(const BigPoolEntry& aEntry)
+            -> bool;
+
+        auto IsPageValidReadWriteExecutable(std::uint64_t aPteAddress)
+            -> bool;
+
+        auto IsPatchGuardPageAttribute(std::uint64_t aPageBase)
+            -> bool;
+
+        // Checks the randomness of the first EXAMINATION_BYTES bytes of the
+        // page at aAddress, and of the whole page if they are borderline
+        auto IsPatchGuardSample(std::uint64_t aAddress, RandomnessInfo& aCensus)
+            -> bool;
+
+        // Checks the randomness of every EXAMINATION_BYTES bytes of the page
+        // at aAddress. Most of them have to pass.
+        auto IsPatchGuardFullPage(std::uint64_t aAddress)
+            -> bool;
+
+        // Looks for a context which decrypts with a key recovered from its
+        // known code in the first page of the region of aRegionSize bytes at
+        // aAddress (see RecoverContextKey), and returns where it starts in
+        // aContext. Always true, with aContext of 0, unless the contexts are
+        // to be confirmed.
+        auto IsConfirmedContext(std::uint64_t aAddress, std::uint64_t aRegionSize, std::uint64_t& aContext)
+            -> bool;
+
+        // Checks the size header and the randomness of the first
+        // INDEPENDENT_PAGE_SAMPLE_BYTES bytes of a page
+        auto IsIndependentPatchGuardPage(const std::uint8_t* aContents, std::uint64_t& aSize, RandomnessInfo& aCensus)
+            -> bool;
+
+        // Scores every 4KB slice of the large page aEntry, of aMappingSize
+        // bytes, which maps aVirtualAddress
+        auto ScanLargePage(
+            std::uint64_t   aVirtualAddress,
+            std::uint64_t   aEntry,
+            std::uint64_t   aMappingSize,
+            ScratchArena&   aArena)
+            -> void;
+
+        auto ReadPfnChunk(
+            std::uint64_t   aPfnDatabase,
+            std::uint64_t   aFirstPage,
+            std::uint64_t   aCount,
+            std::uint8_t*   aEntries,
+            bool*           aReadable)
+            -> void;
+
+        auto ScanPfnChunk(
+            std::uint64_t       aPfnDatabase,
+            std::uint64_t       aFirstPage,
+            std::uint64_t       aCount,
+            std::uint64_t       aSystemRangeStart,
+            ScratchArena&       aArena)
+            -> void;
+
+    public:
+        Scanner(
+            MemorySource&                   aMemory,
+            const ScanSymbols&              aSymbols,
+            const PageTableWalk::SelfMap&   aSelfMap,
+            std::uint64_t                   aDirectoryTableBase,
+            bool                            aIsWindows10OrGreater);
+
+        // Counts what the next scans visit into aStatistics, or nothing if
+        // it is null, which is the default
+        auto SetStatistics(ScanStatistics* aStatistics)
+            -> void;
+
+        // Hands every page the next scans find to aRoutine as soon as it has
+        // been confirmed, rather than once the scan is over
+        auto SetFindingRoutine(FindingRoutine aRoutine)
+            -> void;
+
+        // Makes the next scans drop the pages which pass the randomness checks
+        // but do not hold an encrypted context whose key can be recovered.
+        // Off by default, as it reads the first page of every candidate.
+        auto SetConfirmation(bool aConfirmContexts)
+            -> void;
+
+        // Every Find function returns its pages sorted by address
+        auto FindFromBigPagePool(const ProgressRoutine& aProgress = nullptr)
+            -> CandidateTable;
+
+        // The counters of the checks of the last FindFromBigPagePool
+        auto BigPoolFilters() const
+            -> const FilterCascade&;
+
+        // Walks the page tables physically from the directory table base, and
+        // returns the pages which look like PatchGuard contexts. The 4KB
+        // slices of the Readable/Writable/Executable large pages are scored
+        // as well.
+        auto FindFromIndependentPages(const ProgressRoutine& aProgress = nullptr)
+            -> CandidateTable;
+
+        // Finds the same pages as FindFromIndependentPages, but streams the
+        // PFN database (the value of nt!MmPfnDatabase) sequentially instead of
+        // walking the page tables, and only scores active frames mapped by a
+        // writable and executable kernel PTE. The progress is reported in
+        // chunks of PFN_CHUNK_ENTRIES entries.
+        auto FindFromPfnDatabase(
+            std::uint64_t           aPfnDatabase,
+            std::uint64_t           aHighestPhysicalPage,
+            const ProgressRoutine&  aProgress = nullptr)
+            -> CandidateTable;
+
+        // Runs FindFromBigPagePool and the scan of the independent pages
+        // given by aSource at once on one pool, so that the reads of one of
+        // them overlap the work of the other. The big pool is streamed by a
+        // single task, and the other workers take the independent pages
+        // meanwhile. Each progress routine is called with the progress of its
+        // own phase. A page found by both phases is merged into a single
+        // candidate (see CandidateTable::MergeOverlapping).
+        auto FindAll(
+            const IndependentPageSource&    aSource,
+            const ProgressRoutine&          aBigPoolProgress = nullptr,
+            const ProgressRoutine&          aIndependentProgress = nullptr)
+            -> CandidateTable;
+
+        // Recovers the key of the context held by every page of aFound, as
+        // the confirmation does, reads the whole context and decrypts them
+        // all at once on the workers of the scans. The pages which hold no
+        // context, or whose context cannot be read, are left out. The result
+        // and the images are valid until the next call.
+        auto DecryptContexts(const CandidateTable& aFound)
+            -> const std::vector<DecryptedContext>&;
+    };
+
+}
@@ -0,0 +1,50 @@
+#include "ScratchArena.h"
+
+#include <stdexcept>
+
+
+namespace Sunstrider
+{
+
+    ScratchArena::ScratchArena(std::size_t aCapacity)
+        : _Buffer(new std::uint8_t[aCapacity + DEFAULT_ALIGNMENT])
+        , _Capacity(aCapacity)
+    { }
+
+    auto ScratchArena::Allocate(std::size_t aBytes, std::size_t aAlignment)
+        -> void*
+    {
+        // The buffer itself is not aligned, so align the addresses. The extra
+        // DEFAULT_ALIGNMENT bytes cover the padding of the first buffer.
+        const auto vBase    = reinterpret_cast<std::uintptr_t>(_Buffer.get());
+        const auto vAddress = (vBase + _Used + aAlignment - 1) & ~(static_cast<std::uintptr_t>(aAlignment) - 1);
+        const auto vEnd     = vAddress + aBytes - vBase;
+
+        if (vEnd > _Capacity + DEFAULT_ALIGNMENT)
+        {
+            throw std::runtime_error("The scratch arena is exhausted.");
+        }
+
+        _Used = vEnd;
+        return reinterpret_cast<void*>(vAddress);
+    }
+
+    auto ScratchArena::Mark() const
+        -> std::size_t
+    {
+        return _Used;
+    }
+
+    auto ScratchArena::Rewind(std::size_t aMark)
+        -> void
+    {
+        _Used = aMark;
+    }
+
+    auto ScratchArena::Capacity() const
+        -> std::size_t
+    {
+        return _Capacity;
+    }
+
+}
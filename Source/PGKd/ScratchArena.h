@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+
+namespace Sunstrider
+{
+
+    // A fixed-size bump allocator for scratch buffers.
+    //
+    // The whole capacity is allocated once, when the arena is created. Buffers
+    // are then carved out of it and released all at once by rewinding to a
+    // mark (see Scope), so the hot loops of a scan reuse the same memory for
+    // every table, chunk and page instead of going to the heap.
+    //
+    // An arena is not thread-safe. Every worker of a parallel scan owns its
+    // own one.
+    class ScratchArena
+    {
+    public:
+        // Buffers are aligned on a cache line, which is also enough for AVX2
+        static constexpr std::size_t DEFAULT_ALIGNMENT = 64;
+
+        // Rewinds the arena to where it was when the scope was entered
+        class Scope
+        {
+            ScratchArena&   _Arena;
+            std::size_t     _Mark;
+
+        public:
+            explicit Scope(ScratchArena& aArena)
+                : _Arena(aArena)
+                , _Mark(aArena.Mark())
+            { }
+
+            ~Scope()
+            {
+                _Arena.Rewind(_Mark);
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        };
+
+    private:
+        std::unique_ptr<std::uint8_t[]> _Buffer;
+        std::size_t                     _Capacity;
+        std::size_t                     _Used = 0;
+
+    public:
+        explicit ScratchArena(std::size_t aCapacity);
+
+        ScratchArena(ScratchArena&&) = default;
+        ScratchArena& operator=(ScratchArena&&) = default;
+
+        // Throws std::runtime_error if the arena is exhausted, which is a
+        // sizing error of the caller
+        auto Allocate(std::size_t aBytes, std::size_t aAlignment = DEFAULT_ALIGNMENT)
+            -> void*;
+
+        // Storage for aCount objects of T. The objects are not constructed,
+        // so T should be a plain structure which is filled by a read.
+        template<typename T>
+        auto Allocate(std::size_t aCount = 1)
+            -> T*
+        {
+            static_assert(alignof(T) <= DEFAULT_ALIGNMENT, "T is over-aligned.");
+            return static_cast<T*>(Allocate(sizeof(T) * aCount));
+        }
+
+        auto Mark() const
+            -> std::size_t;
+
+        auto Rewind(std::size_t aMark)
+            -> void;
+
+        auto Capacity() const
+            -> std::size_t;
+    };
+
+}
@@ -0,0 +1,654 @@
+#include "StubEmulator.h"
+
+#include <cstring>
+#include <initializer_list>
+
+
+namespace Sunstrider
+{
+
+    constexpr std::uint64_t StubEmulator::CONTEXT_BASE;
+    constexpr std::uint64_t StubEmulator::STACK_BASE;
+
+    enum : std::uint8_t
+    {
+        OP_MOV,
+        OP_XOR,
+        OP_ADD,
+        OP_ROL,
+        OP_ROR,
+        OP_INC,
+        OP_DEC,
+        OP_LOOP,
+        OP_JZ,
+        OP_JNZ,
+        OP_JMP,
+        OP_RET,
+        OP_HAND_OFF,                // call or jmp through a register
+        OP_NOP,
+    };
+
+    enum : std::uint8_t
+    {
+        REGISTER_RCX    = 1,
+        REGISTER_RDX    = 2,
+        REGISTER_RSP    = 4,
+        REGISTER_RIP    = 16,       // The base of a RIP-relative operand
+        NO_REGISTER     = 0xff,
+    };
+
+    // The shadow space of the caller, which the stub may use
+    constexpr std::uint64_t STACK_SHADOW_BYTES = 0x28;
+
+    static inline auto ReadBytes(const std::uint8_t* aCursor, std::size_t aBytes)
+        -> std::int64_t
+    {
+        switch (aBytes)
+        {
+        case 1:
+            return static_cast<std::int8_t>(*aCursor);
+        default:
+            std::int32_t vValue;
+            memcpy(&vValue, aCursor, sizeof(vValue));
+            return vValue;
+        case 8:
+            std::int64_t vWide;
+            memcpy(&vWide, aCursor, sizeof(vWide));
+            return vWide;
+        }
+    }
+
+    auto StubEmulator::DecodeModRm(
+        std::size_t&    aCursor,
+        std::uint8_t    aRex,
+        Operand&        aRegister,
+        Operand&        aRm) const
+        -> bool
+    {
+        if (aCursor >= _CodeSize)
+        {
+            return false;
+        }
+
+        const auto vModRm = _Code[aCursor++];
+        const auto vMod = vModRm >> 6;
+        const auto vRm  = vModRm & 7;
+
+        aRegister = Operand{ OPERAND_REGISTER, static_cast<std::uint8_t>(((vModRm >> 3) & 7) | ((aRex & 4) << 1)), NO_REGISTER, 0, 0 };
+
+        if (vMod == 3)
+        {
+            aRm = Operand{ OPERAND_REGISTER, static_cast<std::uint8_t>(vRm | ((aRex & 1) << 3)), NO_REGISTER, 0, 0 };
+            return true;
+        }
+
+        aRm = Operand{ OPERAND_MEMORY, static_cast<std::uint8_t>(vRm | ((aRex & 1) << 3)), NO_REGISTER, 1, 0 };
+
+        auto vDisplacementBytes = vMod == 1 ? 1u : vMod == 2 ? 4u : 0u;
+        if (vRm == 4)
+        {
+            if (aCursor >= _CodeSize)
+            {
+                return false;
+            }
+
+            const auto vSib = _Code[aCursor++];
+            const auto vIndex = static_cast<std::uint8_t>(((vSib >> 3) & 7) | ((aRex & 2) << 2));
+
+            aRm.Scale = static_cast<std::uint8_t>(1 << (vSib >> 6));
+            aRm.Index = vIndex == REGISTER_RSP ? static_cast<std::uint8_t>(NO_REGISTER) : vIndex;
+            aRm.Register = static_cast<std::uint8_t>((vSib & 7) | ((aRex & 1) << 3));
+            if ((vSib & 7) == 5 && vMod == 0)
+            {
+                aRm.Register = NO_REGISTER;
+                vDisplacementBytes = 4;
+            }
+        }
+        else if (vRm == 5 && vMod == 0)
+        {
+            aRm.Register = REGISTER_RIP;
+            vDisplacementBytes = 4;
+        }
+
+        if (aCursor + vDisplacementBytes > _CodeSize)
+        {
+            return false;
+        }
+        if (vDisplacementBytes)
+        {
+            aRm.Value = ReadBytes(_Code + aCursor, vDisplacementBytes);
+            aCursor += vDisplacementBytes;
+        }
+        return true;
+    }
+
+    auto StubEmulator::Decode(std::uint64_t aOffset, Instruction& aInstruction) const
+        -> bool
+    {
+        auto vCursor = static_cast<std::size_t>(aOffset);
+
+        // Segment overrides mean nothing in 64-bit mode
+        while (vCursor < _CodeSize &&
+            (_Code[vCursor] == 0x2E || _Code[vCursor] == 0x3E || _Code[vCursor] == 0x26 || _Code[vCursor] == 0x36))
+        {
+            ++vCursor;
+        }
+
+        std::uint8_t vRex = 0;
+        if (vCursor < _CodeSize && (_Code[vCursor] & 0xF0) == 0x40)
+        {
+            vRex = _Code[vCursor++];
+        }
+        if (vCursor >= _CodeSize)
+        {
+            return false;
+        }
+
+        aInstruction = Instruction{};
+        aInstruction.Wide = (vRex & 8) != 0;
+
+        // The immediate which follows the operands, if any
+        auto vImmediateBytes = 0u;
+
+        const auto vOpcode = _Code[vCursor++];
+        switch (vOpcode)
+        {
+        default:
+            return false;
+
+        case 0x01: case 0x31: case 0x89:    // op r/m, r
+        case 0x03: case 0x33: case 0x8B:    // op r, r/m
+        {
+            Operand vRegister, vRm;
+            if (!DecodeModRm(vCursor, vRex, vRegister, vRm))
+            {
+                return false;
+            }
+
+            const auto vToRegister = (vOpcode & 2) != 0;
+            aInstruction.Operation = (vOpcode & 0xFC) == 0x00 ? OP_ADD : (vOpcode & 0xFC) == 0x30 ? OP_XOR : OP_MOV;
+            aInstruction.Destination = vToRegister ? vRegister : vRm;
+            aInstruction.Source = vToRegister ? vRm : vRegister;
+            break;
+        }
+
+        case 0x81:                          // op r/m, imm32
+        case 0x83:                          // op r/m, imm8
+        case 0xC7:                          // mov r/m, imm32
+        {
+            Operand vRegister, vRm;
+            if (!DecodeModRm(vCursor, vRex, vRegister, vRm))
+            {
+                return false;
+            }
+
+            const auto vExtension = vRegister.Register & 7;
+            if (vOpcode == 0xC7)
+            {
+                if (vExtension != 0)
+                {
+                    return false;
+                }
+                aInstruction.Operation = OP_MOV;
+            }
+            else if (vExtension == 0 || vExtension == 6)
+            {
+                aInstruction.Operation = vExtension == 0 ? OP_ADD : OP_XOR;
+            }
+            else
+            {
+                return false;
+            }
+
+            aInstruction.Destination = vRm;
+            aInstruction.Source.Kind = OPERAND_IMMEDIATE;
+            vImmediateBytes = vOpcode == 0x83 ? 1 : 4;
+            break;
+        }
+
+        case 0xB8: case 0xB9: case 0xBA: case 0xBB:
+        case 0xBC: case 0xBD: case 0xBE: case 0xBF:     // mov r, imm
+            aInstruction.Operation = OP_MOV;
+            aInstruction.Destination = Operand{ OPERAND_REGISTER, static_cast<std::uint8_t>((vOpcode & 7) | ((vRex & 1) << 3)), NO_REGISTER, 0, 0 };
+            aInstruction.Source.Kind = OPERAND_IMMEDIATE;
+            vImmediateBytes = aInstruction.Wide ? 8 : 4;
+            break;
+
+        case 0xC1:                          // rol/ror r/m, imm8
+        case 0xD1:                          // rol/ror r/m, 1
+        case 0xD3:                          // rol/ror r/m, cl
+        {
+            Operand vRegister, vRm;
+            if (!DecodeModRm(vCursor, vRex, vRegister, vRm))
+            {
+                return false;
+            }
+
+            const auto vExtension = vRegister.Register & 7;
+            if (vExtension > 1)
+            {
+                return false;
+            }
+
+            aInstruction.Operation = vExtension == 0 ? OP_ROL : OP_ROR;
+            aInstruction.Destination = vRm;
+            if (vOpcode == 0xD3)
+            {
+                aInstruction.Source = Operand{ OPERAND_REGISTER, REGISTER_RCX, NO_REGISTER, 0, 0 };
+            }
+            else
+            {
+                aInstruction.Source = Operand{ OPERAND_IMMEDIATE, NO_REGISTER, NO_REGISTER, 0, 1 };
+                vImmediateBytes = vOpcode == 0xC1 ? 1 : 0;
+            }
+            break;
+        }
+
+        case 0xFF:                          // inc/dec r/m, call/jmp r
+        {
+            Operand vRegister, vRm;
+            if (!DecodeModRm(vCursor, vRex, vRegister, vRm))
+            {
+                return false;
+            }
+
+            // The stub ends with call rax on older builds, and jmp rax
+            const auto vExtension = vRegister.Register & 7;
+            if ((vExtension == 2 || vExtension == 4) && vRm.Kind == OPERAND_REGISTER)
+            {
+                aInstruction.Operation = OP_HAND_OFF;
+                aInstruction.Source = vRm;
+                break;
+            }
+            if (vExtension > 1)
+            {
+                return false;
+            }
+
+            aInstruction.Operation = vExtension == 0 ? OP_INC : OP_DEC;
+            aInstruction.Destination = vRm;
+            break;
+        }
+
+        case 0xE2:                          // loop rel8
+        case 0x74:                          // jz rel8
+        case 0x75:                          // jnz rel8
+        case 0xEB:                          // jmp rel8
+            aInstruction.Operation = vOpcode == 0xE2 ? OP_LOOP : vOpcode == 0x74 ? OP_JZ : vOpcode == 0x75 ? OP_JNZ : OP_JMP;
+            aInstruction.Source.Kind = OPERAND_IMMEDIATE;
+            vImmediateBytes = 1;
+            break;
+
+        case 0xE9:                          // jmp rel32
+            aInstruction.Operation = OP_JMP;
+            aInstruction.Source.Kind = OPERAND_IMMEDIATE;
+            vImmediateBytes = 4;
+            break;
+
+        case 0x0F:                          // jz/jnz rel32
+            if (vCursor >= _CodeSize || (_Code[vCursor] != 0x84 && _Code[vCursor] != 0x85))
+            {
+                return false;
+            }
+            aInstruction.Operation = _Code[vCursor++] == 0x84 ? OP_JZ : OP_JNZ;
+            aInstruction.Source.Kind = OPERAND_IMMEDIATE;
+            vImmediateBytes = 4;
+            break;
+
+        case 0xC3:
+            aInstruction.Operation = OP_RET;
+            break;
+
+        case 0x90:
+            aInstruction.Operation = OP_NOP;
+            break;
+        }
+
+        if (vCursor + vImmediateBytes > _CodeSize)
+        {
+            return false;
+        }
+        if (vImmediateBytes)
+        {
+            aInstruction.Source.Value = ReadBytes(_Code + vCursor, vImmediateBytes);
+            vCursor += vImmediateBytes;
+        }
+
+        aInstruction.Length = static_cast<std::uint8_t>(vCursor - aOffset);
+
+        // A RIP-relative operand only depends on where the instruction is
+        for (auto vOperand : { &aInstruction.Destination, &aInstruction.Source })
+        {
+            if (vOperand->Kind == OPERAND_MEMORY && vOperand->Register == REGISTER_RIP)
+            {
+                vOperand->Value += aOffset + aInstruction.Length;
+            }
+        }
+        return true;
+    }
+
+    // The bytes of the context out of the image read zeros, and writes to
+    // them are discarded
+    auto StubEmulator::Access(std::uint64_t aAddress, std::size_t aBytes)
+        -> std::uint8_t*
+    {
+        if (aAddress >= CONTEXT_BASE && aAddress - CONTEXT_BASE <= _ContextBytes - aBytes && aBytes <= _ContextBytes)
+        {
+            const auto vOffset = aAddress - CONTEXT_BASE;
+            if (vOffset + aBytes <= _ImageSize)
+            {
+                return _Image + vOffset;
+            }
+
+            _Discarded = 0;
+            return reinterpret_cast<std::uint8_t*>(&_Discarded);
+        }
+
+        if (aAddress >= STACK_BASE && aAddress - STACK_BASE <= STACK_BYTES - aBytes)
+        {
+            return _Stack.data() + (aAddress - STACK_BASE);
+        }
+
+        return nullptr;
+    }
+
+    auto StubEmulator::GetAddress(const Operand& aOperand) const
+        -> std::uint64_t
+    {
+        auto vAddress = static_cast<std::uint64_t>(aOperand.Value);
+        if (aOperand.Register == REGISTER_RIP)
+        {
+            vAddress += CONTEXT_BASE;
+        }
+        else if (aOperand.Register != NO_REGISTER)
+        {
+            vAddress += _Registers[aOperand.Register];
+        }
+        if (aOperand.Index != NO_REGISTER)
+        {
+            vAddress += _Registers[aOperand.Index] * aOperand.Scale;
+        }
+        return vAddress;
+    }
+
+    auto StubEmulator::Read(const Instruction& aInstruction, const Operand& aOperand, std::uint64_t& aValue)
+        -> bool
+    {
+        const auto vBytes = aInstruction.Wide ? sizeof(std::uint64_t) : sizeof(std::uint32_t);
+
+        switch (aOperand.Kind)
+        {
+        case OPERAND_REGISTER:
+            aValue = _Registers[aOperand.Register];
+            break;
+
+        case OPERAND_IMMEDIATE:
+            aValue = static_cast<std::uint64_t>(aOperand.Value);
+            break;
+
+        case OPERAND_MEMORY:
+        {
+            const auto vCursor = Access(GetAddress(aOperand), vBytes);
+            if (!vCursor)
+            {
+                return false;
+            }
+            if (aInstruction.Wide)
+            {
+                memcpy(&aValue, vCursor, sizeof(std::uint64_t));
+            }
+            else
+            {
+                std::uint32_t vValue;
+                memcpy(&vValue, vCursor, sizeof(vValue));
+                aValue = vValue;
+            }
+            break;
+        }
+
+        default:
+            return false;
+        }
+
+        if (!aInstruction.Wide)
+        {
+            aValue &= 0xFFFFFFFF;
+        }
+        return true;
+    }
+
+    // A 32-bit write to a register clears its upper half
+    auto StubEmulator::Write(const Instruction& aInstruction, const Operand& aOperand, std::uint64_t aValue)
+        -> bool
+    {
+        const auto vBytes = aInstruction.Wide ? sizeof(std::uint64_t) : sizeof(std::uint32_t);
+        if (!aInstruction.Wide)
+        {
+            aValue &= 0xFFFFFFFF;
+        }
+
+        if (aOperand.Kind == OPERAND_REGISTER)
+        {
+            _Registers[aOperand.Register] = aValue;
+            return true;
+        }
+
+        const auto vCursor = aOperand.Kind == OPERAND_MEMORY ? Access(GetAddress(aOperand), vBytes) : nullptr;
+        if (!vCursor)
+        {
+            return false;
+        }
+        if (aInstruction.Wide)
+        {
+            memcpy(vCursor, &aValue, sizeof(std::uint64_t));
+        }
+        else
+        {
+            const auto vValue = static_cast<std::uint32_t>(aValue);
+            memcpy(vCursor, &vValue, sizeof(vValue));
+        }
+        return true;
+    }
+
+    auto StubEmulator::Execute(const Instruction& aInstruction, std::uint64_t& aRip)
+        -> bool
+    {
+        auto vNext = aRip + aInstruction.Length;
+        const auto vBits = aInstruction.Wide ? 64u : 32u;
+        const auto vMask = aInstruction.Wide ? ~0ull : 0xFFFFFFFFull;
+
+        std::uint64_t vDestination = 0;
+        std::uint64_t vSource = 0;
+
+        switch (aInstruction.Operation)
+        {
+        case OP_MOV:
+            if (!Read(aInstruction, aInstruction.Source, vSource) ||
+                !Write(aInstruction, aInstruction.Destination, vSource))
+            {
+                return false;
+            }
+            break;
+
+        case OP_XOR:
+        case OP_ADD:
+        case OP_INC:
+        case OP_DEC:
+            if (!Read(aInstruction, aInstruction.Destination, vDestination))
+            {
+                return false;
+            }
+
+            if (aInstruction.Operation == OP_INC || aInstruction.Operation == OP_DEC)
+            {
+                vSource = aInstruction.Operation == OP_INC ? 1 : vMask;
+            }
+            else if (!Read(aInstruction, aInstruction.Source, vSource))
+            {
+                return false;
+            }
+
+            vDestination = (aInstruction.Operation == OP_XOR ? vDestination ^ vSource : vDestination + vSource) & vMask;
+            _Zero = !vDestination;
+            if (!Write(aInstruction, aInstruction.Destination, vDestination))
+            {
+                return false;
+            }
+            break;
+
+        case OP_ROL:
+        case OP_ROR:
+        {
+            if (!Read(aInstruction, aInstruction.Destination, vDestination) ||
+                !Read(aInstruction, aInstruction.Source, vSource))
+            {
+                return false;
+            }
+
+            auto vCount = static_cast<std::uint32_t>(vSource & (vBits - 1));
+            if (aInstruction.Operation == OP_ROR)
+            {
+                vCount = (vBits - vCount) & (vBits - 1);
+            }
+            if (vCount)
+            {
+                vDestination = ((vDestination << vCount) | (vDestination >> (vBits - vCount))) & vMask;
+            }
+            if (!Write(aInstruction, aInstruction.Destination, vDestination))
+            {
+                return false;
+            }
+            break;
+        }
+
+        case OP_LOOP:
+            if (--_Registers[REGISTER_RCX])
+            {
+                vNext += aInstruction.Source.Value;
+            }
+            break;
+
+        case OP_JZ:
+        case OP_JNZ:
+            if (_Zero == (aInstruction.Operation == OP_JZ))
+            {
+                vNext += aInstruction.Source.Value;
+            }
+            break;
+
+        case OP_JMP:
+            vNext += aInstruction.Source.Value;
+            break;
+
+        default:
+            break;
+        }
+
+        aRip = vNext;
+        return true;
+    }
+
+    auto StubEmulator::Run(
+        const std::uint8_t* aCode,
+        std::size_t         aCodeSize,
+        std::uint64_t       aKey,
+        std::uint8_t*       aImage,
+        std::size_t         aImageSize,
+        std::uint64_t       aContextBytes,
+        std::uint64_t       aMaximumInstructions)
+        -> Status
+    {
+        _Code = aCode;
+        _CodeSize = aCodeSize < MAXIMUM_CODE_BYTES ? aCodeSize : MAXIMUM_CODE_BYTES;
+        _Image = aImage;
+        _ImageSize = aImageSize;
+        _ContextBytes = aContextBytes;
+        _Zero = false;
+
+        _Registers.fill(0);
+        _Registers[REGISTER_RCX] = CONTEXT_BASE;
+        _Registers[REGISTER_RDX] = aKey;
+        _Registers[REGISTER_RSP] = STACK_BASE + STACK_BYTES - STACK_SHADOW_BYTES;
+        _Stack.fill(0);
+
+        for (auto& vInstruction : _Decoded)
+        {
+            vInstruction.Length = 0;
+        }
+
+        // The counters are kept out of the members, which the writes to the
+        // image would otherwise make the compiler reload
+        std::uint64_t vRip = 0;
+        std::uint64_t vExecuted = 0;
+        auto vStatus = STUB_LIMIT;
+
+        for (; vExecuted < aMaximumInstructions; ++vExecuted)
+        {
+            if (vRip >= _CodeSize)
+            {
+                vStatus = STUB_FAULT;
+                break;
+            }
+
+            auto& vInstruction = _Decoded[static_cast<std::size_t>(vRip)];
+            if (!vInstruction.Length && !Decode(vRip, vInstruction))
+            {
+                vStatus = STUB_UNSUPPORTED;
+                break;
+            }
+
+            if (vInstruction.Operation == OP_RET)
+            {
+                ++vExecuted;
+                vStatus = STUB_RETURNED;
+                break;
+            }
+
+            // The context has been decrypted, and the routine it holds is
+            // not part of the stub
+            if (vInstruction.Operation == OP_HAND_OFF)
+            {
+                ++vExecuted;
+                vStatus = STUB_HANDED_OFF;
+                break;
+            }
+
+            if (!Execute(vInstruction, vRip))
+            {
+                vStatus = STUB_FAULT;
+                break;
+            }
+        }
+
+        _Rip = vRip;
+        _Executed = vExecuted;
+        return vStatus;
+    }
+
+    auto StubEmulator::Executed() const
+        -> std::uint64_t
+    {
+        return _Executed;
+    }
+
+    auto StubEmulator::StopOffset() const
+        -> std::uint64_t
+    {
+        return _Rip;
+    }
+
+    auto StubEmulator::GetStatusName(Status aStatus)
+        -> const char*
+    {
+        switch (aStatus)
+        {
+        case STUB_RETURNED:     return "returned";
+        case STUB_HANDED_OFF:   return "handed off";
+        case STUB_UNSUPPORTED:  return "unsupported instruction";
+        case STUB_FAULT:        return "fault";
+        case STUB_LIMIT:        return "instruction limit";
+        default:                return "unknown";
+        }
+    }
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+#include "ContextCipher.h"
+
+
+namespace Sunstrider
+{
+
+    // A small x86-64 interpreter for the code at the head of a context
+    // (PGContextHeader::PatchGuardVerification), so that a context is
+    // decrypted by its own code rather than by a port of each build's
+    // variant of it.
+    //
+    // Only what the stub uses is supported: mov, xor and add between
+    // registers, memory and immediates, rol/ror, inc/dec, loop, jz/jnz, jmp
+    // and ret, with 32-bit and 64-bit operands. The stub ends with a call or
+    // a jmp through a register, which hands the decrypted context over to
+    // the routine it holds; the emulation stops there. Anything else stops
+    // the emulation. Every instruction is decoded once per run, into a table
+    // indexed by its offset, and nothing is allocated.
+    //
+    // The stub decrypts the qwords ahead of the one it runs, so the code is
+    // fetched from a copy of the header decrypted with the key (see
+    // DecryptContext), while its reads and writes go to the image.
+    class StubEmulator
+    {
+    public:
+        enum Status : std::uint32_t
+        {
+            STUB_RETURNED,          // The stub ran up to its ret
+            STUB_HANDED_OFF,        // The stub ran up to the call or jmp to the routine of the context
+            STUB_UNSUPPORTED,       // An instruction which is not supported
+            STUB_FAULT,             // An access out of the context and the stack, or a jump out of the stub
+            STUB_LIMIT,             // Too many instructions
+        };
+
+        // Where the context and the stack of the stub are. The stub only
+        // sees its context through rcx, so any address does.
+        static constexpr std::uint64_t  CONTEXT_BASE    = 0xFFFFF80000000000ull;
+        static constexpr std::uint64_t  STACK_BASE      = 0xFFFFF70000000000ull;
+        static constexpr std::size_t    STACK_BYTES     = 0x100;
+
+        // The code of the stub: PatchGuardVerification
+        static constexpr std::size_t    MAXIMUM_CODE_BYTES = CONTEXT_HEADER_BYTES - sizeof(std::uint32_t);
+
+        // A limit of instructions per qword of a context which is ample for
+        // a loop of the stub, and stops one which never ends
+        static constexpr std::uint64_t  INSTRUCTIONS_PER_QWORD = 0x20;
+
+    private:
+        enum OperandKind : std::uint8_t
+        {
+            OPERAND_NONE,
+            OPERAND_REGISTER,
+            OPERAND_MEMORY,
+            OPERAND_IMMEDIATE,
+        };
+
+        struct Operand
+        {
+            OperandKind     Kind;
+            std::uint8_t    Register;       // The register, or the base of a memory operand
+            std::uint8_t    Index;
+            std::uint8_t    Scale;
+            std::int64_t    Value;          // The displacement or the immediate
+        };
+
+        struct Instruction
+        {
+            std::uint8_t    Length;         // 0 until it has been decoded
+            std::uint8_t    Operation;
+            bool            Wide;           // 64-bit operands
+            Operand         Destination;
+            Operand         Source;         // The count of a rotation, or the target of a branch
+        };
+
+        std::array<std::uint64_t, 16>                       _Registers;
+        bool                                                _Zero;
+        std::array<std::uint8_t, STACK_BYTES>               _Stack;
+        std::array<Instruction, MAXIMUM_CODE_BYTES>         _Decoded;
+        std::uint64_t                                       _Discarded;
+
+        const std::uint8_t* _Code = nullptr;
+        std::size_t         _CodeSize = 0;
+        std::uint8_t*       _Image = nullptr;
+        std::size_t         _ImageSize = 0;
+        std::uint64_t       _ContextBytes = 0;
+        std::uint64_t       _Rip = 0;
+        std::uint64_t       _Executed = 0;
+
+        auto Decode(std::uint64_t aOffset, Instruction& aInstruction) const
+            -> bool;
+
+        auto DecodeModRm(
+            std::size_t&    aCursor,
+            std::uint8_t    aRex,
+            Operand&        aRegister,
+            Operand&        aRm) const
+            -> bool;
+
+        auto Access(std::uint64_t aAddress, std::size_t aBytes)
+            -> std::uint8_t*;
+
+        auto GetAddress(const Operand& aOperand) const
+            -> std::uint64_t;
+
+        auto Read(const Instruction& aInstruction, const Operand& aOperand, std::uint64_t& aValue)
+            -> bool;
+
+        auto Write(const Instruction& aInstruction, const Operand& aOperand, std::uint64_t aValue)
+            -> bool;
+
+        // Returns false on a fault
+        auto Execute(const Instruction& aInstruction, std::uint64_t& aRip)
+            -> bool;
+
+    public:
+        // Runs aCode, the stub of aCodeSize bytes, with rcx pointing to the
+        // context and rdx holding aKey. aImage holds the first aImageSize
+        // bytes of the context, which spans aContextBytes bytes: the accesses
+        // to the rest of it read zeros and are discarded, so that a view of
+        // the context can be decrypted without the whole of it.
+        auto Run(
+            const std::uint8_t* aCode,
+            std::size_t         aCodeSize,
+            std::uint64_t       aKey,
+            std::uint8_t*       aImage,
+            std::size_t         aImageSize,
+            std::uint64_t       aContextBytes,
+            std::uint64_t       aMaximumInstructions)
+            -> Status;
+
+        // The instructions run by the last Run
+        auto Executed() const
+            -> std::uint64_t;
+
+        // The offset in the stub of the instruction which stopped the last
+        // Run: the ret, the call or jmp which hands off, or the faulting one
+        auto StopOffset() const
+            -> std::uint64_t;
+
+        static auto GetStatusName(Status aStatus)
+            -> const char*;
+    };
+
+}
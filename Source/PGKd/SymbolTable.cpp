@@ -0,0 +1,81 @@
+#include "stdafx.h"
+#include "SymbolTable.h"
+
+
+namespace Sunstrider
+{
+
+    static const PCSTR sSymbolNames[SymbolTable::NUMBER_OF_SYMBOLS] =
+    {
+        "nt!PoolBigPageTable",
+        "nt!PoolBigPageTableSize",
+        "nt!MmSystemRangeStart",
+        "nt!MmPfnDatabase",
+        "nt!MmHighestPhysicalPage",
+        "nt!FsRtlUninitializeSmallMcb",
+        "nt!FsRtlMdlReadCompleteDevEx",
+    };
+
+    auto SymbolTable::Lookup(IDebugSymbols* aSymbols, Symbol aSymbol)
+        -> void
+    {
+        auto& vEntry = _Entries[aSymbol];
+        vEntry.Offset = 0;
+        vEntry.Status = aSymbols->GetOffsetByName(sSymbolNames[aSymbol], &vEntry.Offset);
+        ++_Lookups;
+    }
+
+    auto SymbolTable::Resolve(IDebugSymbols* aSymbols)
+        -> void
+    {
+        // A missing symbol does not fail the others, as not every command
+        // needs all of them
+        for (std::size_t i = 0; i < NUMBER_OF_SYMBOLS; ++i)
+        {
+            Lookup(aSymbols, static_cast<Symbol>(i));
+        }
+
+        _Resolved = true;
+    }
+
+    auto SymbolTable::Get(IDebugSymbols* aSymbols, Symbol aSymbol, UINT64* aOffset)
+        -> HRESULT
+    {
+        if (!_Resolved)
+        {
+            Resolve(aSymbols);
+        }
+        else if (FAILED(_Entries[aSymbol].Status))
+        {
+            // Only the addresses which were found are kept: the symbols may
+            // have been loaded or fixed with .reload since
+            Lookup(aSymbols, aSymbol);
+        }
+
+        const auto& vEntry = _Entries[aSymbol];
+        if (SUCCEEDED(vEntry.Status))
+        {
+            *aOffset = vEntry.Offset;
+        }
+        return vEntry.Status;
+    }
+
+    auto SymbolTable::Invalidate()
+        -> void
+    {
+        _Resolved = false;
+    }
+
+    auto SymbolTable::Lookups() const
+        -> UINT64
+    {
+        return _Lookups;
+    }
+
+    auto SymbolTable::GetName(Symbol aSymbol)
+        -> PCSTR
+    {
+        return sSymbolNames[aSymbol];
+    }
+
+}
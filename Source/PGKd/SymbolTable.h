@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+
+
+namespace Sunstrider
+{
+
+    // The addresses of the nt symbols used by PGKd, for the current session.
+    //
+    // Looking a symbol up goes through the symbol engine every time, and the
+    // dump of every PatchGuard context needs two of them. The table resolves
+    // all of them in one batch the first time one is needed, and serves them
+    // from memory until Invalidate() is called because the target changed.
+    // A symbol which was not found is looked up again every time it is asked.
+    class SymbolTable
+    {
+    public:
+        enum Symbol : std::size_t
+        {
+            PoolBigPageTable,
+            PoolBigPageTableSize,
+            MmSystemRangeStart,
+            MmPfnDatabase,
+            MmHighestPhysicalPage,
+            FsRtlUninitializeSmallMcb,
+            FsRtlMdlReadCompleteDevEx,
+
+            NUMBER_OF_SYMBOLS,
+        };
+
+    private:
+        struct Entry
+        {
+            HRESULT Status;
+            UINT64  Offset;
+        };
+
+        std::array<Entry, NUMBER_OF_SYMBOLS>    _Entries    = {};
+        bool                                    _Resolved   = false;
+        UINT64                                  _Lookups    = 0;
+
+        auto Lookup(IDebugSymbols* aSymbols, Symbol aSymbol)
+            -> void;
+
+        auto Resolve(IDebugSymbols* aSymbols)
+            -> void;
+
+    public:
+        // Returns the HRESULT of the lookup of the symbol, which was made
+        // when the table was resolved, or now if it failed then
+        auto Get(IDebugSymbols* aSymbols, Symbol aSymbol, UINT64* aOffset)
+            -> HRESULT;
+
+        // Forgets every address. Called when the debugger session changes.
+        auto Invalidate()
+            -> void;
+
+        // The number of lookups made through the symbol engine so far
+        auto Lookups() const
+            -> UINT64;
+
+        static auto GetName(Symbol aSymbol)
+            -> PCSTR;
+    };
+
+}
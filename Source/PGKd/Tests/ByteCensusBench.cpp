@@ -0,0 +1,109 @@
+// Times the census of the samples taken by the scanner (EXAMINATION_BYTES of
+// every candidate page) with the std::set implementation, the scalar kernel
+// and the kernel selected for this processor. As in the scanner, which has
+// just read them, the samples are in the cache.
+//
+//   ByteCensusBench [passes]
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "ByteCensus.h"
+#include "ByteCensusReference.h"
+#include "Scanner.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    using CensusRoutine = RandomnessInfo(*)(const void*, std::size_t);
+
+    auto TakeByteCensusReference(const void* aAddress, std::size_t aSize)
+        -> RandomnessInfo
+    {
+        return RandomnessInfo{
+            GetNumberOfDistinctiveNumbersReference(aAddress, aSize),
+            GetRamdomnessReference(aAddress, aSize) };
+    }
+
+    // 400KB, which stay in the L2 cache
+    constexpr std::size_t SAMPLES = 0x1000;
+
+    // Returns the nanoseconds per sample, and adds the results to aChecksum
+    auto Time(CensusRoutine aRoutine, const std::vector<std::uint8_t>& aSamples, std::uint64_t aPasses, std::uint64_t& aChecksum)
+        -> double
+    {
+        constexpr auto SAMPLE_BYTES = Scanner::EXAMINATION_BYTES;
+
+        const auto vStart = std::chrono::steady_clock::now();
+        for (std::uint64_t vPass = 0; vPass < aPasses; ++vPass)
+        {
+            for (std::size_t i = 0; i < SAMPLES; ++i)
+            {
+                const auto vCensus = aRoutine(aSamples.data() + i * SAMPLE_BYTES, SAMPLE_BYTES);
+                aChecksum += vCensus.NumberOfDistinctiveNumbers * 0x100 + vCensus.Ramdomness;
+            }
+        }
+        const auto vElapsed = std::chrono::steady_clock::now() - vStart;
+
+        return std::chrono::duration<double, std::nano>(vElapsed).count() / (aPasses * SAMPLES);
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    const auto vPasses = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 200;
+
+    // Pages of code and data, which repeat a few values, as well as random
+    // ones, which look like PatchGuard contexts
+    std::mt19937 vRandom(1);
+    std::vector<std::uint8_t> vBuffer(SAMPLES * Scanner::EXAMINATION_BYTES);
+    for (std::size_t i = 0; i < SAMPLES; ++i)
+    {
+        const auto vAlphabet = 1 + vRandom() % 0x100;
+        for (std::size_t j = 0; j < Scanner::EXAMINATION_BYTES; ++j)
+        {
+            vBuffer[i * Scanner::EXAMINATION_BYTES + j] = static_cast<std::uint8_t>(vRandom() % vAlphabet);
+        }
+    }
+
+    const struct
+    {
+        const char*     Name;
+        CensusRoutine   Routine;
+    }
+    ROUTINES[] = {
+        { "std::set",       &TakeByteCensusReference },
+        { "scalar",         &TakeByteCensusScalar },
+        { "TakeByteCensus", &TakeByteCensus },
+    };
+
+    std::printf("%llu passes over %zu samples of %u bytes\n",
+        static_cast<unsigned long long>(vPasses), SAMPLES, Scanner::EXAMINATION_BYTES);
+
+    std::uint64_t vExpected = 0;
+    for (const auto& vRoutine : ROUTINES)
+    {
+        std::uint64_t vChecksum = 0;
+        const auto vNanoseconds = Time(vRoutine.Routine, vBuffer, vPasses, vChecksum);
+        std::printf("%-16s %8.1f ns per sample\n", vRoutine.Name, vNanoseconds);
+
+        if (vRoutine.Routine == &TakeByteCensusReference)
+        {
+            vExpected = vChecksum;
+        }
+        else if (vChecksum != vExpected)
+        {
+            std::fprintf(stderr, "%s does not match std::set.\n", vRoutine.Name);
+            return 1;
+        }
+    }
+
+    return 0;
+}
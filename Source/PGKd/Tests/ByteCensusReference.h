@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <set>
+
+
+namespace Sunstrider
+{
+
+    // GetNumberOfDistinctiveNumbers and GetRamdomness as they were before
+    // TakeByteCensus, the reference of its tests and benchmarks
+
+    inline auto GetNumberOfDistinctiveNumbersReference(const void* aAddress, std::size_t aSize)
+        -> std::uint32_t
+    {
+        const auto vCursor = static_cast<const std::uint8_t*>(aAddress);
+
+        std::uint32_t vCount = 0;
+        for (std::size_t i = 0u; i < aSize; ++i)
+        {
+            if (vCursor[i] == 0xff || vCursor[i] == 0x00)
+            {
+                vCount++;
+            }
+        }
+
+        return vCount;
+    }
+
+    inline auto GetRamdomnessReference(const void* aAddress, std::size_t aSize)
+        -> std::uint32_t
+    {
+        const auto vCursor = static_cast<const std::uint8_t*>(aAddress);
+
+        std::set<std::uint8_t> vDict;
+        for (std::size_t i = 0u; i < aSize; ++i)
+        {
+            vDict.emplace(vCursor[i]);
+        }
+
+        return static_cast<std::uint32_t>(vDict.size());
+    }
+
+}
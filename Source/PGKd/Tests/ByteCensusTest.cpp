@@ -0,0 +1,114 @@
+// Checks TakeByteCensus, with the kernel selected for this processor, and
+// TakeByteCensusScalar against the std::set implementation:
+//
+//   - every byte value at every position of a sample, in every size up to
+//     64 bytes (every tail of both vector widths) and in the sizes scanned,
+//     so that every lane and every bit of the bitmap is covered
+//   - random samples of every size and alignment up to 0x100 bytes, drawn
+//     from alphabets of 1 to 256 values
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ByteCensus.h"
+#include "ByteCensusReference.h"
+#include "Scanner.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    auto Check(const std::uint8_t* aSample, std::size_t aSize)
+        -> bool
+    {
+        const auto vDistinctive = GetNumberOfDistinctiveNumbersReference(aSample, aSize);
+        const auto vRandomness  = GetRamdomnessReference(aSample, aSize);
+
+        const RandomnessInfo vResults[] = {
+            TakeByteCensus(aSample, aSize),
+            TakeByteCensusScalar(aSample, aSize),
+        };
+
+        for (const auto& vResult : vResults)
+        {
+            if (vResult.NumberOfDistinctiveNumbers != vDistinctive || vResult.Ramdomness != vRandomness)
+            {
+                std::fprintf(stderr, "%zu bytes: got %u and %u instead of %u and %u.\n", aSize,
+                    vResult.NumberOfDistinctiveNumbers, vResult.Ramdomness, vDistinctive, vRandomness);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+int main()
+{
+    constexpr std::size_t MAXIMUM_SIZE = 0x100;
+    constexpr std::size_t ALIGNMENTS   = 32;
+
+    std::vector<std::size_t> vSweptSizes;
+    for (std::size_t vSize = 1; vSize <= 64; ++vSize)
+    {
+        vSweptSizes.push_back(vSize);
+    }
+    vSweptSizes.push_back(Scanner::EXAMINATION_BYTES);
+    vSweptSizes.push_back(MAXIMUM_SIZE);
+
+    std::vector<std::uint8_t> vBuffer(MAXIMUM_SIZE + ALIGNMENTS);
+    std::uint64_t vChecks = 0;
+
+    // A single value over a background of 0x00, then of 0x5a
+    for (const auto vBackground : { 0x00, 0x5a })
+    {
+        for (const auto vSize : vSweptSizes)
+        {
+            for (std::size_t vPosition = 0; vPosition < vSize; ++vPosition)
+            {
+                for (auto vValue = 0; vValue < 0x100; ++vValue)
+                {
+                    std::fill(vBuffer.begin(), vBuffer.begin() + vSize, static_cast<std::uint8_t>(vBackground));
+                    vBuffer[vPosition] = static_cast<std::uint8_t>(vValue);
+
+                    if (!Check(vBuffer.data(), vSize))
+                    {
+                        return 1;
+                    }
+                    ++vChecks;
+                }
+            }
+        }
+    }
+
+    std::mt19937 vRandom(1);
+    for (const auto vAlphabet : { 1u, 2u, 3u, 16u, 100u, 255u, 256u })
+    {
+        std::uniform_int_distribution<std::uint32_t> vByte(0, vAlphabet - 1);
+        for (std::size_t vSize = 0; vSize <= MAXIMUM_SIZE; ++vSize)
+        {
+            for (std::size_t vAlignment = 0; vAlignment < ALIGNMENTS; ++vAlignment)
+            {
+                // The alphabet is moved around, so that it is not always at 0
+                const auto vBase = static_cast<std::uint32_t>(vRandom());
+                for (std::size_t i = 0; i < vSize; ++i)
+                {
+                    vBuffer[vAlignment + i] = static_cast<std::uint8_t>(vBase + vByte(vRandom));
+                }
+
+                if (!Check(vBuffer.data() + vAlignment, vSize))
+                {
+                    return 1;
+                }
+                ++vChecks;
+            }
+        }
+    }
+
+    std::printf("%llu samples checked.\n", static_cast<unsigned long long>(vChecks));
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Times the decryption of a batch of contexts by ContextDecryptor with a
+// growing number of workers, against the portable decryption on one thread.
+//
+//   ContextDecryptorBench [contexts] [KB per context] [passes]
+//
+// The contexts are random, and encrypted with the scheme they are decrypted
+// with, which is its own inverse. Returns 1 if an image is not the context it
+// was encrypted from.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "ContextDecryptor.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    // The best time of aPasses runs of aRun
+    template<typename Run>
+    auto Time(std::uint64_t aPasses, Run aRun)
+        -> double
+    {
+        auto vBest = 0.0;
+        for (std::uint64_t i = 0; i < aPasses; ++i)
+        {
+            const auto vStart = std::chrono::steady_clock::now();
+            aRun();
+            const auto vSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - vStart).count();
+
+            vBest = i ? std::min(vBest, vSeconds) : vSeconds;
+        }
+        return vBest;
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    const auto vNumberOfContexts = std::max<std::size_t>(argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 16, 1);
+    const auto vContextKilobytes = std::max<std::uint64_t>(argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 2048, 1);
+    const auto vPasses           = std::max<std::uint64_t>(argc > 3 ? std::strtoull(argv[3], nullptr, 0) : 5, 1);
+
+    std::mt19937_64 vRandom(1);
+
+    auto vKeys = std::vector<ContextKey>();
+    auto vPlain = std::vector<std::vector<std::uint8_t>>();
+    auto vEncrypted = std::vector<std::vector<std::uint8_t>>();
+    auto vContexts = std::vector<ContextDecryptor::EncryptedContext>();
+    auto vBytes = 0ull;
+
+    for (std::size_t i = 0; i < vNumberOfContexts; ++i)
+    {
+        // The sizes differ a little, so that the last slices do not line up
+        const auto vQwords = static_cast<std::uint32_t>(vContextKilobytes * 0x400 / sizeof(std::uint64_t) - i);
+        vKeys.push_back(ContextKey{ 0, vRandom(), vQwords });
+
+        const auto vSize = static_cast<std::size_t>(GetContextBytes(vKeys.back()));
+        vPlain.emplace_back(vSize);
+        for (std::size_t j = 0; j < vSize; j += sizeof(std::uint64_t))
+        {
+            const auto vQword = vRandom();
+            memcpy(vPlain.back().data() + j, &vQword, sizeof(vQword));
+        }
+
+        vEncrypted.emplace_back(vSize);
+        DecryptContextScalar(vPlain.back().data(), vEncrypted.back().data(), vKeys.back(), 0, vSize / sizeof(std::uint64_t));
+        vBytes += vSize;
+    }
+    for (std::size_t i = 0; i < vNumberOfContexts; ++i)
+    {
+        vContexts.push_back(ContextDecryptor::EncryptedContext{ vEncrypted[i].data(), vKeys[i] });
+    }
+
+    std::printf("%zu contexts, %llu KB, best of %llu passes\n", vNumberOfContexts,
+        static_cast<unsigned long long>(vBytes / 0x400), static_cast<unsigned long long>(vPasses));
+    std::printf("%-20s %10s %10s %8s\n", "decryption", "seconds", "GB/s", "speedup");
+
+    // The portable decryption of every context, one after the other
+    auto vScalarImage = std::vector<std::uint8_t>(vPlain.front().size());
+    const auto vScalarSeconds = Time(vPasses, [&]
+    {
+        for (std::size_t i = 0; i < vNumberOfContexts; ++i)
+        {
+            DecryptContextScalar(vEncrypted[i].data(), vScalarImage.data(), vKeys[i], 0, vEncrypted[i].size() / sizeof(std::uint64_t));
+        }
+    });
+    std::printf("%-20s %10.4f %10.2f %7.2fx\n", "scalar, 1 thread", vScalarSeconds, vBytes / vScalarSeconds / 1e9, 1.0);
+
+    // At least 8 workers, to show the scaling on a small machine
+    const auto vMaxWorkers = std::max<std::size_t>(std::thread::hardware_concurrency(), 8);
+
+    ContextDecryptor vDecryptor;
+    for (std::size_t vWorkers = 1; vWorkers <= vMaxWorkers; vWorkers *= 2)
+    {
+        WorkStealingPool vPool(vWorkers);
+        const auto vSeconds = Time(vPasses, [&]
+        {
+            vDecryptor.Decrypt(vPool, vContexts.data(), vContexts.size());
+        });
+
+        for (std::size_t i = 0; i < vNumberOfContexts; ++i)
+        {
+            if (vDecryptor.ImageSize(i) != vPlain[i].size() ||
+                memcmp(vDecryptor.Image(i), vPlain[i].data(), vPlain[i].size()))
+            {
+                std::fprintf(stderr, "The context %zu is not decrypted by %zu workers.\n", i, vWorkers);
+                return 1;
+            }
+        }
+
+        char vName[32];
+        std::snprintf(vName, sizeof(vName), "%zu workers", vWorkers);
+        std::printf("%-20s %10.4f %10.2f %7.2fx\n", vName, vSeconds, vBytes / vSeconds / 1e9, vScalarSeconds / vSeconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Checks how the layouts of a file override and extend the ones the extension
+// is built with, and that the layout file of the repository loads:
+//
+//   ContextLayoutTest <PGContext.layouts>
+//
+// Returns 1 on a failure.
+
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+#include "ContextLayout.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    auto MakeLayout(const char* aName, std::uint32_t aBuild, std::uint32_t aContextBytes)
+        -> ContextLayout
+    {
+        auto vLayout = ContextLayout{};
+        vLayout.Name = aName;
+        vLayout.Builds = { aBuild };
+        vLayout.ContextBytes = aContextBytes;
+        vLayout.HeaderBytes = 0xC8;
+        return vLayout;
+    }
+
+    auto Check(bool aCondition, const char* aWhat)
+        -> bool
+    {
+        if (!aCondition)
+        {
+            std::fprintf(stderr, "%s\n", aWhat);
+        }
+        return aCondition;
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: ContextLayoutTest <PGContext.layouts>\n");
+        return 2;
+    }
+
+    // Stands for GetReflectedLayouts
+    const auto vBuiltIn = std::vector<ContextLayout>
+    {
+        MakeLayout("Windows10_1507", 10240, 0x750),
+        MakeLayout("Windows10_1803", 17134, 0x930),
+    };
+
+    auto vPassed = true;
+
+    // Without a file, the built-in layouts are used as they are
+    ContextLayouts vLayouts;
+    vLayouts.Append(vBuiltIn);
+    vPassed &= Check(vLayouts.Size() == 2, "The built-in layouts were not added.");
+    vPassed &= Check(vLayouts.Find(17134) && vLayouts.Find(17134)->ContextBytes == 0x930,
+        "The built-in layout of 17134 is not found.");
+
+    // A file changes the size of 17134 and adds a build
+    std::istringstream vFile(
+        "PGContextLayouts 1\n"
+        "layout  Windows10_1803\n"
+        "builds  17134\n"
+        "size    0x940\n"
+        "header  0xC8\n"
+        "end\n"
+        "layout  Windows10_Next : Windows10_1803\n"
+        "builds  99999\n"
+        "end\n");
+
+    try
+    {
+        vLayouts.Load(vFile);
+        vLayouts.Append(vBuiltIn);
+
+        vPassed &= Check(vLayouts.Find(17134) && vLayouts.Find(17134)->ContextBytes == 0x940,
+            "The layout of the file does not override the built-in one.");
+        vPassed &= Check(vLayouts.Find(10240) && vLayouts.Find(10240)->ContextBytes == 0x750,
+            "The built-in layout of 10240 is not found with a file.");
+        vPassed &= Check(vLayouts.Find(99999) && vLayouts.Find(99999)->Name == "Windows10_Next",
+            "The build added by the file is not found.");
+        vPassed &= Check(vLayouts.Find("Windows10_1803") && vLayouts.Find("Windows10_1803")->ContextBytes == 0x940,
+            "The layout of the file is not found first by its name.");
+
+        // The file of the repository
+        ContextLayouts vRepository;
+        vRepository.LoadFile(argv[1]);
+        vPassed &= Check(vRepository.Find(17134) != nullptr, "PGContext.layouts has no layout for 17134.");
+    }
+    catch (std::exception& aWhat)
+    {
+        std::fprintf(stderr, "%s\n", aWhat.what());
+        return 1;
+    }
+
+    // A field whose end wraps past 4GB does not fit in the context
+    std::istringstream vWrapping(
+        "PGContextLayouts 1\n"
+        "layout  Windows10_1803\n"
+        "builds  17134\n"
+        "size    0x930\n"
+        "header  0xC8\n"
+        "field   WorkerRoutine  0xFFFFFFFC  qword\n"
+        "end\n");
+    try
+    {
+        ContextLayouts vRejected;
+        vRejected.Load(vWrapping);
+        vPassed &= Check(false, "A field at 0xFFFFFFFC was accepted.");
+    }
+    catch (std::runtime_error&)
+    {
+    }
+
+    vLayouts.Clear();
+    vPassed &= Check(vLayouts.Size() == 0 && !vLayouts.Find(17134), "The layouts were not cleared.");
+
+    return vPassed ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+// Writes a small full crash dump of a made-up system, which PGScan should
+// find a single PatchGuard page in, and the decrypted context of that page
+// to <path>.context:
+//
+//   MakeSyntheticDump <path>
+//
+// The physical memory is one run of PAGES pages:
+//
+//   1  the PML4, with the self-map at 0x1ED and the kernel at 0x1F0
+//   2  the PPE page, 3 the PDE page and 4 the PTE page of KERNEL_BASE
+//   5  KERNEL_BASE:          KDDEBUGGER_DATA64 and the variables it points to
+//   6  KERNEL_BASE + 0x1000: a random RWX page headed by its region size,
+//      with an encrypted context at CONTEXT_OFFSET
+//   7  KERNEL_BASE + 0x2000: an RWX page of code, which is not random
+//   8  KERNEL_BASE + 0x3000: the first page of PoolBigPageTable, which holds
+//      the entry of the context. The second page, KERNEL_BASE + 0x4000, is
+//      not mapped, so that the table cannot be read in one go.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+    constexpr std::uint64_t PAGE_SIZE       = 0x1000;
+    constexpr std::uint64_t PAGES           = 9;
+    constexpr std::uint64_t HEADER_SIZE     = 0x2000;
+
+    constexpr std::uint64_t KERNEL_BASE     = 0xFFFFF80000000000;
+    constexpr std::uint64_t SELF_MAP_INDEX  = 0x1ED;
+    constexpr std::uint64_t KERNEL_INDEX    = 0x1F0;
+
+    constexpr std::uint64_t PTE_VALID       = 1ull << 0;
+    constexpr std::uint64_t PTE_WRITE       = 1ull << 1;
+    constexpr std::uint64_t PTE_NO_EXECUTE  = 1ull << 63;
+
+    // The variables which follow KDDEBUGGER_DATA64 in page 5
+    constexpr std::uint64_t MM_SYSTEM_RANGE_START       = KERNEL_BASE + 0x800;
+    constexpr std::uint64_t MM_HIGHEST_PHYSICAL_PAGE    = KERNEL_BASE + 0x808;
+
+    // PoolBigPageTable and PoolBigPageTableSize are at KERNEL_BASE + 0x810 and
+    // 0x818, and are given on the command line
+    constexpr std::uint64_t BIG_PAGE_TABLE              = KERNEL_BASE + 0x3000;
+    constexpr std::uint64_t BIG_PAGE_TABLE_ENTRIES      = 2 * PAGE_SIZE / 0x18;
+
+    constexpr std::uint64_t CONTEXT_REGION_SIZE = 0x5000;
+
+    // The context fills the second half of page 6
+    constexpr std::uint64_t CONTEXT_OFFSET      = 0x800;
+    constexpr std::uint64_t CONTEXT_KEY         = 0x9E3779B97F4A7C15;
+    constexpr std::uint64_t CONTEXT_HEADER      = 0xC8;
+    constexpr std::uint64_t CONTEXT_QWORDS      = (PAGE_SIZE - CONTEXT_OFFSET - CONTEXT_HEADER) / 8;
+
+    // The first 8 qwords of CmpAppendDllSection
+    const std::uint8_t KNOWN_CODE[] =
+    {
+        0x2E, 0x48, 0x31, 0x11, 0x48, 0x31, 0x51, 0x08,
+        0x48, 0x31, 0x51, 0x10, 0x48, 0x31, 0x51, 0x18,
+        0x48, 0x31, 0x51, 0x20, 0x48, 0x31, 0x51, 0x28,
+        0x48, 0x31, 0x51, 0x30, 0x48, 0x31, 0x51, 0x38,
+        0x48, 0x31, 0x51, 0x40, 0x48, 0x31, 0x51, 0x48,
+        0x48, 0x31, 0x51, 0x50, 0x48, 0x31, 0x51, 0x58,
+        0x48, 0x31, 0x51, 0x60, 0x48, 0x31, 0x51, 0x68,
+        0x48, 0x31, 0x51, 0x70, 0x48, 0x31, 0x51, 0x78,
+    };
+
+    template<typename T>
+    auto Poke(std::vector<std::uint8_t>& aBytes, std::uint64_t aOffset, T aValue)
+        -> void
+    {
+        memcpy(aBytes.data() + aOffset, &aValue, sizeof(aValue));
+    }
+
+    auto RotateRight(std::uint64_t aValue, std::uint64_t aBits)
+        -> std::uint64_t
+    {
+        aBits &= 63;
+        return aBits ? (aValue >> aBits) | (aValue << (64 - aBits)) : aValue;
+    }
+
+    // Encrypts aContext as the loop of CmpAppendDllSection decrypts it: the
+    // header with the key, then the body from its last qword to its first,
+    // rotating the key by the index of each qword
+    auto EncryptContext(std::vector<std::uint64_t> aContext)
+        -> std::vector<std::uint64_t>
+    {
+        for (std::uint64_t i = 0; i < CONTEXT_HEADER / 8; ++i)
+        {
+            aContext[i] ^= CONTEXT_KEY;
+        }
+
+        auto vKey = CONTEXT_KEY;
+        for (auto i = CONTEXT_QWORDS; i; --i)
+        {
+            aContext[CONTEXT_HEADER / 8 - 1 + i] ^= vKey;
+            vKey = RotateRight(vKey, i);
+        }
+        return aContext;
+    }
+
+    auto Page(std::uint64_t aFrame, std::uint64_t aOffset = 0)
+        -> std::uint64_t
+    {
+        return HEADER_SIZE + aFrame * PAGE_SIZE + aOffset;
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: MakeSyntheticDump <path>\n");
+        return 2;
+    }
+
+    std::vector<std::uint8_t> vFile(HEADER_SIZE + PAGES * PAGE_SIZE, 0);
+
+    // DUMP_HEADER64 of a full dump with one physical run
+    memcpy(vFile.data() + 0x000, "PAGE", 4);
+    memcpy(vFile.data() + 0x004, "DU64", 4);
+    Poke<std::uint32_t>(vFile, 0x00C, 17134);
+    Poke<std::uint64_t>(vFile, 0x010, 1 * PAGE_SIZE);
+    Poke<std::uint32_t>(vFile, 0x030, 0x8664);
+    Poke<std::uint64_t>(vFile, 0x080, KERNEL_BASE);
+    Poke<std::uint32_t>(vFile, 0x088, 1);
+    Poke<std::uint64_t>(vFile, 0x090, PAGES);
+    Poke<std::uint64_t>(vFile, 0x098, 0);
+    Poke<std::uint64_t>(vFile, 0x0A0, PAGES);
+    Poke<std::uint32_t>(vFile, 0xF98, 1);
+
+    // The page tables. The self-map and the data are not executable.
+    Poke<std::uint64_t>(vFile, Page(1, SELF_MAP_INDEX * 8), (1 << 12) | PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+    Poke<std::uint64_t>(vFile, Page(1, KERNEL_INDEX * 8),   (2 << 12) | PTE_VALID | PTE_WRITE);
+    Poke<std::uint64_t>(vFile, Page(2), (3 << 12) | PTE_VALID | PTE_WRITE);
+    Poke<std::uint64_t>(vFile, Page(3), (4 << 12) | PTE_VALID | PTE_WRITE);
+    Poke<std::uint64_t>(vFile, Page(4, 0x00), (5 << 12) | PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+    Poke<std::uint64_t>(vFile, Page(4, 0x08), (6 << 12) | PTE_VALID | PTE_WRITE);
+    Poke<std::uint64_t>(vFile, Page(4, 0x10), (7 << 12) | PTE_VALID | PTE_WRITE);
+    Poke<std::uint64_t>(vFile, Page(4, 0x18), (8 << 12) | PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+
+    // KDDEBUGGER_DATA64
+    memcpy(vFile.data() + Page(5, 0x10), "KDBG", 4);
+    Poke<std::uint32_t>(vFile, Page(5, 0x014), 0x340);
+    Poke<std::uint64_t>(vFile, Page(5, 0x018), KERNEL_BASE);
+    Poke<std::uint64_t>(vFile, Page(5, 0x0F0), MM_HIGHEST_PHYSICAL_PAGE);
+    Poke<std::uint64_t>(vFile, Page(5, 0x1D0), MM_SYSTEM_RANGE_START);
+    Poke<std::uint64_t>(vFile, Page(5, 0x800), 0xFFFF800000000000);
+    Poke<std::uint64_t>(vFile, Page(5, 0x808), PAGES - 1);
+    Poke<std::uint64_t>(vFile, Page(5, 0x810), BIG_PAGE_TABLE);
+    Poke<std::uint64_t>(vFile, Page(5, 0x818), BIG_PAGE_TABLE_ENTRIES);
+
+    // POOL_TRACKER_BIG_PAGES of the context, in NonPagedPool
+    Poke<std::uint64_t>(vFile, Page(8, 0x18 + 0x00), KERNEL_BASE + 0x1000);
+    memcpy(vFile.data() + Page(8, 0x18 + 0x08), "Test", 4);
+    Poke<std::uint32_t>(vFile, Page(8, 0x18 + 0x0C), 0);
+    Poke<std::uint64_t>(vFile, Page(8, 0x18 + 0x10), CONTEXT_REGION_SIZE);
+
+    // A context is random, and has no 0x00 or 0xff
+    std::mt19937 vRandom(1);
+    Poke<std::uint64_t>(vFile, Page(6), CONTEXT_REGION_SIZE);
+    for (auto i = sizeof(std::uint64_t); i < PAGE_SIZE; ++i)
+    {
+        vFile[Page(6, i)] = static_cast<std::uint8_t>(1 + vRandom() % 0xfe);
+    }
+
+    // The header starts with the known code and ends with the size of the
+    // body, whose first field is a kernel address
+    auto vContext = std::vector<std::uint64_t>(CONTEXT_HEADER / 8 + CONTEXT_QWORDS);
+    for (auto& vQword : vContext)
+    {
+        vQword = (static_cast<std::uint64_t>(vRandom()) << 32) | vRandom();
+    }
+    memcpy(vContext.data(), KNOWN_CODE, sizeof(KNOWN_CODE));
+    vContext[CONTEXT_HEADER / 8 - 1] = (CONTEXT_QWORDS << 32) | static_cast<std::uint32_t>(vContext[CONTEXT_HEADER / 8 - 1]);
+    vContext[CONTEXT_HEADER / 8] = KERNEL_BASE + 0x2000;
+
+    const auto vEncrypted = EncryptContext(vContext);
+    memcpy(vFile.data() + Page(6, CONTEXT_OFFSET), vEncrypted.data(), vEncrypted.size() * sizeof(std::uint64_t));
+
+    // int 3 all over
+    memset(vFile.data() + Page(7), 0xcc, PAGE_SIZE);
+    Poke<std::uint64_t>(vFile, Page(7), CONTEXT_REGION_SIZE);
+
+    std::ofstream vDump(argv[1], std::ios::binary);
+    vDump.write(reinterpret_cast<const char*>(vFile.data()), static_cast<std::streamsize>(vFile.size()));
+
+    const auto vContextPath = std::string(argv[1]) + ".context";
+    std::ofstream vDecrypted(vContextPath, std::ios::binary);
+    vDecrypted.write(reinterpret_cast<const char*>(vContext.data()), static_cast<std::streamsize>(vContext.size() * sizeof(std::uint64_t)));
+
+    if (!vDump || !vDecrypted)
+    {
+        std::fprintf(stderr, "%s could not be written.\n", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Times the PageTableWalker template against the four nested loops which
+// findpg used before it, on one thread and a synthetic page table.
+//
+//   PageTableWalkerBench [PTE pages] [passes]
+//
+// Both walks report the PTEs of the RWX pages, as findpg does, from the
+// kernel half of the table. The loops read every table into a fresh buffer
+// and test every entry of it, as they did. Returns 1 if the walks do not
+// report the same pages.
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+#include "PageTableWalk.h"
+#include "SyntheticPageTables.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    constexpr std::uint64_t KERNEL_START = 0xffff800000000000;
+
+    struct WalkResult
+    {
+        std::uint64_t LeafTables    = 0;
+        std::uint64_t Leaves        = 0;
+        std::uint64_t Checksum      = 0;
+    };
+
+    struct RwxVisitor : PageTableVisitor
+    {
+        MemorySource&   Memory;
+        WalkResult      Result;
+
+        explicit RwxVisitor(MemorySource& aMemory)
+            : Memory(aMemory)
+        { }
+
+        auto LeafFilter() const
+            -> PteFilter
+        {
+            return PteFilter{ PageTableWalk::PTE_VALID | PageTableWalk::PTE_WRITE, PageTableWalk::PTE_NO_EXECUTE };
+        }
+
+        auto ReadTable(std::uint64_t aTableAddress, std::uint64_t* aEntries)
+            -> bool
+        {
+            return Memory.ReadPhysical(aTableAddress, aEntries, PageTableWalk::TABLE_SIZE);
+        }
+
+        // There is a single worker
+        auto Leaf(std::size_t /*aWorker*/, std::uint64_t aVirtualAddress, std::uint64_t /*aPte*/)
+            -> void
+        {
+            ++Result.Leaves;
+            Result.Checksum ^= aVirtualAddress;
+        }
+    };
+
+    auto WalkWithTemplate(SyntheticPageTables& aImage, WorkStealingPool& aPool)
+        -> WalkResult
+    {
+        RwxVisitor vVisitor(aImage);
+        PageTableWalker<PageTableWalk::PAGING_LEVELS, RwxVisitor> vWalk(aImage.DirectoryTableBase(), vVisitor);
+        vWalk.Run(aPool, KERNEL_START);
+
+        vVisitor.Result.LeafTables = vWalk.LeafTablesVisited();
+        return vVisitor.Result;
+    }
+
+    using Table = std::array<std::uint64_t, PageTableWalk::ENTRIES_PER_TABLE>;
+
+    auto GetPtes(MemorySource& aMemory, std::uint64_t aEntry)
+        -> std::unique_ptr<Table>
+    {
+        auto vTable = std::make_unique<Table>();
+        if (!aMemory.ReadPhysical(aEntry & PageTableWalk::PTE_PFN_MASK, vTable->data(), PageTableWalk::TABLE_SIZE))
+        {
+            throw std::runtime_error("The given Ptes address could not be read.");
+        }
+        return vTable;
+    }
+
+    // PXE -> PPE -> PDE -> PTE, as in FindPatchGuardContextFromIndependentPages
+    auto WalkWithLoops(SyntheticPageTables& aImage)
+        -> WalkResult
+    {
+        WalkResult vResult;
+
+        const auto ENTRIES = PageTableWalk::ENTRIES_PER_TABLE;
+        const auto vStartPxe = (KERNEL_START >> 39) & (ENTRIES - 1);
+        const auto vPxes = GetPtes(aImage, aImage.DirectoryTableBase());
+
+        for (auto vPxeIndex = vStartPxe; vPxeIndex < ENTRIES; ++vPxeIndex)
+        {
+            const auto vPxe = (*vPxes)[vPxeIndex];
+            if (!(vPxe & PageTableWalk::PTE_VALID))
+            {
+                continue;
+            }
+
+            const auto vPpes = GetPtes(aImage, vPxe);
+            for (std::uint64_t vPpeIndex = 0; vPpeIndex < ENTRIES; ++vPpeIndex)
+            {
+                const auto vPpe = (*vPpes)[vPpeIndex];
+                if (!(vPpe & PageTableWalk::PTE_VALID) || (vPpe & PageTableWalk::PTE_LARGE_PAGE))
+                {
+                    continue;
+                }
+
+                const auto vPdes = GetPtes(aImage, vPpe);
+                for (std::uint64_t vPdeIndex = 0; vPdeIndex < ENTRIES; ++vPdeIndex)
+                {
+                    const auto vPde = (*vPdes)[vPdeIndex];
+                    if (!(vPde & PageTableWalk::PTE_VALID) || (vPde & PageTableWalk::PTE_LARGE_PAGE))
+                    {
+                        continue;
+                    }
+
+                    ++vResult.LeafTables;
+
+                    const auto vPtes = GetPtes(aImage, vPde);
+                    for (std::uint64_t vPteIndex = 0; vPteIndex < ENTRIES; ++vPteIndex)
+                    {
+                        const auto vPte = (*vPtes)[vPteIndex];
+                        if (!(vPte & PageTableWalk::PTE_VALID) ||
+                            !(vPte & PageTableWalk::PTE_WRITE) ||
+                            (vPte & PageTableWalk::PTE_NO_EXECUTE))
+                        {
+                            continue;
+                        }
+
+                        const auto vVirtualAddress = 0xffff000000000000 |
+                            (((((vPxeIndex * ENTRIES + vPpeIndex) * ENTRIES + vPdeIndex) * ENTRIES) + vPteIndex) << 12);
+
+                        ++vResult.Leaves;
+                        vResult.Checksum ^= vVirtualAddress;
+                    }
+                }
+            }
+        }
+
+        return vResult;
+    }
+
+    // The best time of aPasses runs of aWalk, and its result
+    template<typename Walk>
+    auto Time(std::uint64_t aPasses, Walk aWalk, WalkResult& aResult)
+        -> double
+    {
+        auto vBest = 0.0;
+        for (std::uint64_t i = 0; i < aPasses; ++i)
+        {
+            const auto vStart = std::chrono::steady_clock::now();
+            aResult = aWalk();
+            const auto vSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - vStart).count();
+
+            vBest = i ? std::min(vBest, vSeconds) : vSeconds;
+        }
+        return vBest;
+    }
+
+}
+
+int main(int argc, char* argv[])
+{
+    const auto vLeafTables = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 0x8000;
+    const auto vPasses     = std::max<std::uint64_t>(argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 10, 1);
+
+    SyntheticPageTables vImage(vLeafTables, 1);
+    WorkStealingPool vPool(1);
+
+    std::printf("%llu PTE pages, %llu PTEs, best of %llu passes\n",
+        static_cast<unsigned long long>(vImage.LeafTables()),
+        static_cast<unsigned long long>(vImage.Leaves()),
+        static_cast<unsigned long long>(vPasses));
+
+    auto vLoops = WalkResult{};
+    auto vTemplate = WalkResult{};
+    const auto vLoopSeconds = Time(vPasses, [&vImage] { return WalkWithLoops(vImage); }, vLoops);
+    const auto vTemplateSeconds = Time(vPasses, [&vImage, &vPool] { return WalkWithTemplate(vImage, vPool); }, vTemplate);
+
+    std::printf("%-16s %10s %14s %10s\n", "walk", "seconds", "tables/s", "RWX PTEs");
+    std::printf("%-16s %10.4f %14.0f %10llu\n", "nested loops", vLoopSeconds,
+        vLoops.LeafTables / vLoopSeconds, static_cast<unsigned long long>(vLoops.Leaves));
+    std::printf("%-16s %10.4f %14.0f %10llu\n", "PageTableWalker", vTemplateSeconds,
+        vTemplate.LeafTables / vTemplateSeconds, static_cast<unsigned long long>(vTemplate.Leaves));
+    std::printf("PageTableWalker is %.2fx the speed of the loops\n", vLoopSeconds / vTemplateSeconds);
+
+    if (vLoops.LeafTables != vImage.LeafTables() ||
+        vTemplate.LeafTables != vLoops.LeafTables ||
+        vTemplate.Leaves != vLoops.Leaves ||
+        vTemplate.Checksum != vLoops.Checksum)
+    {
+        std::fprintf(stderr, "The walks do not report the same pages.\n");
+        return 1;
+    }
+
+    return 0;
+}
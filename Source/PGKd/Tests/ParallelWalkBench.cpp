@@ -0,0 +1,130 @@
+// Times the work-stealing walk of a synthetic page table with a growing
+// number of workers.
+//
+//   ParallelWalkBench [PTE pages] [read latency in microseconds]
+//
+// Without latency, the tables are copied from memory as from a dump file
+// mapped by CrashDump. A latency stands for the round-trip of every read
+// through the debugger engine, which the workers overlap. The first walk has
+// no workers, and runs on the calling thread, as the scans over the debugger
+// engine do. Returns 1 if a walk does not visit every page of the image.
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "PageTableWalk.h"
+#include "SyntheticPageTables.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    // Every worker counts into its own line. The line is padded rather than
+    // aligned, as std::vector does not honour over-alignment before C++17.
+    struct WorkerResult
+    {
+        std::uint64_t Leaves    = 0;
+        std::uint64_t Checksum  = 0;
+        std::uint8_t  Padding[64 - 2 * sizeof(std::uint64_t)] = {};
+    };
+
+    struct CountingVisitor : PageTableVisitor
+    {
+        MemorySource&               Memory;
+        std::vector<WorkerResult>   Results;
+
+        CountingVisitor(MemorySource& aMemory, std::size_t aWorkers)
+            : Memory(aMemory)
+            , Results(aWorkers)
+        { }
+
+        auto ReadTable(std::uint64_t aTableAddress, std::uint64_t* aEntries)
+            -> bool
+        {
+            return Memory.ReadPhysical(aTableAddress, aEntries, PageTableWalk::TABLE_SIZE);
+        }
+
+        auto Leaf(std::size_t aWorker, std::uint64_t aVirtualAddress, std::uint64_t /*aPte*/)
+            -> void
+        {
+            ++Results[aWorker].Leaves;
+            Results[aWorker].Checksum ^= aVirtualAddress;
+        }
+
+        // Merges the results of the workers
+        auto Total() const
+            -> WorkerResult
+        {
+            WorkerResult vTotal;
+            for (const auto& vResult : Results)
+            {
+                vTotal.Leaves   += vResult.Leaves;
+                vTotal.Checksum ^= vResult.Checksum;
+            }
+            return vTotal;
+        }
+    };
+
+}
+
+int main(int argc, char* argv[])
+{
+    const auto vLeafTables = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 0x4000;
+    const auto vLatency    = std::chrono::microseconds(argc > 2 ? std::strtoull(argv[2], nullptr, 0) : 0);
+
+    SyntheticPageTables vImage(vLeafTables, 1);
+    vImage.SetReadLatency(vLatency);
+
+    std::printf("%llu PTE pages, %llu PTEs, %lld us per read\n",
+        static_cast<unsigned long long>(vImage.LeafTables()),
+        static_cast<unsigned long long>(vImage.Leaves()),
+        static_cast<long long>(vLatency.count()));
+    std::printf("%8s %10s %14s %8s\n", "workers", "seconds", "tables/s", "speedup");
+
+    // At least 8 workers, to show how the latency is overlapped on a small machine
+    const auto vMaxWorkers = std::max<std::size_t>(std::thread::hardware_concurrency(), 8);
+
+    auto vFirstResult = WorkerResult{};
+    auto vSerialSeconds = 0.0;
+    for (std::size_t vWorkers = 0; vWorkers <= vMaxWorkers; vWorkers = vWorkers ? vWorkers * 2 : 1)
+    {
+        WorkStealingPool vPool(vWorkers);
+        CountingVisitor vVisitor(vImage, vPool.Size());
+        PageTableWalker<PageTableWalk::PAGING_LEVELS, CountingVisitor> vWalk(vImage.DirectoryTableBase(), vVisitor);
+
+        const auto vStart = std::chrono::steady_clock::now();
+        vWalk.Run(vPool, 0xffff800000000000);
+        const auto vSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - vStart).count();
+
+        const auto vResult = vVisitor.Total();
+        if (vWalk.LeafTablesVisited() != vImage.LeafTables() || vResult.Leaves != vImage.Leaves())
+        {
+            std::fprintf(stderr, "%zu workers visited %llu PTE pages and %llu PTEs.\n", vWorkers,
+                static_cast<unsigned long long>(vWalk.LeafTablesVisited()),
+                static_cast<unsigned long long>(vResult.Leaves));
+            return 1;
+        }
+
+        if (vWorkers == 0)
+        {
+            vFirstResult = vResult;
+            vSerialSeconds = vSeconds;
+        }
+        else if (vResult.Checksum != vFirstResult.Checksum)
+        {
+            std::fprintf(stderr, "%zu workers visited other addresses than the calling thread.\n", vWorkers);
+            return 1;
+        }
+
+        std::printf("%8zu %10.4f %14.0f %7.2fx\n", vWorkers, vSeconds,
+            vImage.LeafTables() / vSeconds, vSerialSeconds / vSeconds);
+    }
+
+    return 0;
+}
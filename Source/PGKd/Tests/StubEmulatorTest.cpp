@@ -0,0 +1,252 @@
+// Runs the code at the head of the contexts of several builds, as it is
+// copied from CmpAppendDllSection, on contexts encrypted with it.
+//
+// Every stub decrypts the header and then the body of its context, loads the
+// offset of the routine of the context (OffsetOfPGSelfValidation, see
+// PGContext.layouts), and hands the context over to it with call rax on
+// Windows 7 and jmp rax since. The emulation has to stop there with
+// STUB_HANDED_OFF, and leave the context decrypted. Returns 1 otherwise.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ContextCipher.h"
+#include "StubEmulator.h"
+
+
+using namespace Sunstrider;
+
+namespace
+{
+
+    // Windows 7 SP1 (7601)
+    const std::uint8_t STUB_WINDOWS7[] =
+    {
+        0x2E, 0x48, 0x31, 0x11,                                 // xor     cs:[rcx], rdx
+        0x48, 0x31, 0x51, 0x08,                                 // xor     [rcx+8], rdx
+        0x48, 0x31, 0x51, 0x10,                                 // xor     [rcx+10h], rdx
+        0x48, 0x31, 0x51, 0x18,                                 // xor     [rcx+18h], rdx
+        0x48, 0x31, 0x51, 0x20,                                 // xor     [rcx+20h], rdx
+        0x48, 0x31, 0x51, 0x28,                                 // xor     [rcx+28h], rdx
+        0x48, 0x31, 0x51, 0x30,                                 // xor     [rcx+30h], rdx
+        0x48, 0x31, 0x51, 0x38,                                 // xor     [rcx+38h], rdx
+        0x48, 0x31, 0x51, 0x40,                                 // xor     [rcx+40h], rdx
+        0x48, 0x31, 0x51, 0x48,                                 // xor     [rcx+48h], rdx
+        0x48, 0x31, 0x51, 0x50,                                 // xor     [rcx+50h], rdx
+        0x48, 0x31, 0x51, 0x58,                                 // xor     [rcx+58h], rdx
+        0x48, 0x31, 0x51, 0x60,                                 // xor     [rcx+60h], rdx
+        0x48, 0x31, 0x51, 0x68,                                 // xor     [rcx+68h], rdx
+        0x48, 0x31, 0x51, 0x70,                                 // xor     [rcx+70h], rdx
+        0x48, 0x31, 0x51, 0x78,                                 // xor     [rcx+78h], rdx
+        0x48, 0x31, 0x91, 0x80, 0x00, 0x00, 0x00,               // xor     [rcx+80h], rdx
+        0x48, 0x31, 0x91, 0x88, 0x00, 0x00, 0x00,               // xor     [rcx+88h], rdx
+        0x48, 0x31, 0x91, 0x90, 0x00, 0x00, 0x00,               // xor     [rcx+90h], rdx
+        0x48, 0x31, 0x91, 0x98, 0x00, 0x00, 0x00,               // xor     [rcx+98h], rdx
+        0x48, 0x31, 0x91, 0xA0, 0x00, 0x00, 0x00,               // xor     [rcx+0A0h], rdx
+        0x48, 0x31, 0x91, 0xA8, 0x00, 0x00, 0x00,               // xor     [rcx+0A8h], rdx
+        0x48, 0x31, 0x91, 0xB0, 0x00, 0x00, 0x00,               // xor     [rcx+0B0h], rdx
+        0x48, 0x31, 0x91, 0xB8, 0x00, 0x00, 0x00,               // xor     [rcx+0B8h], rdx
+        0x48, 0x31, 0x91, 0xC0, 0x00, 0x00, 0x00,               // xor     [rcx+0C0h], rdx
+        0x48, 0x8B, 0xC2,                                       // mov     rax, rdx
+        0x48, 0x8B, 0xD1,                                       // mov     rdx, rcx
+        0x8B, 0x8A, 0xC4, 0x00, 0x00, 0x00,                     // mov     ecx, [rdx+0C4h]
+        0x48, 0x31, 0x84, 0xCA, 0xC0, 0x00, 0x00, 0x00,         // xor     [rdx+rcx*8+0C0h], rax
+        0x48, 0xD3, 0xC8,                                       // ror     rax, cl
+        0xE2, 0xF3,                                             // loop    $-0Bh
+        0x8B, 0x82, 0x88, 0x02, 0x00, 0x00,                     // mov     eax, [rdx+288h]
+        0x48, 0x03, 0xC2,                                       // add     rax, rdx
+        0xFF, 0xD0,                                             // call    rax
+    };
+
+    // Windows 10 1507 (10240)
+    const std::uint8_t STUB_WINDOWS10_1507[] =
+    {
+        0x2E, 0x48, 0x31, 0x11,                                 // xor     cs:[rcx], rdx
+        0x48, 0x31, 0x51, 0x08,                                 // xor     [rcx+8], rdx
+        0x48, 0x31, 0x51, 0x10,                                 // xor     [rcx+10h], rdx
+        0x48, 0x31, 0x51, 0x18,                                 // xor     [rcx+18h], rdx
+        0x48, 0x31, 0x51, 0x20,                                 // xor     [rcx+20h], rdx
+        0x48, 0x31, 0x51, 0x28,                                 // xor     [rcx+28h], rdx
+        0x48, 0x31, 0x51, 0x30,                                 // xor     [rcx+30h], rdx
+        0x48, 0x31, 0x51, 0x38,                                 // xor     [rcx+38h], rdx
+        0x48, 0x31, 0x51, 0x40,                                 // xor     [rcx+40h], rdx
+        0x48, 0x31, 0x51, 0x48,                                 // xor     [rcx+48h], rdx
+        0x48, 0x31, 0x51, 0x50,                                 // xor     [rcx+50h], rdx
+        0x48, 0x31, 0x51, 0x58,                                 // xor     [rcx+58h], rdx
+        0x48, 0x31, 0x51, 0x60,                                 // xor     [rcx+60h], rdx
+        0x48, 0x31, 0x51, 0x68,                                 // xor     [rcx+68h], rdx
+        0x48, 0x31, 0x51, 0x70,                                 // xor     [rcx+70h], rdx
+        0x48, 0x31, 0x51, 0x78,                                 // xor     [rcx+78h], rdx
+        0x48, 0x31, 0x91, 0x80, 0x00, 0x00, 0x00,               // xor     [rcx+80h], rdx
+        0x48, 0x31, 0x91, 0x88, 0x00, 0x00, 0x00,               // xor     [rcx+88h], rdx
+        0x48, 0x31, 0x91, 0x90, 0x00, 0x00, 0x00,               // xor     [rcx+90h], rdx
+        0x48, 0x31, 0x91, 0x98, 0x00, 0x00, 0x00,               // xor     [rcx+98h], rdx
+        0x48, 0x31, 0x91, 0xA0, 0x00, 0x00, 0x00,               // xor     [rcx+0A0h], rdx
+        0x48, 0x31, 0x91, 0xA8, 0x00, 0x00, 0x00,               // xor     [rcx+0A8h], rdx
+        0x48, 0x31, 0x91, 0xB0, 0x00, 0x00, 0x00,               // xor     [rcx+0B0h], rdx
+        0x48, 0x31, 0x91, 0xB8, 0x00, 0x00, 0x00,               // xor     [rcx+0B8h], rdx
+        0x48, 0x31, 0x91, 0xC0, 0x00, 0x00, 0x00,               // xor     [rcx+0C0h], rdx
+        0x48, 0x8B, 0xC2,                                       // mov     rax, rdx
+        0x48, 0x8B, 0xD1,                                       // mov     rdx, rcx
+        0x8B, 0x8A, 0xC4, 0x00, 0x00, 0x00,                     // mov     ecx, [rdx+0C4h]
+        0x48, 0x31, 0x84, 0xCA, 0xC0, 0x00, 0x00, 0x00,         // xor     [rdx+rcx*8+0C0h], rax
+        0x48, 0xD3, 0xC8,                                       // ror     rax, cl
+        0xE2, 0xF3,                                             // loop    $-0Bh
+        0x8B, 0x82, 0x50, 0x05, 0x00, 0x00,                     // mov     eax, [rdx+550h]
+        0x48, 0x03, 0xC2,                                       // add     rax, rdx
+        0xFF, 0xE0,                                             // jmp     rax
+    };
+
+    // Windows 10 1803 (17134)
+    const std::uint8_t STUB_WINDOWS10_1803[] =
+    {
+        0x2E, 0x48, 0x31, 0x11,                                 // xor     cs:[rcx], rdx
+        0x48, 0x31, 0x51, 0x08,                                 // xor     [rcx+8], rdx
+        0x48, 0x31, 0x51, 0x10,                                 // xor     [rcx+10h], rdx
+        0x48, 0x31, 0x51, 0x18,                                 // xor     [rcx+18h], rdx
+        0x48, 0x31, 0x51, 0x20,                                 // xor     [rcx+20h], rdx
+        0x48, 0x31, 0x51, 0x28,                                 // xor     [rcx+28h], rdx
+        0x48, 0x31, 0x51, 0x30,                                 // xor     [rcx+30h], rdx
+        0x48, 0x31, 0x51, 0x38,                                 // xor     [rcx+38h], rdx
+        0x48, 0x31, 0x51, 0x40,                                 // xor     [rcx+40h], rdx
+        0x48, 0x31, 0x51, 0x48,                                 // xor     [rcx+48h], rdx
+        0x48, 0x31, 0x51, 0x50,                                 // xor     [rcx+50h], rdx
+        0x48, 0x31, 0x51, 0x58,                                 // xor     [rcx+58h], rdx
+        0x48, 0x31, 0x51, 0x60,                                 // xor     [rcx+60h], rdx
+        0x48, 0x31, 0x51, 0x68,                                 // xor     [rcx+68h], rdx
+        0x48, 0x31, 0x51, 0x70,                                 // xor     [rcx+70h], rdx
+        0x48, 0x31, 0x51, 0x78,                                 // xor     [rcx+78h], rdx
+        0x48, 0x31, 0x91, 0x80, 0x00, 0x00, 0x00,               // xor     [rcx+80h], rdx
+        0x48, 0x31, 0x91, 0x88, 0x00, 0x00, 0x00,               // xor     [rcx+88h], rdx
+        0x48, 0x31, 0x91, 0x90, 0x00, 0x00, 0x00,               // xor     [rcx+90h], rdx
+        0x48, 0x31, 0x91, 0x98, 0x00, 0x00, 0x00,               // xor     [rcx+98h], rdx
+        0x48, 0x31, 0x91, 0xA0, 0x00, 0x00, 0x00,               // xor     [rcx+0A0h], rdx
+        0x48, 0x31, 0x91, 0xA8, 0x00, 0x00, 0x00,               // xor     [rcx+0A8h], rdx
+        0x48, 0x31, 0x91, 0xB0, 0x00, 0x00, 0x00,               // xor     [rcx+0B0h], rdx
+        0x48, 0x31, 0x91, 0xB8, 0x00, 0x00, 0x00,               // xor     [rcx+0B8h], rdx
+        0x48, 0x31, 0x91, 0xC0, 0x00, 0x00, 0x00,               // xor     [rcx+0C0h], rdx
+        0x48, 0x8B, 0xC2,                                       // mov     rax, rdx
+        0x48, 0x8B, 0xD1,                                       // mov     rdx, rcx
+        0x8B, 0x8A, 0xC4, 0x00, 0x00, 0x00,                     // mov     ecx, [rdx+0C4h]
+        0x48, 0x31, 0x84, 0xCA, 0xC0, 0x00, 0x00, 0x00,         // xor     [rdx+rcx*8+0C0h], rax
+        0x48, 0xD3, 0xC8,                                       // ror     rax, cl
+        0xE2, 0xF3,                                             // loop    $-0Bh
+        0x8B, 0x82, 0x88, 0x06, 0x00, 0x00,                     // mov     eax, [rdx+688h]
+        0x48, 0x03, 0xC2,                                       // add     rax, rdx
+        0xFF, 0xE0,                                             // jmp     rax
+    };
+
+    struct RecordedStub
+    {
+        const char*         Name;
+        const std::uint8_t* Code;
+        std::size_t         CodeSize;
+        std::uint32_t       ContextBytes;       // The size of its layout
+        std::uint32_t       RoutineField;       // OffsetOfPGSelfValidation
+    };
+
+    const RecordedStub STUBS[] =
+    {
+        { "Windows7",       STUB_WINDOWS7,       sizeof(STUB_WINDOWS7),       0x340, 0x288 },
+        { "Windows10_1507", STUB_WINDOWS10_1507, sizeof(STUB_WINDOWS10_1507), 0x750, 0x550 },
+        { "Windows10_1803", STUB_WINDOWS10_1803, sizeof(STUB_WINDOWS10_1803), 0x930, 0x688 },
+    };
+
+    // The qwords of the body of every context: its code and its data follow
+    // the structure
+    constexpr std::uint32_t BODY_QWORDS = 0x2000;
+
+    // Builds a context around aStub, encrypts it with aKey, and runs the stub
+    // on the encrypted one, either whole or through a view of its layout
+    auto Replay(StubEmulator& aEmulator, const RecordedStub& aStub, std::uint64_t aKey, bool aView, std::mt19937_64& aRandom)
+        -> bool
+    {
+        const auto vKey = ContextKey{ 0, aKey, BODY_QWORDS };
+        const auto vContextBytes = static_cast<std::size_t>(GetContextBytes(vKey));
+
+        // The stub, padded with int 3 up to ContextSizeInQWord
+        auto vPlain = std::vector<std::uint8_t>(vContextBytes);
+        for (std::size_t i = 0; i < vContextBytes; i += sizeof(std::uint64_t))
+        {
+            const auto vQword = aRandom();
+            memcpy(vPlain.data() + i, &vQword, sizeof(vQword));
+        }
+        memset(vPlain.data(), 0xCC, StubEmulator::MAXIMUM_CODE_BYTES);
+        memcpy(vPlain.data(), aStub.Code, aStub.CodeSize);
+        memcpy(vPlain.data() + StubEmulator::MAXIMUM_CODE_BYTES, &BODY_QWORDS, sizeof(BODY_QWORDS));
+
+        // The routine is somewhere in the code which follows the structure
+        const std::uint32_t vRoutine = aStub.ContextBytes + 0x1000;
+        memcpy(vPlain.data() + aStub.RoutineField, &vRoutine, sizeof(vRoutine));
+
+        auto vImage = std::vector<std::uint8_t>(vContextBytes);
+        DecryptContextScalar(vPlain.data(), vImage.data(), vKey, 0, vContextBytes / sizeof(std::uint64_t));
+
+        // The code is fetched from the header decrypted with the key, as
+        // DumpPatchGuardImpl does
+        std::uint8_t vCode[CONTEXT_HEADER_BYTES];
+        DecryptContextScalar(vImage.data(), vCode, vKey, 0, sizeof(vCode) / sizeof(std::uint64_t));
+
+        const auto vImageSize = aView ? aStub.ContextBytes : vContextBytes;
+        const auto vStatus = aEmulator.Run(
+            vCode,
+            StubEmulator::MAXIMUM_CODE_BYTES,
+            aKey,
+            vImage.data(),
+            vImageSize,
+            vContextBytes,
+            StubEmulator::INSTRUCTIONS_PER_QWORD * (vContextBytes / sizeof(std::uint64_t)));
+
+        const auto vName = aView ? " (view)" : "";
+        if (vStatus != StubEmulator::STUB_HANDED_OFF || aEmulator.StopOffset() != aStub.CodeSize - 2)
+        {
+            std::fprintf(stderr, "%s%s: %s at +0x%llx.\n", aStub.Name, vName, StubEmulator::GetStatusName(vStatus),
+                static_cast<unsigned long long>(aEmulator.StopOffset()));
+            return false;
+        }
+
+        // The loop runs three instructions per qword of the body
+        if (aEmulator.Executed() < 3ull * BODY_QWORDS)
+        {
+            std::fprintf(stderr, "%s%s: only %llu instructions ran.\n", aStub.Name, vName,
+                static_cast<unsigned long long>(aEmulator.Executed()));
+            return false;
+        }
+
+        if (memcmp(vImage.data(), vPlain.data(), vImageSize))
+        {
+            std::fprintf(stderr, "%s%s: the context is not decrypted.\n", aStub.Name, vName);
+            return false;
+        }
+
+        return true;
+    }
+
+}
+
+int main()
+{
+    std::mt19937_64 vRandom(1);
+    StubEmulator vEmulator;
+
+    auto vFailed = false;
+    for (const auto& vStub : STUBS)
+    {
+        for (auto i = 0; i < 4; ++i)
+        {
+            const auto vKey = vRandom();
+            vFailed |= !Replay(vEmulator, vStub, vKey, false, vRandom);
+            vFailed |= !Replay(vEmulator, vStub, vKey, true, vRandom);
+        }
+    }
+
+    if (vFailed)
+    {
+        return 1;
+    }
+
+    std::printf("%zu stubs handed their contexts off decrypted.\n", sizeof(STUBS) / sizeof(STUBS[0]));
+    return 0;
+}
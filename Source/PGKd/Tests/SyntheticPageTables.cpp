@@ -0,0 +1,176 @@
+#include "SyntheticPageTables.h"
+
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include "PageTableWalk.h"
+
+
+namespace Sunstrider
+{
+
+    namespace
+    {
+        // The kernel PXE entries which are populated, the first ones the most
+        constexpr std::uint64_t KERNEL_PXE_START = 0x100;
+        constexpr std::uint64_t KERNEL_PXE_SLOTS = 16;
+        constexpr std::uint64_t KERNEL_PXE_STRIDE = 0x10;
+
+        // The PPE entries which are populated under each PXE entry
+        constexpr std::uint64_t PPE_SLOTS = 64;
+
+        // The frames mapped by the PTEs and the large pages, past the tables
+        constexpr std::uint64_t FIRST_DATA_FRAME = 1ull << 24;
+
+        constexpr std::uint64_t TABLE_ENTRIES = PageTableWalk::ENTRIES_PER_TABLE;
+
+        constexpr std::uint64_t PTE_NEXT_TABLE = PageTableWalk::PTE_VALID | PageTableWalk::PTE_WRITE;
+    }
+
+    auto SyntheticPageTables::AllocateTable()
+        -> std::uint64_t
+    {
+        const auto vFrame = _Tables.size() / TABLE_ENTRIES;
+        _Tables.resize(_Tables.size() + TABLE_ENTRIES, 0);
+        return vFrame;
+    }
+
+    // The pointer is valid until the next table is allocated
+    auto SyntheticPageTables::GetTable(std::uint64_t aFrame)
+        -> std::uint64_t*
+    {
+        return _Tables.data() + aFrame * TABLE_ENTRIES;
+    }
+
+    SyntheticPageTables::SyntheticPageTables(std::uint64_t aLeafTables, std::uint32_t aSeed)
+    {
+        if (aLeafTables > KERNEL_PXE_SLOTS * PPE_SLOTS * TABLE_ENTRIES / 2)
+        {
+            throw std::invalid_argument("Too many PTE pages for the synthetic page table.");
+        }
+
+        std::mt19937 vRandom(aSeed);
+        std::geometric_distribution<std::uint64_t> vPxeSlot(0.3);
+        std::uniform_int_distribution<std::uint64_t> vPpeSlot(0, PPE_SLOTS - 1);
+        std::uniform_int_distribution<std::uint64_t> vEntry(0, TABLE_ENTRIES - 1);
+        std::uniform_int_distribution<std::uint32_t> vByte(0, 0xff);
+
+        // Returns the frame of the table under the entry aIndex of aFrame,
+        // which is created if needed
+        const auto vGetNextTable = [this](std::uint64_t aFrame, std::uint64_t aIndex)
+        {
+            if (!(GetTable(aFrame)[aIndex] & PageTableWalk::PTE_VALID))
+            {
+                const auto vTable = AllocateTable();
+                GetTable(aFrame)[aIndex] = (vTable << 12) | PTE_NEXT_TABLE;
+            }
+            return (GetTable(aFrame)[aIndex] & PageTableWalk::PTE_PFN_MASK) >> 12;
+        };
+
+        const auto vRoot = AllocateTable();
+        auto vDataFrame = FIRST_DATA_FRAME;
+
+        while (_LeafTables < aLeafTables)
+        {
+            const auto vPxeIndex = KERNEL_PXE_START + std::min(vPxeSlot(vRandom), KERNEL_PXE_SLOTS - 1) * KERNEL_PXE_STRIDE;
+            const auto vPpeTable = vGetNextTable(vRoot, vPxeIndex);
+            const auto vPdeTable = vGetNextTable(vPpeTable, vPpeSlot(vRandom));
+
+            const auto vPdeIndex = vEntry(vRandom);
+            if (GetTable(vPdeTable)[vPdeIndex] & PageTableWalk::PTE_VALID)
+            {
+                continue;
+            }
+
+            // One entry out of eight maps a 2MB page
+            if (vByte(vRandom) < 0x20)
+            {
+                GetTable(vPdeTable)[vPdeIndex] = (vDataFrame << 12) | PTE_NEXT_TABLE | PageTableWalk::PTE_LARGE_PAGE;
+                vDataFrame += TABLE_ENTRIES;
+                ++_LargePages;
+                continue;
+            }
+
+            const auto vPteTable = vGetNextTable(vPdeTable, vPdeIndex);
+            ++_LeafTables;
+
+            // Empty, sparse, half full or full
+            const std::uint32_t DENSITIES[] = { 0, 0x10, 0x80, 0x100 };
+            const auto vDensity = DENSITIES[vByte(vRandom) % 4];
+
+            const auto vPtes = GetTable(vPteTable);
+            for (std::uint64_t i = 0; i < TABLE_ENTRIES; ++i)
+            {
+                if (vByte(vRandom) >= vDensity)
+                {
+                    continue;
+                }
+
+                const auto vBits = vByte(vRandom);
+                vPtes[i] = (vDataFrame++ << 12) | PageTableWalk::PTE_VALID |
+                    ((vBits & 1) ? PageTableWalk::PTE_WRITE : 0) |
+                    ((vBits & 6) ? PageTableWalk::PTE_NO_EXECUTE : 0);
+                ++_Leaves;
+            }
+        }
+    }
+
+    auto SyntheticPageTables::DirectoryTableBase() const
+        -> std::uint64_t
+    {
+        return 0;
+    }
+
+    auto SyntheticPageTables::LeafTables() const
+        -> std::uint64_t
+    {
+        return _LeafTables;
+    }
+
+    auto SyntheticPageTables::Leaves() const
+        -> std::uint64_t
+    {
+        return _Leaves;
+    }
+
+    auto SyntheticPageTables::LargePages() const
+        -> std::uint64_t
+    {
+        return _LargePages;
+    }
+
+    auto SyntheticPageTables::SetReadLatency(std::chrono::microseconds aLatency)
+        -> void
+    {
+        _ReadLatency = aLatency;
+    }
+
+    // Only the tables are backed by memory, and they are not mapped
+    auto SyntheticPageTables::ReadVirtual(std::uint64_t /*aAddress*/, void* /*aBuffer*/, std::uint32_t /*aBytes*/)
+        -> bool
+    {
+        return false;
+    }
+
+    auto SyntheticPageTables::ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+        -> bool
+    {
+        if (_ReadLatency.count())
+        {
+            std::this_thread::sleep_for(_ReadLatency);
+        }
+
+        const auto vImageSize = _Tables.size() * sizeof(std::uint64_t);
+        if (aAddress > vImageSize || aBytes > vImageSize - aAddress)
+        {
+            return false;
+        }
+
+        memcpy(aBuffer, reinterpret_cast<const std::uint8_t*>(_Tables.data()) + aAddress, aBytes);
+        return true;
+    }
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+
+#include "MemorySource.h"
+
+
+namespace Sunstrider
+{
+
+    // The physical memory of a made-up system which holds nothing but a
+    // 4-level page table, for the tests and benchmarks of the walks.
+    //
+    // The tables are laid out from frame 0 (the root) in the order they are
+    // created. The kernel half is populated unevenly, as on a real system: a
+    // few PXE entries hold most of the PTE pages, the PTE pages are more or
+    // less full, and some PDE entries map large pages. The PTEs point to
+    // frames past the tables, which cannot be read.
+    class SyntheticPageTables : public MemorySource
+    {
+        std::vector<std::uint64_t>  _Tables;        // 512 entries per frame
+        std::uint64_t               _LeafTables = 0;
+        std::uint64_t               _Leaves     = 0;
+        std::uint64_t               _LargePages = 0;
+        std::chrono::microseconds   _ReadLatency { 0 };
+
+        auto AllocateTable()
+            -> std::uint64_t;
+
+        auto GetTable(std::uint64_t aFrame)
+            -> std::uint64_t*;
+
+    public:
+        // Builds aLeafTables PTE pages with the random generator seeded by aSeed
+        SyntheticPageTables(std::uint64_t aLeafTables, std::uint32_t aSeed);
+
+        // The physical address of the root, as in CR3
+        auto DirectoryTableBase() const
+            -> std::uint64_t;
+
+        // The number of PTE pages
+        auto LeafTables() const
+            -> std::uint64_t;
+
+        // The number of valid PTEs of the PTE pages
+        auto Leaves() const
+            -> std::uint64_t;
+
+        // The number of valid large pages of the PDE pages
+        auto LargePages() const
+            -> std::uint64_t;
+
+        // Every physical read waits for aLatency first, as a read through the
+        // debugger engine would
+        auto SetReadLatency(std::chrono::microseconds aLatency)
+            -> void;
+
+        auto ReadVirtual(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+
+        auto ReadPhysical(std::uint64_t aAddress, void* aBuffer, std::uint32_t aBytes)
+            -> bool override;
+    };
+
+}
@@ -28,16 +28,56 @@ namespace wdk
     constexpr auto PPI_SHIFT = 30;
     constexpr auto PXI_SHIFT = 39;
 
-    __declspec(selectany) auto PTE_BASE = 0xFFFFF68000000000UI64;
-    __declspec(selectany) auto PDE_BASE = ((PTE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE; //0xFFFFF6FB40000000UI64;
-    __declspec(selectany) auto PPE_BASE = ((PDE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE; //0xFFFFF6FB7DA00000UI64;
-    __declspec(selectany) auto PXE_BASE = ((PPE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE; //0xFFFFF6FB7DBED000UI64;
-    __declspec(selectany) auto PXE_SELFMAP = ((PXE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE; //0xFFFFF6FB7DBEDF68UI64;
+    // The default PTE_BASE. It is randomized since Windows 10 1607.
+    constexpr auto DEFAULT_PTE_BASE = 0xFFFFF68000000000UI64;
 
-    __declspec(selectany) auto PXE_TOP = PXE_BASE + PXE_SIZE - 1;
-    __declspec(selectany) auto PPE_TOP = PPE_BASE + PPE_SIZE - 1;
-    __declspec(selectany) auto PDE_TOP = PDE_BASE + PDE_SIZE - 1;
-    __declspec(selectany) auto PTE_TOP = PTE_BASE + PTE_SIZE - 1;
+    // Returns the address of the PTE which maps aAddress in the self-map at
+    // aPteBase. Applied to the base of a level, gives the base of the next one.
+    constexpr auto MiGetSelfMapEntry(UINT64 aPteBase, UINT64 aAddress)
+        -> UINT64
+    {
+        return ((aAddress & 0x0000FFFFFFFFF000) >> 12) * 8 + aPteBase;
+    }
+
+    // The version and the page-table self-map of one target.
+    //
+    // It is computed once per target and never changes, so any number of
+    // targets can be analyzed in the same process, and a single one can be
+    // shared by the threads analyzing it.
+    class AddressSpace
+    {
+        SystemVersion   _Version;
+        UINT64          _PteBase;
+        UINT64          _PdeBase;
+        UINT64          _PpeBase;
+        UINT64          _PxeBase;
+        UINT64          _PxeSelfMap;
+
+    public:
+        constexpr AddressSpace(SystemVersion aVersion, UINT64 aPteBase)
+            : _Version(aVersion)
+            , _PteBase(aPteBase)
+            , _PdeBase(MiGetSelfMapEntry(aPteBase, _PteBase))      //0xFFFFF6FB40000000UI64;
+            , _PpeBase(MiGetSelfMapEntry(aPteBase, _PdeBase))      //0xFFFFF6FB7DA00000UI64;
+            , _PxeBase(MiGetSelfMapEntry(aPteBase, _PpeBase))      //0xFFFFF6FB7DBED000UI64;
+            , _PxeSelfMap(MiGetSelfMapEntry(aPteBase, _PxeBase))   //0xFFFFF6FB7DBEDF68UI64;
+        { }
+
+        constexpr auto Version() const -> SystemVersion { return _Version; }
+
+        constexpr auto PteBase() const -> UINT64 { return _PteBase; }
+        constexpr auto PdeBase() const -> UINT64 { return _PdeBase; }
+        constexpr auto PpeBase() const -> UINT64 { return _PpeBase; }
+        constexpr auto PxeBase() const -> UINT64 { return _PxeBase; }
+        constexpr auto PxeSelfMap() const -> UINT64 { return _PxeSelfMap; }
+
+        constexpr auto PxeTop() const -> UINT64 { return _PxeBase + PXE_SIZE - 1; }
+        constexpr auto PpeTop() const -> UINT64 { return _PpeBase + PPE_SIZE - 1; }
+        constexpr auto PdeTop() const -> UINT64 { return _PdeBase + PDE_SIZE - 1; }
+        constexpr auto PteTop() const -> UINT64 { return _PteBase + PTE_SIZE - 1; }
+    };
+    static_assert(AddressSpace(SystemVersion::Windows7, DEFAULT_PTE_BASE).PxeSelfMap() == 0xFFFFF6FB7DBEDF68UI64,
+        "The self-map of the default PTE_BASE is wrong.");
 
 }
 
@@ -67,21 +107,6 @@ namespace wdk
     } HARDWARE_PTE, *PHARDWARE_PTE;
     static_assert(sizeof(HARDWARE_PTE) == 8, "sizeof(HARDWARE_PTE) != 8");
 
-    inline auto MiInitPte(UINT64 aPteBase)
-        -> void
-    {
-        PTE_BASE = aPteBase;
-        PDE_BASE = ((PTE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE;
-        PPE_BASE = ((PDE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE;
-        PXE_BASE = ((PPE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE;
-        PXE_SELFMAP = ((PXE_BASE & 0x0000FFFFFFFFF000) >> 12) * 8 + PTE_BASE;
-
-        PXE_TOP = PXE_BASE + PXE_SIZE - 1;
-        PPE_TOP = PPE_BASE + PPE_SIZE - 1;
-        PDE_TOP = PDE_BASE + PDE_SIZE - 1;
-        PTE_TOP = PTE_BASE + PTE_SIZE - 1;
-    }
-
     inline auto MiPxeToAddress(__in PHARDWARE_PTE aPointerPxe)
         -> void*
     {
@@ -114,39 +139,39 @@ namespace wdk
     }
 
 
-    inline auto MiAddressToPxe(__in void* aAddress)
+    inline auto MiAddressToPxe(__in const AddressSpace& aAddressSpace, __in void* aAddress)
         -> PHARDWARE_PTE
     {
         auto Offset = reinterpret_cast<ULONG64>(aAddress) >> (PXI_SHIFT - 3);
         Offset &= (0x1FF << 3);
-        return reinterpret_cast<PHARDWARE_PTE>(PXE_BASE + Offset);
+        return reinterpret_cast<PHARDWARE_PTE>(aAddressSpace.PxeBase() + Offset);
     }
 
 
-    inline auto MiAddressToPpe(__in void* aAddress)
+    inline auto MiAddressToPpe(__in const AddressSpace& aAddressSpace, __in void* aAddress)
         -> PHARDWARE_PTE
     {
         auto Offset = reinterpret_cast<ULONG64>(aAddress) >> (PPI_SHIFT - 3);
         Offset &= (0x3FFFF << 3);
-        return reinterpret_cast<PHARDWARE_PTE>(PPE_BASE + Offset);
+        return reinterpret_cast<PHARDWARE_PTE>(aAddressSpace.PpeBase() + Offset);
     }
 
 
-    inline auto MiAddressToPde(__in void* aAddress) 
+    inline auto MiAddressToPde(__in const AddressSpace& aAddressSpace, __in void* aAddress)
         -> PHARDWARE_PTE
     {
         auto Offset = reinterpret_cast<ULONG64>(aAddress) >> (PDI_SHIFT - 3);
         Offset &= (0x7FFFFFF << 3);
-        return reinterpret_cast<PHARDWARE_PTE>(PDE_BASE + Offset);
+        return reinterpret_cast<PHARDWARE_PTE>(aAddressSpace.PdeBase() + Offset);
     }
 
 
-    inline auto MiAddressToPte(__in void* aAddress)
+    inline auto MiAddressToPte(__in const AddressSpace& aAddressSpace, __in void* aAddress)
         -> PHARDWARE_PTE
     {
         auto Offset = reinterpret_cast<ULONG64>(aAddress) >> (PTI_SHIFT - 3);
         Offset &= (0xFFFFFFFFFULL << 3);
-        return reinterpret_cast<PHARDWARE_PTE>(PTE_BASE + Offset);
+        return reinterpret_cast<PHARDWARE_PTE>(aAddressSpace.PteBase() + Offset);
     }
     
 }
@@ -30,7 +30,7 @@ namespace wdk
         Windows10_1703,             // 10.0.15063
         Windows10_1709,             // 10.0.16299
         Windows10_1803,             // 10.0.17134
-        Windows10_1809,             // 10.0.?????
+        Windows10_1809,             // 10.0.17763
         WindowsMax,
     };
 
@@ -0,0 +1,296 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+#include "scope_guard.h"
+
+
+namespace Sunstrider
+{
+
+    auto WorkStealingPool::WorkerQueue::PushBack(Task&& aTask)
+        -> void
+    {
+        if (Count == Ring.size())
+        {
+            // Unroll the ring into a twice larger one
+            std::vector<Task> vRing(Ring.empty() ? INITIAL_QUEUE_CAPACITY : Ring.size() * 2);
+            for (std::size_t i = 0; i < Count; ++i)
+            {
+                vRing[i] = std::move(Ring[(Head + i) & (Ring.size() - 1)]);
+            }
+            Ring = std::move(vRing);
+            Head = 0;
+        }
+
+        Ring[(Head + Count) & (Ring.size() - 1)] = std::move(aTask);
+        ++Count;
+    }
+
+    auto WorkStealingPool::WorkerQueue::PopBack(Task& aTask)
+        -> bool
+    {
+        if (!Count)
+        {
+            return false;
+        }
+
+        --Count;
+        auto& vSlot = Ring[(Head + Count) & (Ring.size() - 1)];
+        aTask = std::move(vSlot);
+        vSlot = nullptr;
+        return true;
+    }
+
+    auto WorkStealingPool::WorkerQueue::PopFront(Task& aTask)
+        -> bool
+    {
+        if (!Count)
+        {
+            return false;
+        }
+
+        auto& vSlot = Ring[Head];
+        aTask = std::move(vSlot);
+        vSlot = nullptr;
+        Head = (Head + 1) & (Ring.size() - 1);
+        --Count;
+        return true;
+    }
+
+    WorkStealingPool::WorkStealingPool(std::size_t aWorkers)
+    {
+        // Without threads, the tasks are queued for the caller of Wait()
+        const auto vQueues = std::max<std::size_t>(aWorkers, 1);
+
+        for (std::size_t i = 0; i < vQueues; ++i)
+        {
+            _Queues.emplace_back(std::make_unique<WorkerQueue>());
+            _Queues.back()->Ring.resize(INITIAL_QUEUE_CAPACITY);
+        }
+        for (std::size_t i = 0; i < aWorkers; ++i)
+        {
+            _Threads.emplace_back(&WorkStealingPool::WorkerMain, this, i);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> vLock(_Lock);
+            _Stop = true;
+        }
+        _Wakeup.notify_all();
+
+        for (auto& vThread : _Threads)
+        {
+            vThread.join();
+        }
+    }
+
+    auto WorkStealingPool::Size() const
+        -> std::size_t
+    {
+        return _Queues.size();
+    }
+
+    auto WorkStealingPool::Push(std::size_t aQueue, Task aTask)
+        -> void
+    {
+        ++_Pending;
+        ++_Queued;
+        {
+            auto& vQueue = *_Queues[aQueue];
+            std::lock_guard<std::mutex> vLock(vQueue.Lock);
+            vQueue.PushBack(std::move(aTask));
+        }
+
+        // Taking the lock makes sure that a worker which is about to sleep
+        // does not miss this notification
+        std::lock_guard<std::mutex> vLock(_Lock);
+        _Wakeup.notify_one();
+    }
+
+    auto WorkStealingPool::Submit(Task aTask)
+        -> void
+    {
+        Push(_NextQueue++ % _Queues.size(), std::move(aTask));
+    }
+
+    auto WorkStealingPool::Spawn(std::size_t aWorker, Task aTask)
+        -> void
+    {
+        Push(aWorker, std::move(aTask));
+    }
+
+    auto WorkStealingPool::Pop(std::size_t aWorker, Task& aTask)
+        -> bool
+    {
+        auto& vQueue = *_Queues[aWorker];
+        std::lock_guard<std::mutex> vLock(vQueue.Lock);
+        if (!vQueue.PopBack(aTask))
+        {
+            return false;
+        }
+
+        --_Queued;
+        return true;
+    }
+
+    auto WorkStealingPool::Steal(std::size_t aWorker, Task& aTask)
+        -> bool
+    {
+        const auto vCount = _Queues.size();
+        for (std::size_t i = 1; i < vCount; ++i)
+        {
+            auto& vQueue = *_Queues[(aWorker + i) % vCount];
+            std::lock_guard<std::mutex> vLock(vQueue.Lock);
+            if (!vQueue.PopFront(aTask))
+            {
+                continue;
+            }
+
+            --_Queued;
+            return true;
+        }
+
+        return false;
+    }
+
+    auto WorkStealingPool::Execute(std::size_t aWorker, Task& aTask)
+        -> void
+    {
+        try
+        {
+            if (!_Cancelled.load(std::memory_order_relaxed))
+            {
+                aTask(aWorker);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> vLock(_Lock);
+            if (!_Error)
+            {
+                _Error = std::current_exception();
+            }
+
+            // The rest of the work is thrown away by Wait() anyway
+            _Cancelled = true;
+        }
+        aTask = nullptr;
+
+        if (--_Pending == 0)
+        {
+            std::lock_guard<std::mutex> vLock(_Lock);
+            _Idle.notify_all();
+        }
+    }
+
+    auto WorkStealingPool::WorkerMain(std::size_t aWorker)
+        -> void
+    {
+        Task vTask;
+
+        for (;;)
+        {
+            if (Pop(aWorker, vTask) || Steal(aWorker, vTask))
+            {
+                Execute(aWorker, vTask);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> vLock(_Lock);
+            _Wakeup.wait(vLock, [this]() { return _Stop || _Queued != 0; });
+            if (_Stop)
+            {
+                break;
+            }
+        }
+    }
+
+    auto WorkStealingPool::Cancel()
+        -> void
+    {
+        _Cancelled = true;
+    }
+
+    auto WorkStealingPool::IsCancelled() const
+        -> bool
+    {
+        return _Cancelled.load(std::memory_order_relaxed);
+    }
+
+    auto WorkStealingPool::RunOnCaller(const std::function<void()>& aPoll, std::chrono::milliseconds aInterval)
+        -> void
+    {
+        _Poll         = aPoll ? &aPoll : nullptr;
+        _PollInterval = aInterval;
+        _LastPoll     = std::chrono::steady_clock::now();
+
+        // The tasks spawned by a task go to the same queue, and run next
+        const auto vClearPoll = std::experimental::scope_guard(this, [](WorkStealingPool* aPool)
+        {
+            aPool->_Poll = nullptr;
+        });
+
+        Task vTask;
+        while (Pop(0, vTask))
+        {
+            Execute(0, vTask);
+            Poll();
+        }
+    }
+
+    auto WorkStealingPool::Wait(
+        const std::function<void()>& aPoll,
+        std::chrono::milliseconds aInterval)
+        -> void
+    {
+        if (_Threads.empty())
+        {
+            RunOnCaller(aPoll, aInterval);
+        }
+
+        std::unique_lock<std::mutex> vLock(_Lock);
+        while (_Pending != 0)
+        {
+            _Idle.wait_for(vLock, aInterval, [this]() { return _Pending == 0; });
+
+            if (aPoll)
+            {
+                vLock.unlock();
+                aPoll();
+                vLock.lock();
+            }
+        }
+
+        _Cancelled = false;
+
+        if (_Error)
+        {
+            auto vError = _Error;
+            _Error = nullptr;
+            std::rethrow_exception(vError);
+        }
+    }
+
+    auto WorkStealingPool::Poll()
+        -> void
+    {
+        if (!_Poll)
+        {
+            return;
+        }
+
+        const auto vNow = std::chrono::steady_clock::now();
+        if (vNow - _LastPoll < _PollInterval)
+        {
+            return;
+        }
+
+        _LastPoll = vNow;
+        (*_Poll)();
+    }
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace Sunstrider
+{
+
+    // A small work-stealing thread pool.
+    //
+    // Every worker owns a deque of tasks. A worker pops its own tasks from the
+    // back (the most recently spawned subtree, which is still hot in cache) and
+    // steals from the front of the other workers' deques when it runs dry, so
+    // that one huge subtree does not keep a single thread busy while the others
+    // are idle.
+    //
+    // The deques are rings which only grow (by doubling) and never release
+    // their storage, so a long scan does not allocate for every task. Tasks
+    // should capture no more than two pointers, so that std::function keeps
+    // them in its small buffer.
+    //
+    // A pool of no workers has no threads: its tasks run on the thread which
+    // calls Wait(), for memory sources which must only be read from one
+    // thread (see MemorySource::AllowsConcurrentReads).
+    class WorkStealingPool
+    {
+    public:
+        // A task receives the index of the worker running it, which can be used
+        // to index per-worker state without any locking.
+        using Task = std::function<void(std::size_t aWorker)>;
+
+        // The number of tasks every deque can hold before it has to grow
+        static constexpr std::size_t INITIAL_QUEUE_CAPACITY = 0x400;
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex          Lock;
+            std::vector<Task>   Ring;       // The size is a power of two
+            std::size_t         Head    = 0;
+            std::size_t         Count   = 0;
+
+            auto PushBack(Task&& aTask)
+                -> void;
+
+            auto PopBack(Task& aTask)
+                -> bool;
+
+            auto PopFront(Task& aTask)
+                -> bool;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>>   _Queues;
+        std::vector<std::thread>                    _Threads;
+
+        std::mutex                  _Lock;
+        std::condition_variable     _Wakeup;    // Signaled when a task is queued
+        std::condition_variable     _Idle;      // Signaled when no task is pending
+        bool                        _Stop       = false;
+        std::exception_ptr          _Error;
+
+        std::atomic<std::size_t>    _Queued     { 0 };  // Tasks waiting in queues
+        std::atomic<std::size_t>    _Pending    { 0 };  // Tasks queued or running
+        std::atomic<std::size_t>    _NextQueue  { 0 };
+        std::atomic<bool>           _Cancelled  { false };
+
+        // The poll routine of the running Wait() of a pool without threads,
+        // and when it was last called
+        const std::function<void()>*            _Poll   = nullptr;
+        std::chrono::milliseconds               _PollInterval {};
+        std::chrono::steady_clock::time_point   _LastPoll;
+
+        auto Push(std::size_t aQueue, Task aTask)
+            -> void;
+
+        auto Pop(std::size_t aWorker, Task& aTask)
+            -> bool;
+
+        auto Steal(std::size_t aWorker, Task& aTask)
+            -> bool;
+
+        auto Execute(std::size_t aWorker, Task& aTask)
+            -> void;
+
+        auto WorkerMain(std::size_t aWorker)
+            -> void;
+
+        // Runs the queued tasks of a pool without threads on the calling thread
+        auto RunOnCaller(const std::function<void()>& aPoll, std::chrono::milliseconds aInterval)
+            -> void;
+
+    public:
+        explicit WorkStealingPool(std::size_t aWorkers = std::max(std::thread::hardware_concurrency(), 1u));
+
+        ~WorkStealingPool();
+
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        // The number of workers, which is 1 for a pool without threads
+        auto Size() const
+            -> std::size_t;
+
+        // Queues a task from outside of the pool
+        auto Submit(Task aTask)
+            -> void;
+
+        // Queues a task from inside of a running task. The task is pushed to
+        // the deque of the calling worker.
+        auto Spawn(std::size_t aWorker, Task aTask)
+            -> void;
+
+        // Discards the tasks which have not started yet, from any thread.
+        // Running tasks complete, and should poll IsCancelled() to stop early.
+        // The pool runs tasks again once Wait() has returned.
+        auto Cancel()
+            -> void;
+
+        auto IsCancelled() const
+            -> bool;
+
+        // Blocks until every queued task has completed. aPoll, if given, is
+        // called on the waiting thread every aInterval. The first exception
+        // thrown by a task cancels the pool, and is rethrown here.
+        auto Wait(
+            const std::function<void()>& aPoll = nullptr,
+            std::chrono::milliseconds aInterval = std::chrono::milliseconds(100))
+            -> void;
+
+        // Calls the poll routine of the running Wait() if aInterval has
+        // elapsed since it was last called. Only a pool without threads has
+        // one, so that a long task it runs can still let the waiting side
+        // report progress and cancel. Does nothing on other pools.
+        auto Poll()
+            -> void;
+    };
+
+}